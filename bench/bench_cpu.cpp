@@ -0,0 +1,83 @@
+#include "Cartridge.h"
+#include "Cpu.h"
+#include "Debugger.h"
+#include "FlightRecorder.h"
+#include "Mmu.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+#define BENCH_RUNS  5
+
+// bench_cpu [rom] [steps] [flight]
+// Cpu::Step throughput on nestest's automated mode, trace off. The test is
+// replayed from $C000 up to the point where it jams, so the mix of
+// opcodes and addressing modes stays the same however long the run is.
+// With "flight", a FlightRecorder is attached to the CPU and the bus.
+int main(int argc, char* argv[]) {
+    const char* rom = (argc > 1) ? argv[1] : "../../roms/nestest.nes";
+    uint64_t steps = (argc > 2) ? strtoull(argv[2], nullptr, 10) : 20000000;
+    bool flight = (argc > 3) && string(argv[3]) == "flight";
+
+    Debugger debugger(nullptr);
+    Mmu mmu(nullptr, &debugger);
+    Cpu cpu(nullptr, &mmu, &debugger);
+    Cartridge cartridge(nullptr, &mmu);
+    mmu.AddMemoryMap(&mmu, 0x0000, 0x1FFF);
+    mmu.AddMemoryMap(&cartridge, 0x4020, 0xFFFF);
+    cartridge.LoadRom(rom);
+    if (cartridge.GetPrgRom().empty()) {
+        return 1;
+    }
+
+    debugger.SetCpu(&cpu);
+    FlightRecorder recorder;
+    if (flight) {
+        cpu.SetFlightRecorder(&recorder);
+        mmu.SetFlightRecorder(&recorder);
+    }
+    cpu.SetTraceEnabled(false);
+    cpu.PowerOn();
+    mmu.PowerOn();
+    cpu.Reset();
+    cpu.SetPC(0xC000);
+
+    cpu_state cpu_start;
+    mmu_state mmu_start;
+    cpu.SaveState(&cpu_start);
+    mmu.SaveState(&mmu_start);
+
+    // nestest ends by jamming on an opcode Cpu doesn't implement
+    int pass = 0;
+    uint16_t pc;
+    do {
+        pc = cpu.GetRegisters().PC;
+        cpu.Step();
+        pass++;
+    } while (pass < 10000 && cpu.GetRegisters().PC != pc);
+
+    double best = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        uint64_t done = 0;
+        auto start = chrono::steady_clock::now();
+        for (; done < steps; done += pass) {
+            cpu.LoadState(&cpu_start);
+            mmu.LoadState(&mmu_start);
+            for (int i = 0; i < pass; i++) {
+                cpu.Step();
+            }
+        }
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        double rate = done / elapsed.count();
+        if (rate > best) {
+            best = rate;
+        }
+    }
+
+    cout << pass << " instructions per pass, best of " << BENCH_RUNS << ": "
+         << best / 1e6 << " M steps/s, " << 1e9 / best << " ns/step" << endl;
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include "Nes.h"
+#include <malloc.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+#define DEFAULT_INSTANCES   1000
+#define GB                  (1024.0 * 1024 * 1024)
+
+static size_t HeapInUse(void) {
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+static size_t ResidentBytes(void) {
+    long pages = 0, resident = 0;
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (file != nullptr) {
+        if (fscanf(file, "%ld %ld", &pages, &resident) != 2) {
+            resident = 0;
+        }
+        fclose(file);
+    }
+    return (size_t)resident * sysconf(_SC_PAGESIZE);
+}
+
+// bench_footprint [rom] [instances]
+// Memory cost of one more running Nes: the instances all load the same
+// ROM and run a frame, so every page they own has been touched. Heap is
+// what malloc handed out; resident is the process RSS growth.
+int main(int argc, char* argv[]) {
+    const char* rom = (argc > 1) ? argv[1] : "../../roms/nestest.nes";
+    size_t count = (argc > 2) ? strtoul(argv[2], nullptr, 10) : DEFAULT_INSTANCES;
+    if (count == 0) {
+        return 1;
+    }
+
+    // the first instance loads the shared ROM image and the static tables
+    unique_ptr<Nes> first(new Nes);
+    first->PowerOn();
+    if (!first->LoadRom(rom)) {
+        return 1;
+    }
+
+    size_t heap = HeapInUse();
+    size_t resident = ResidentBytes();
+    vector<unique_ptr<Nes>> instances;
+    instances.reserve(count);
+    size_t vector_bytes = count * sizeof(instances[0]);
+    for (size_t i = 0; i < count; i++) {
+        unique_ptr<Nes> nes(new Nes);
+        nes->PowerOn();
+        nes->LoadRom(rom);
+        nes->Reset(Nes::EMU_MODE_AUTOMATED);
+        nes->RunFrame(false);
+        instances.push_back(move(nes));
+    }
+    double heap_per = (double)(HeapInUse() - heap) / count;
+    double resident_per = (double)(ResidentBytes() - resident - vector_bytes) / count;
+
+    cout << "sizeof(Nes):       " << sizeof(Nes) << " bytes" << endl;
+    cout << "heap/instance:     " << (size_t)heap_per << " bytes" << endl;
+    cout << "resident/instance: " << (size_t)resident_per << " bytes" << endl;
+    cout << "instances/GB:      " << (size_t)(GB / max(heap_per, resident_per))
+         << " (" << count << " measured)" << endl;
+    return 0;
+}
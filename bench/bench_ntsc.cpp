@@ -0,0 +1,45 @@
+#include "NtscFilter.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+#define BENCH_RUNS      5
+#define NTSC_FRAME_MS   (1000 / 60.0988)
+
+// bench_ntsc [frames]
+// NtscFilter time per frame on a noise picture, AVX2 and scalar, against
+// the 16.6 ms NTSC frame budget.
+int main(int argc, char* argv[]) {
+    int frames = (argc > 1) ? atoi(argv[1]) : 200;
+
+    vector<uint8_t> in(PPU_WIDTH * PPU_HEIGHT);
+    uint32_t seed = 1;
+    for (uint8_t& p : in) {
+        seed = seed * 1103515245 + 12345;
+        p = (seed >> 16) & 0x3F;
+    }
+    vector<uint32_t> out(NTSC_WIDTH * NTSC_HEIGHT);
+
+    NtscFilter ntsc;
+    for (int simd = 1; simd >= 0; simd--) {
+        if (simd && !NtscFilter::HasSimd()) {
+            continue;
+        }
+        ntsc.SetSimdEnabled(simd != 0);
+        double best = 1e9;
+        for (int run = 0; run < BENCH_RUNS; run++) {
+            auto start = chrono::steady_clock::now();
+            for (int f = 0; f < frames; f++) {
+                ntsc.Filter(in.data(), 0, f, out.data());
+            }
+            chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+            best = min(best, elapsed.count() / frames);
+        }
+        cout << (simd ? "avx2:   " : "scalar: ") << best << " ms/frame ("
+             << 100 * best / NTSC_FRAME_MS << "% of a frame)" << endl;
+    }
+    return 0;
+}
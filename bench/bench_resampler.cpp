@@ -0,0 +1,55 @@
+#include "Resampler.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+#define BENCH_RUNS      5
+#define FRAME_SAMPLES   29830   // CPU cycles per NTSC frame
+
+// bench_resampler [seconds]
+// ns per 48 kHz output sample for each quality, SIMD and scalar, fed one
+// frame of CPU-rate samples per call like an APU would.
+int main(int argc, char* argv[]) {
+    double seconds = (argc > 1) ? atof(argv[1]) : 2.0;
+    size_t frames = (size_t)(seconds * APU_SAMPLE_RATE / FRAME_SAMPLES);
+
+    // a pulse wave with some noise, like raw APU output
+    vector<float> in(FRAME_SAMPLES);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < in.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        in[i] = ((i / 2034) & 1 ? 0.5f : -0.5f) + (seed >> 16) * (0.05f / 65536);
+    }
+    vector<float> out(FRAME_SAMPLES);
+
+    static const char* names[] = { "low", "medium", "high" };
+    for (int q = Resampler::QUALITY_LOW; q <= Resampler::QUALITY_HIGH; q++) {
+        for (int simd = 1; simd >= 0; simd--) {
+            if (simd && !Resampler::HasSimd()) {
+                continue;
+            }
+            double best = 0;
+            for (int run = 0; run < BENCH_RUNS; run++) {
+                Resampler resampler(APU_SAMPLE_RATE, HOST_SAMPLE_RATE, (Resampler::quality)q);
+                resampler.SetSimdEnabled(simd != 0);
+                uint64_t produced = 0;
+                auto start = chrono::steady_clock::now();
+                for (size_t f = 0; f < frames; f++) {
+                    produced += resampler.Process(in.data(), in.size(), out.data(), out.size());
+                }
+                chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+                double rate = produced / elapsed.count();
+                if (rate > best) {
+                    best = rate;
+                }
+            }
+            cout << names[q] << (simd ? " simd:   " : " scalar: ") << 1e9 / best
+                 << " ns/sample, " << best / HOST_SAMPLE_RATE << "x realtime" << endl;
+        }
+    }
+    return 0;
+}
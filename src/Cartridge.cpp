@@ -1,46 +1,206 @@
 #include "Cartridge.h"
 #include "Nes.h"
+#include "RomDatabase.h"
+#include "Crc32.h"
 #include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <unordered_map>
 
 using namespace std;
 
 #define KB(x)   ((size_t) (x) << 10)
 
-Cartridge::Cartridge(Nes* nes, Mmu* mmu) :
-    nes_(nes), mmu_(mmu) {
+// Images are immutable once loaded, so all instances running one dump
+// share a copy. The registry only holds weak references: an image goes
+// away with the last Cartridge using it.
+static shared_ptr<const rom_image> ShareRomImage(rom_image* image) {
+    static mutex lock;
+    static unordered_multimap<uint32_t, weak_ptr<const rom_image>> images;
+
+    uint32_t crc = Crc32::Compute(image->chr.data(), image->chr.size(),
+                                  Crc32::Compute(image->prg.data(), image->prg.size()));
+    lock_guard<mutex> guard(lock);
+    auto range = images.equal_range(crc);
+    for (auto it = range.first; it != range.second;) {
+        shared_ptr<const rom_image> shared = it->second.lock();
+        if (shared == nullptr) {
+            it = images.erase(it);
+            continue;
+        }
+        if (shared->prg == image->prg && shared->chr == image->chr) {
+            return shared;
+        }
+        ++it;
+    }
+    shared_ptr<const rom_image> shared = make_shared<rom_image>(move(*image));
+    images.emplace(crc, shared);
+    return shared;
+}
 
+static const shared_ptr<const rom_image>& EmptyRomImage(void) {
+    static const shared_ptr<const rom_image> empty = make_shared<rom_image>();
+    return empty;
+}
+
+Cartridge::Cartridge(Nes* nes, Mmu* mmu) :
+    nes_(nes), mmu_(mmu), rom_(EmptyRomImage()), prg_rom_(nullptr), prg_mask_(0),
+    prg_ram_(prg_ram_buf_) {
+    memset(mapper_regs_, 0, sizeof(mapper_regs_));
+    memset(prg_ram_buf_, 0, sizeof(prg_ram_buf_));
+    memset(&info_, 0, sizeof(info_));
 }
 
 uint8_t Cartridge::Read8(uint16_t addr) {
-    if (0x8000 <= addr && addr <= 0xBFFF) {
-        return prg_rom_[addr - 0x8000];
-    } else if (0xC000 <= addr && addr <= 0xFFFF) {
-        return prg_rom_[addr - 0xC000];
+    if (0x8000 <= addr) {
+#ifdef NES_CDL
+        cdl_.LogData(addr);
+#endif
+        // NROM: 16 KB images are mirrored into $C000-$FFFF
+        return prg_rom_[(addr - 0x8000) & prg_mask_];
+    } else if (0x6000 <= addr) {
+        return prg_ram_[addr - 0x6000];
     }
     return 0;
 }
 
-void Cartridge::Write8(uint16_t addr, uint8_t data) {
+const uint8_t* Cartridge::GetPage(uint16_t addr) {
+    if (0x8000 <= addr && prg_rom_ != nullptr) {
+        return &prg_rom_[(addr - 0x8000) & prg_mask_ & ~0xFF];
+    } else if (0x6000 <= addr && addr < 0x8000) {
+        return &prg_ram_[(addr - 0x6000) & ~0xFF];
+    }
+    return nullptr;
+}
 
+void Cartridge::Write8(uint16_t addr, uint8_t data) {
+    if (0x6000 <= addr && addr < 0x8000) {
+        prg_ram_[addr - 0x6000] = data;
+    }
 }
 
-void Cartridge::LoadRom(const char* rom) {
+bool Cartridge::LoadRom(const char* rom, RomDatabase* db, save_ram_mode save) {
     ines_hdr header;
 
     ifstream file(rom, ios::in | ios::binary);
     if (file.is_open()) {
         file.read((char*)&header, sizeof(header));
-        prg_rom_.resize(header.prg_size * KB(16), 0);
-        chr_rom_.resize(header.chr_size * KB(16), 0);
+        if (!file || !ParseHeader(header, &info_)) {
+            cout << "Not a NES ROM!" << endl;
+            return false;
+        }
+        if (info_.trainer) {
+            file.seekg(512, ios::cur);
+        }
+        rom_image image;
+        image.prg.resize(info_.prg_rom_size, 0);
+        image.chr.resize(info_.chr_rom_size, 0);
+        file.read((char*)image.prg.data(), image.prg.size());
+        file.read((char*)image.chr.data(), image.chr.size());
+        rom_ = ShareRomImage(&image);
+        const vector<uint8_t>& prg = rom_->prg;
+        const vector<uint8_t>& chr = rom_->chr;
+        prg_rom_ = prg.empty() ? nullptr : prg.data();
+        prg_mask_ = prg.empty() ? 0 : prg.size() - 1;
+#ifdef NES_CDL
+        cdl_.Reset(prg.size(), chr.size());
+#endif
 
-        file.read((char*)prg_rom_.data(), prg_rom_.size());
-        file.read((char*)chr_rom_.data(), chr_rom_.size());
+        if (db != nullptr) {
+            db->Identify(prg.data(), prg.size(), chr.data(), chr.size(), &info_);
+        }
+
+        save_ram_.Close();
+        prg_ram_ = prg_ram_buf_;
+        if (info_.battery) {
+            string sav(rom);
+            size_t ext = sav.find_last_of('.');
+            if (ext != string::npos && sav.find_first_of("/\\", ext) == string::npos) {
+                sav.erase(ext);
+            }
+            sav += ".sav";
+            if (save == SAVE_RAM_WRITE_BACK && !save_ram_.Open(sav.c_str(), PRG_RAM_SIZE)) {
+                cout << "Cannot open save file " << sav << ", progress won't be saved" << endl;
+                save = SAVE_RAM_COPY;
+            }
+            if (save == SAVE_RAM_COPY && !save_ram_.OpenCopy(sav.c_str(), PRG_RAM_SIZE)) {
+                cout << "Cannot read save file " << sav << endl;
+            }
+            if (save_ram_.IsOpen()) {
+                prg_ram_ = save_ram_.GetData();
+            }
+        }
     } else {
         cout << "File does not exists!" << endl;
+        return false;
     }
     file.close();
+    return true;
+}
+
+// NES 2.0 exponent-multiplier size notation: 2^E * (MM * 2 + 1)
+static size_t Nes2RomSize(uint8_t lsb, uint8_t msb, size_t unit) {
+    if (msb == 0x0F) {
+        return ((size_t)1 << (lsb >> 2)) * ((lsb & 3) * 2 + 1);
+    }
+    return (((size_t)msb << 8) | lsb) * unit;
+}
+
+bool Cartridge::ParseHeader(const ines_hdr& header, rom_info* info) {
+    static const uint8_t magic[4] = { 0x4E, 0x45, 0x53, 0x1A };
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0) {
+        return false;
+    }
+
+    memset(info, 0, sizeof(*info));
+    info->battery = (header.flag6 & FLAG6_BATTERY) != 0;
+    info->trainer = (header.flag6 & FLAG6_TRAINER) != 0;
+    if (header.flag6 & FLAG6_FOUR_SCREEN) {
+        info->mirroring = MIRROR_FOUR_SCREEN;
+    } else if (header.flag6 & FLAG6_MIRRORING) {
+        info->mirroring = MIRROR_VERTICAL;
+    } else {
+        info->mirroring = MIRROR_HORIZONTAL;
+    }
+
+    info->nes2 = (header.flag7 & 0x0C) == 0x08;
+    if (info->nes2) {
+        info->mapper = (header.flag6 >> 4) | (header.flag7 & 0xF0) | ((header.flag8 & 0x0F) << 8);
+        info->submapper = header.flag8 >> 4;
+        info->prg_rom_size = Nes2RomSize(header.prg_size, header.flag9 & 0x0F, KB(16));
+        info->chr_rom_size = Nes2RomSize(header.chr_size, header.flag9 >> 4, KB(8));
+        // volatile and battery-backed RAM sizes, 64 << shift bytes
+        uint8_t shift = header.flag10 & 0x0F;
+        uint8_t nv_shift = header.flag10 >> 4;
+        info->prg_ram_size = (shift ? 64 << shift : 0) + (nv_shift ? 64 << nv_shift : 0);
+        info->tv_system = header.padding[1] & 3;
+    } else {
+        // Old dumping tools wrote text such as "DiskDude!" over bytes 7-15;
+        // if the unused bytes are dirty, byte 7 can't be trusted either.
+        bool dirty = false;
+        for (size_t i = 0; i < sizeof(header.padding); i++) {
+            dirty |= header.padding[i] != 0;
+        }
+        uint8_t flag7 = dirty ? 0 : header.flag7;
+        info->mapper = (header.flag6 >> 4) | (flag7 & 0xF0);
+        info->prg_rom_size = header.prg_size * KB(16);
+        info->chr_rom_size = header.chr_size * KB(8);
+        info->prg_ram_size = (!dirty && header.flag8) ? header.flag8 * KB(8) : KB(8);
+        info->tv_system = (!dirty && (header.flag9 & 1)) ? TV_PAL : TV_NTSC;
+    }
+    return true;
+}
+
+void Cartridge::SaveState(cartridge_state* state) const {
+    memcpy(state->mapper_regs, mapper_regs_, sizeof(mapper_regs_));
+    memcpy(state->prg_ram, prg_ram_, PRG_RAM_SIZE);
+}
+
+void Cartridge::LoadState(const cartridge_state* state) {
+    memcpy(mapper_regs_, state->mapper_regs, sizeof(mapper_regs_));
+    memcpy(prg_ram_, state->prg_ram, PRG_RAM_SIZE);
 }
 
 // uint16_t Cartridge::GetResetVector(void) {
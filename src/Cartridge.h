@@ -1,12 +1,20 @@
 #ifndef CARTRIDGE_H
 #define CARTRIDGE_H
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <vector>
 #include "IMemoryUnit.h"
+#include "SaveRam.h"
+#include "CodeDataLogger.h"
+
+#define PRG_RAM_SIZE    0x2000
 
 class Nes;
 class Mmu;
+class RomDatabase;
 
 // #define CARTRIDGE_ADDR_START    0x4020
 // #define CARTRIDGE_ADDR_END      0xFFFF
@@ -20,25 +28,107 @@ typedef struct {
     uint8_t flag8;      // PRG RAM size
     uint8_t flag9;      // TV system
     uint8_t flag10;     // TV-system, PRG RAM presence
-    uint8_t padding[5]; // unused padding
+    uint8_t padding[5]; // unused padding (NES 2.0: CHR RAM, timing, system, misc ROMs, device)
 } ines_hdr;
 
+typedef struct {
+    bool nes2;              // NES 2.0 header
+    uint16_t mapper;
+    uint8_t submapper;
+    uint8_t mirroring;      // Cartridge::mirroring
+    uint8_t tv_system;      // Cartridge::tv_system
+    bool battery;
+    bool trainer;
+    bool in_database;       // corrected from a RomDatabase entry
+    bool cycle_cpu;         // needs the per-cycle CPU core, from RomDatabase
+    size_t prg_rom_size;
+    size_t chr_rom_size;
+    size_t prg_ram_size;
+    uint32_t crc;           // CRC-32 of PRG + CHR, filled by RomDatabase
+    uint8_t sha1[20];       // SHA-1 of PRG + CHR, filled by RomDatabase
+} rom_info;
+
+// PRG and CHR ROM as loaded, shared read-only by every Cartridge that
+// loaded the same dump.
+typedef struct {
+    std::vector<uint8_t> prg;
+    std::vector<uint8_t> chr;
+} rom_image;
+
+typedef struct {
+    uint8_t mapper_regs[8]; // bank/control registers (none used by NROM)
+    uint8_t prg_ram[PRG_RAM_SIZE];
+} cartridge_state;
+
 class Cartridge : public IMemoryUnit {
 public:
+    enum ines_flag6 {
+        FLAG6_MIRRORING = (1 << 0),
+        FLAG6_BATTERY = (1 << 1),
+        FLAG6_TRAINER = (1 << 2),
+        FLAG6_FOUR_SCREEN = (1 << 3)
+    };
+
+    enum mirroring {
+        MIRROR_HORIZONTAL,
+        MIRROR_VERTICAL,
+        MIRROR_FOUR_SCREEN
+    };
+
+    enum tv_system {
+        TV_NTSC,
+        TV_PAL,
+        TV_MULTI,
+        TV_DENDY
+    };
+
     Cartridge(Nes* nes, Mmu* mmu);
     ~Cartridge() = default;
 
     virtual uint8_t Read8(uint16_t addr);
     virtual void Write8(uint16_t addr, uint8_t data);
+    virtual const uint8_t* GetPage(uint16_t addr);
 
-    void LoadRom(const char* rom);
+    // db, when given, corrects header fields of known dumps. Battery RAM is
+    // a private copy of the .sav with SAVE_RAM_COPY, or when another
+    // instance already writes the file back.
+    bool LoadRom(const char* rom, RomDatabase* db=nullptr,
+                 save_ram_mode save=SAVE_RAM_WRITE_BACK);
+    const rom_info& GetRomInfo(void) const { return info_; }
+    const std::vector<uint8_t>& GetPrgRom(void) const { return rom_->prg; }
+    const std::vector<uint8_t>& GetChrRom(void) const { return rom_->chr; }
+    // The image itself, to check that instances share it.
+    const rom_image* GetRomImage(void) const { return rom_.get(); }
+    // Sized for the loaded ROM and filled in NES_CDL builds; empty otherwise.
+    CodeDataLogger* GetCodeDataLogger(void) { return &cdl_; }
+    bool HasBattery(void) const { return save_ram_.IsOpen(); }
+    // Battery RAM writes reach the .sav file.
+    bool IsSaving(void) const { return save_ram_.IsWriteBack(); }
+    const uint8_t* GetMapperRegs(void) const { return mapper_regs_; }
+    // PRG_RAM_SIZE bytes at $6000
+    const uint8_t* GetPrgRam(void) const { return prg_ram_; }
+
+    // Decodes iNES and NES 2.0 headers. Returns false if it's not a NES ROM.
+    static bool ParseHeader(const ines_hdr& header, rom_info* info);
+
+    void SaveState(cartridge_state* state) const;
+    void LoadState(const cartridge_state* state);
     //uint16_t GetResetVector(void);
 
 private:
     Nes* nes_;
     Mmu* mmu_;
-    std::vector<uint8_t> prg_rom_;
-    std::vector<uint8_t> chr_rom_;
+    rom_info info_;
+    std::shared_ptr<const rom_image> rom_;
+    const uint8_t* prg_rom_;    // rom_->prg, for Read8
+    size_t prg_mask_;
+    uint8_t mapper_regs_[8];
+
+    // $6000-$7FFF, points at save_ram_ for battery-backed boards
+    uint8_t* prg_ram_;
+    uint8_t prg_ram_buf_[PRG_RAM_SIZE];
+    SaveRam save_ram_;
+    CodeDataLogger cdl_;
 };
 
 #endif
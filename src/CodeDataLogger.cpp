@@ -0,0 +1,87 @@
+#include "CodeDataLogger.h"
+#include <algorithm>
+#include <fstream>
+
+using namespace std;
+
+CodeDataLogger::CodeDataLogger() :
+    prg_mask_(0), fetch_(0), enabled_(true)
+{
+
+}
+
+void CodeDataLogger::Reset(size_t prg_size, size_t chr_size) {
+    prg_.assign(prg_size, 0);
+    chr_.assign(chr_size, 0);
+    prg_mask_ = prg_size ? prg_size - 1 : 0;
+    fetch_ = 0;
+}
+
+void CodeDataLogger::Clear(void) {
+    fill(prg_.begin(), prg_.end(), 0);
+    fill(chr_.begin(), chr_.end(), 0);
+}
+
+bool CodeDataLogger::Read(const char* filename, vector<uint8_t>* data) const {
+    ifstream file(filename, ios::in | ios::binary | ios::ate);
+    if (!file.is_open() || (size_t)file.tellg() != prg_.size() + chr_.size()) {
+        return false;
+    }
+    data->resize(prg_.size() + chr_.size());
+    file.seekg(0);
+    file.read((char*)data->data(), data->size());
+    return (bool)file;
+}
+
+bool CodeDataLogger::Load(const char* filename) {
+    vector<uint8_t> data;
+    if (!Read(filename, &data)) {
+        return false;
+    }
+    copy(data.begin(), data.begin() + prg_.size(), prg_.begin());
+    copy(data.begin() + prg_.size(), data.end(), chr_.begin());
+    return true;
+}
+
+bool CodeDataLogger::Merge(const char* filename) {
+    vector<uint8_t> data;
+    if (!Read(filename, &data)) {
+        return false;
+    }
+    for (size_t i = 0; i < prg_.size(); i++) {
+        prg_[i] |= data[i];
+    }
+    for (size_t i = 0; i < chr_.size(); i++) {
+        chr_[i] |= data[prg_.size() + i];
+    }
+    return true;
+}
+
+void CodeDataLogger::Merge(const CodeDataLogger& other) {
+    size_t prg_size = min(prg_.size(), other.prg_.size());
+    size_t chr_size = min(chr_.size(), other.chr_.size());
+    for (size_t i = 0; i < prg_size; i++) {
+        prg_[i] |= other.prg_[i];
+    }
+    for (size_t i = 0; i < chr_size; i++) {
+        chr_[i] |= other.chr_[i];
+    }
+}
+
+bool CodeDataLogger::Save(const char* filename) const {
+    ofstream file(filename, ios::out | ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write((const char*)prg_.data(), prg_.size());
+    file.write((const char*)chr_.data(), chr_.size());
+    return (bool)file;
+}
+
+size_t CodeDataLogger::GetCodeBytes(void) const {
+    return count_if(prg_.begin(), prg_.end(), [](uint8_t f) { return (f & CDL_CODE) != 0; });
+}
+
+size_t CodeDataLogger::GetDataBytes(void) const {
+    return count_if(prg_.begin(), prg_.end(), [](uint8_t f) { return (f & CDL_DATA) != 0; });
+}
@@ -0,0 +1,69 @@
+#ifndef _CODE_DATA_LOGGER_H
+#define _CODE_DATA_LOGGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "CodeDataMap.h"
+
+// Runtime coverage of PRG-ROM in the CDL format (CodeDataMap.h). The
+// logging hooks in Cpu::Step and Cartridge::Read8 are only compiled in with
+// NES_CDL (cmake -DNES_CDL=ON); loading, merging and saving maps is always
+// available so batch results can be combined offline.
+class CodeDataLogger {
+public:
+    CodeDataLogger();
+    ~CodeDataLogger() = default;
+
+    // Sizes the maps for a ROM and clears them.
+    void Reset(size_t prg_size, size_t chr_size);
+    void Clear(void);
+    // Disabled while Nes runs frames that are thrown away again.
+    void SetEnabled(bool enabled) { enabled_ = enabled; }
+    bool IsEnabled(void) const { return enabled_; }
+
+    // Cpu::Step: operand fetches between BeginFetch and LogCode are not
+    // logged as data reads.
+    void BeginFetch(uint16_t pc) { fetch_ = pc; }
+    void LogCode(uint16_t pc, int size) {
+        fetch_ = 0;
+        if (pc < 0x8000 || !enabled_ || prg_.empty()) {
+            return;
+        }
+        for (int i = 0; i < size; i++) {
+            uint16_t addr = pc + i;
+            prg_[(addr - 0x8000) & prg_mask_] |= CDL_CODE | Bank(addr);
+        }
+    }
+    // Cartridge::Read8, addr >= $8000
+    void LogData(uint16_t addr) {
+        if ((uint16_t)(addr - fetch_) < 3 || !enabled_ || prg_.empty()) {
+            return;
+        }
+        prg_[(addr - 0x8000) & prg_mask_] |= CDL_DATA | Bank(addr);
+    }
+
+    // Load replaces the maps, Merge ORs a file into them. Both fail if the
+    // file size doesn't match the ROM.
+    bool Load(const char* filename);
+    bool Merge(const char* filename);
+    void Merge(const CodeDataLogger& other);
+    bool Save(const char* filename) const;
+
+    const std::vector<uint8_t>& GetPrgMap(void) const { return prg_; }
+    const std::vector<uint8_t>& GetChrMap(void) const { return chr_; }
+    size_t GetCodeBytes(void) const;
+    size_t GetDataBytes(void) const;
+
+private:
+    std::vector<uint8_t> prg_;
+    std::vector<uint8_t> chr_;
+    size_t prg_mask_;
+    uint16_t fetch_;
+    bool enabled_;
+
+    static uint8_t Bank(uint16_t addr) { return ((addr >> 13) & 3) << CDL_BANK_SHIFT; }
+    bool Read(const char* filename, std::vector<uint8_t>* data) const;
+};
+
+#endif
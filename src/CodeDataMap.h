@@ -0,0 +1,18 @@
+#ifndef _CODE_DATA_MAP_H
+#define _CODE_DATA_MAP_H
+
+// Per-byte PRG classification, bit-compatible with the FCEUX .cdl format:
+// the file holds one flag byte per PRG-ROM byte followed by one per
+// CHR-ROM byte, so maps from the static and runtime analysis can be merged
+// with a bitwise OR.
+#define CDL_CODE            (1 << 0)    // executed as opcode or operand
+#define CDL_DATA            (1 << 1)    // read as data
+#define CDL_BANK_MASK       (3 << 2)    // $8000 bank the byte was mapped to
+#define CDL_BANK_SHIFT      2
+#define CDL_INDIRECT_CODE   (1 << 4)    // reached through a jump table or vector
+#define CDL_INDIRECT_DATA   (1 << 5)    // read through an (indirect),Y pointer
+
+#define CDL_CHR_RENDERED    (1 << 0)
+#define CDL_CHR_READ        (1 << 1)
+
+#endif
@@ -0,0 +1,57 @@
+#include "Controller.h"
+#include <cstring>
+
+Controller::Controller(Nes* nes) :
+    nes_(nes)
+{
+    memset(&state_, 0, sizeof(state_));
+}
+
+uint8_t Controller::Read8(uint16_t addr) {
+    int port = addr & 1;
+    uint8_t data;
+
+    if (state_.strobe) {
+        data = state_.buttons[port] & 1;
+    } else {
+        data = state_.shift[port] & 1;
+        // official pads return 1 once all eight buttons are shifted out
+        state_.shift[port] = 0x80 | (state_.shift[port] >> 1);
+    }
+    // upper bits are open bus, normally the $40 of the address
+    return 0x40 | data;
+}
+
+void Controller::Write8(uint16_t addr, uint8_t data) {
+    if (addr != 0x4016) {
+        return;     // $4017 writes belong to the APU frame counter
+    }
+    state_.strobe = data & 1;
+    if (state_.strobe) {
+        state_.shift[0] = state_.buttons[0];
+        state_.shift[1] = state_.buttons[1];
+    }
+}
+
+void Controller::Latch(void) {
+    input_frame input;
+    if (queue_.Pop(&input)) {
+        SetButtons(0, input.buttons[0]);
+        SetButtons(1, input.buttons[1]);
+    }
+}
+
+void Controller::SetButtons(int port, uint8_t buttons) {
+    state_.buttons[port] = buttons;
+    if (state_.strobe) {
+        state_.shift[port] = buttons;
+    }
+}
+
+void Controller::SaveState(controller_state* state) const {
+    *state = state_;
+}
+
+void Controller::LoadState(const controller_state* state) {
+    state_ = *state;
+}
@@ -0,0 +1,65 @@
+#ifndef _CONTROLLER_H
+#define _CONTROLLER_H
+
+#include <cstdint>
+#include "IMemoryUnit.h"
+#include "MpscQueue.h"
+
+#define NUM_PORTS           2
+#define INPUT_QUEUE_SIZE    256
+
+class Nes;
+
+typedef struct {
+    uint8_t buttons[NUM_PORTS];
+} input_frame;
+
+typedef struct {
+    uint8_t buttons[NUM_PORTS];
+    uint8_t shift[NUM_PORTS];
+    uint8_t strobe;
+} controller_state;
+
+// Standard controllers on $4016/$4017. Writing bit 0 of $4016 strobes both
+// pads; while strobe is low each read shifts out one button, A first.
+// Any number of host threads hand input over through a queue which is only
+// drained by the emulation thread at frame boundaries. Submit is lock-free
+// but not wait-free: producers racing for a slot retry their CAS. Latch is
+// wait-free and never waits on a producer.
+class Controller : public IMemoryUnit {
+public:
+    enum button {
+        BUTTON_A = (1 << 0),
+        BUTTON_B = (1 << 1),
+        BUTTON_SELECT = (1 << 2),
+        BUTTON_START = (1 << 3),
+        BUTTON_UP = (1 << 4),
+        BUTTON_DOWN = (1 << 5),
+        BUTTON_LEFT = (1 << 6),
+        BUTTON_RIGHT = (1 << 7)
+    };
+
+    Controller(Nes* nes);
+    ~Controller() = default;
+
+    virtual uint8_t Read8(uint16_t addr);
+    virtual void Write8(uint16_t addr, uint8_t data);
+
+    // host side, any thread
+    bool Submit(const input_frame& input) { return queue_.Push(input); }
+
+    // emulation side
+    void Latch(void);
+    void SetButtons(int port, uint8_t buttons);
+    uint8_t GetButtons(int port) const { return state_.buttons[port]; }
+
+    void SaveState(controller_state* state) const;
+    void LoadState(const controller_state* state);
+
+private:
+    Nes* nes_;
+    controller_state state_;
+    MpscQueue<input_frame, INPUT_QUEUE_SIZE> queue_;
+};
+
+#endif
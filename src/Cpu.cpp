@@ -1,13 +1,19 @@
 #include "Cpu.h"
 #include "Nes.h"
 #include "Mmu.h"
+#include "Debugger.h"
+#include "CodeDataLogger.h"
+#include "ITraceSink.h"
+#include "FlightRecorder.h"
 #include "Logging.h"
+#include "opcode.h"
 #include <cstring>
 #include <iomanip>
 #include <sstream>
 
-Cpu::Cpu(Nes* nes, Mmu* mmu) :
-    nes_(nes), mmu_(mmu)
+Cpu::Cpu(Nes* nes, Mmu* mmu, Debugger* debugger) :
+    nes_(nes), mmu_(mmu), debugger_(debugger), cdl_(nullptr), op_pc_(0), cycles_(0), instructions_(0),
+    trace_(true), trace_sink_(nullptr), recorder_(nullptr)
 {
     memset(&reg_, 0, sizeof(reg_));
 }
@@ -27,13 +33,25 @@ void Cpu::Reset(void) {
 }
 
 void Cpu::Step(void) {
-    uint16_t operand, addr;
+    uint16_t operand = 0, addr;
     bool pageCrossed = false;
 
+    if (debugger_->IsWatched(reg_.PC, BP_EXEC) && debugger_->OnExec(reg_.PC)) {
+        return;
+    }
+
+    op_pc_ = reg_.PC;
+    instructions_++;
+#ifdef NES_CDL
+    if (cdl_ != nullptr) {
+        cdl_->BeginFetch(reg_.PC);
+    }
+#endif
     uint8_t opcode = mmu_->Read8(reg_.PC);
-    mode_ = opcode_table_[opcode].mode;
+    const opcode_hot& hot = hot_opcodes.entries[opcode];
+    addr_mode mode = (addr_mode)hot.mode;
 
-    switch (mode_) {
+    switch (mode) {
         case MODE_ABSOLUTE:
             operand = mmu_->Read16(reg_.PC + 1);
             addr = operand;
@@ -63,7 +81,7 @@ void Cpu::Step(void) {
         case MODE_INDIRECT_Y_INDEXED:
             operand = mmu_->Read8(reg_.PC + 1);
             addr = mmu_->Read16_S(operand) + reg_.Y;
-            pageCrossed = IsPageCrossed(addr, (mmu_->Read16(operand) & 0xFF00) | ((mmu_->Read16(operand) + reg_.Y) & 0xFF));
+            pageCrossed = IsPageCrossed(addr, addr - reg_.Y);
             break;
         case MODE_RELATIVE:
             operand = mmu_->Read8(reg_.PC + 1);
@@ -85,112 +103,124 @@ void Cpu::Step(void) {
             break;
     }
 
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0') << std::uppercase //<< std::hex
-       << std::setw(4) << reg_.PC
-       << "  "
-       << std::setw(2) << (int)opcode
-       << " ";
-    if (opcode_table_[opcode].size > 1) {
-        ss << std::setw(2) << (operand & 0xFF);
-    } else {
-        ss << "  ";
-    }
-    ss << " ";
-    if (opcode_table_[opcode].size > 2) {
-        ss << std::setw(2) << (operand >> 8);
-    } else {
-        ss << "  ";
-    }
-    ss << "  "
-       << opcode_table_[opcode].name
-       << "    "
-       << "A:"    << std::setw(2) << (int)reg_.A << " "
-       << "X:"    << std::setw(2) << (int)reg_.X << " "
-       << "Y:"    << std::setw(2) << (int)reg_.Y << " "
-       << "P:"    << std::setw(2) << (int)reg_.P << " "
-       << "SP:"   << std::setw(2) << (int)reg_.SP  << " "
-       << "CPUC:" << std::dec << cycles_;
 
-    LOG_DEBUG(ss.str());
+#ifdef NES_CDL
+    if (cdl_ != nullptr) {
+        cdl_->LogCode(reg_.PC, hot.size);
+    }
+#endif
 
+    if (IsTracing()) {
+        Trace(reg_, opcode, operand, cycles_);
+    }
+    if (recorder_ != nullptr) {
+        recorder_->RecordInstruction(reg_, opcode, operand, cycles_);
+    }
 
-    reg_.PC += opcode_table_[opcode].size;
-    cycles_ += opcode_table_[opcode].cycles;
-    enum opcode op = opcode_table_[opcode].op;
+    reg_.PC += hot.size;
+    cycles_ += hot.cycles & OPC_CYCLES_MASK;
+    enum opcode op = (enum opcode)hot.op;
     if (pageCrossed)
-        cycles_ += opcode_table_[opcode].pagecrossed_cycles;
+        cycles_ += hot.cycles >> OPC_PENALTY_SHIFT;
 
     switch (op) {
-        case OP_ADC: ADC(addr); break;
-        case OP_AND: AND(addr); break;
-        case OP_ASL: ASL(addr); break;
-
-        case OP_BCC: BCC(addr); break;
-        case OP_BCS: BCS(addr); break;
-        case OP_BEQ: BEQ(addr); break;
-        case OP_BIT: BIT(addr); break;
-        case OP_BMI: BMI(addr); break;
-        case OP_BNE: BNE(addr); break;
-        case OP_BPL: BPL(addr); break;
-        case OP_BVC: BVC(addr); break;
-        case OP_BVS: BVS(addr); break;
+        case OP_ADC: ADC(mmu_->Read8(addr)); break;
+        case OP_AND: AND(mmu_->Read8(addr)); break;
+        case OP_ASL:
+            if (mode == MODE_ACCUMULATOR) {
+                reg_.A = ASL(reg_.A);
+            } else {
+                mmu_->Write8(addr, ASL(mmu_->Read8(addr)));
+            }
+            break;
+
+        case OP_BCC:
+        case OP_BCS:
+        case OP_BEQ:
+        case OP_BMI:
+        case OP_BNE:
+        case OP_BPL:
+        case OP_BVC:
+        case OP_BVS:
+            Branch(addr, IsBranchTaken(op));
+            break;
+        case OP_BIT: BIT(mmu_->Read8(addr)); break;
+        case OP_BRK: BRK();     break;
 
         case OP_CLC: CLC();     break;
         case OP_CLD: CLD();     break;
+        case OP_CLI: CLI();     break;
         case OP_CLV: CLV();     break;
-        case OP_CMP: CMP(addr); break;
-        case OP_CPX: CPX(addr); break;
-        case OP_CPY: CPY(addr); break;
+        case OP_CMP: CMP(mmu_->Read8(addr)); break;
+        case OP_CPX: CPX(mmu_->Read8(addr)); break;
+        case OP_CPY: CPY(mmu_->Read8(addr)); break;
 
-        case OP_DCP: DCP(addr); break;
-        case OP_DEC: DEC(addr); break;
+        case OP_DCP: mmu_->Write8(addr, DCP(mmu_->Read8(addr))); break;
+        case OP_DEC: mmu_->Write8(addr, DEC(mmu_->Read8(addr))); break;
         case OP_DEX: DEX();     break;
         case OP_DEY: DEY();     break;
 
-        case OP_EOR: EOR(addr); break;
+        case OP_EOR: EOR(mmu_->Read8(addr)); break;
 
-        case OP_INC: INC(addr); break;
+        case OP_INC: mmu_->Write8(addr, INC(mmu_->Read8(addr))); break;
         case OP_INX: INX();     break;
         case OP_INY: INY();     break;
-        case OP_ISB: ISB(addr); break;
+        case OP_ISB: mmu_->Write8(addr, ISB(mmu_->Read8(addr))); break;
 
         case OP_JMP: JMP(addr); break;
         case OP_JSR: JSR(addr); break;
 
-        case OP_LAX: LAX(addr); break;
-        case OP_LDA: LDA(addr); break;
-        case OP_LDX: LDX(addr); break;
-        case OP_LDY: LDY(addr); break;
-        case OP_LSR: LSR(addr); break;
+        case OP_LAX: LAX(mmu_->Read8(addr)); break;
+        case OP_LDA: LDA(mmu_->Read8(addr)); break;
+        case OP_LDX: LDX(mmu_->Read8(addr)); break;
+        case OP_LDY: LDY(mmu_->Read8(addr)); break;
+        case OP_LSR:
+            if (mode == MODE_ACCUMULATOR) {
+                reg_.A = LSR(reg_.A);
+            } else {
+                mmu_->Write8(addr, LSR(mmu_->Read8(addr)));
+            }
+            break;
 
         case OP_NOP:    // do nothing
             break;
 
-        case OP_ORA: ORA(addr); break;
+        case OP_ORA: ORA(mmu_->Read8(addr)); break;
 
         case OP_PHA: PHA();     break;
         case OP_PHP: PHP();     break;
-        case OP_PLA: PLA();     break;
-        case OP_PLP: PLP();     break;
-
-        case OP_RLA: RLA(addr); break;
-        case OP_ROL: ROL(addr); break;
-        case OP_ROR: ROR(addr); break;
-        case OP_RRA: RRA(addr); break;
+        case OP_PLA: PLA(Pop8()); break;
+        case OP_PLP: PLP(Pop8()); break;
+
+        case OP_RLA: mmu_->Write8(addr, RLA(mmu_->Read8(addr))); break;
+        case OP_ROL:
+            if (mode == MODE_ACCUMULATOR) {
+                reg_.A = ROL(reg_.A);
+            } else {
+                mmu_->Write8(addr, ROL(mmu_->Read8(addr)));
+            }
+            break;
+        case OP_ROR:
+            if (mode == MODE_ACCUMULATOR) {
+                reg_.A = ROR(reg_.A);
+            } else {
+                mmu_->Write8(addr, ROR(mmu_->Read8(addr)));
+            }
+            break;
+        case OP_RRA: mmu_->Write8(addr, RRA(mmu_->Read8(addr))); break;
         case OP_RTI: RTI();     break;
         case OP_RTS: RTS();     break;
 
-        case OP_SAX: SAX(addr); break;
-        case OP_SBC: SBC(addr); break;
+        case OP_SAX: mmu_->Write8(addr, Store(OP_SAX)); break;
+        case OP_SBC: SBC(mmu_->Read8(addr)); break;
         case OP_SEC: SEC();     break;
         case OP_SED: SED();     break;
         case OP_SEI: SEI();     break;
-        case OP_SLO: SLO(addr); break;
-        case OP_SRE: SRE(addr); break;
-        case OP_STA: STA(addr); break;
-        case OP_STX: STX(addr); break;
-        case OP_STY: STY(addr); break;
+        case OP_SLO: mmu_->Write8(addr, SLO(mmu_->Read8(addr))); break;
+        case OP_SRE: mmu_->Write8(addr, SRE(mmu_->Read8(addr))); break;
+        case OP_STA: mmu_->Write8(addr, Store(OP_STA)); break;
+        case OP_STX: mmu_->Write8(addr, Store(OP_STX)); break;
+        case OP_STY: mmu_->Write8(addr, Store(OP_STY)); break;
 
         case OP_TAX: TAX();     break;
         case OP_TAY: TAY();     break;
@@ -199,26 +229,82 @@ void Cpu::Step(void) {
         case OP_TXS: TXS();     break;
         case OP_TYA: TYA();     break;
 
+        case OP_INVALID:
+            // JAM: the CPU stays on this opcode but the clock keeps running
+            cycles_ += 2;
+            LOG(CPU, WARN, "Illegal instructions");
+            if (recorder_ != nullptr) {
+                recorder_->OnIllegalOpcode();
+            }
+            break;
+
         default:
-            LOG_DEBUG("Illegal instructions");
+            LOG(CPU, WARN, "Illegal instructions");
             break;
     }
 }
 
-void Cpu::SetPC(uint16_t addr) {
-    reg_.PC = addr;
+bool Cpu::IsTracing(void) const {
+    return trace_ && (trace_sink_ != nullptr || LOG_ENABLED(CPU, TRACE));
 }
 
-inline uint8_t Cpu::GetFlag(int flag) {
-    return (reg_.P & flag) ? 1 : 0;
+void Cpu::Trace(const registers& reg, uint8_t opcode, uint16_t operand, uint64_t cycles) {
+    // implied operands are left undefined by Step
+    static const uint16_t operand_mask[4] = { 0, 0, 0xFF, 0xFFFF };
+    operand &= operand_mask[hot_opcodes.entries[opcode].size & 3];
+    if (trace_sink_ != nullptr) {
+        trace_sink_->OnInstruction(reg, opcode, operand, cycles);
+    }
+    if (LOG_ENABLED(CPU, TRACE)) {
+        LOG(CPU, TRACE, FormatTrace(reg, opcode, operand, cycles));
+    }
 }
 
-inline void Cpu::SetFlag(int flag) {
-    reg_.P |= flag;
+std::string Cpu::FormatTrace(const registers& reg, uint8_t opcode, uint16_t operand,
+                             uint64_t cycles) {
+    const opcode_hot& hot = hot_opcodes.entries[opcode];
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0') << std::uppercase //<< std::hex
+       << std::setw(4) << reg.PC
+       << "  "
+       << std::setw(2) << (int)opcode
+       << " ";
+    if (hot.size > 1) {
+        ss << std::setw(2) << (operand & 0xFF);
+    } else {
+        ss << "  ";
+    }
+    ss << " ";
+    if (hot.size > 2) {
+        ss << std::setw(2) << (operand >> 8);
+    } else {
+        ss << "  ";
+    }
+    ss << "  "
+       << opcode_names[hot.op]
+       << "    "
+       << "A:"    << std::setw(2) << (int)reg.A << " "
+       << "X:"    << std::setw(2) << (int)reg.X << " "
+       << "Y:"    << std::setw(2) << (int)reg.Y << " "
+       << "P:"    << std::setw(2) << (int)reg.P << " "
+       << "SP:"   << std::setw(2) << (int)reg.SP  << " "
+       << "CPUC:" << std::dec << cycles;
+
+    return ss.str();
 }
 
-inline void Cpu::ClearFlag(int flag) {
-    reg_.P &= ~(flag);
+void Cpu::SetPC(uint16_t addr) {
+    reg_.PC = addr;
+}
+
+void Cpu::SaveState(cpu_state* state) const {
+    state->reg = reg_;
+    state->cycles = cycles_;
+}
+
+void Cpu::LoadState(const cpu_state* state) {
+    reg_ = state->reg;
+    cycles_ = state->cycles;
 }
 
 void Cpu::Push8(uint8_t val) {
@@ -293,9 +379,90 @@ void Cpu::Compare(uint8_t a, uint8_t b) {
     }
 }
 
+bool Cpu::IsBranchTaken(opcode op) {
+    switch (op) {
+        case OP_BCC: return !GetFlag(F_CARRY);
+        case OP_BCS: return GetFlag(F_CARRY);
+        case OP_BEQ: return GetFlag(F_ZERO);
+        case OP_BMI: return GetFlag(F_NEGATIVE);
+        case OP_BNE: return !GetFlag(F_ZERO);
+        case OP_BPL: return !GetFlag(F_NEGATIVE);
+        case OP_BVC: return !GetFlag(F_OVERFLOW);
+        case OP_BVS: return GetFlag(F_OVERFLOW);
+        default:     return false;
+    }
+}
 
-void Cpu::ADC(uint16_t addr) {
-    uint8_t val = mmu_->Read8(addr);
+void Cpu::SetPulledFlags(uint8_t val) {
+    reg_.P = (reg_.P & (F_BH | F_BL)) |
+             (val & ~(F_BH | F_BL));
+}
+
+void Cpu::Execute(opcode op, uint8_t val) {
+    switch (op) {
+        case OP_ADC: ADC(val); break;
+        case OP_AND: AND(val); break;
+        case OP_BIT: BIT(val); break;
+        case OP_CLC: CLC();    break;
+        case OP_CLD: CLD();    break;
+        case OP_CLI: CLI();    break;
+        case OP_CLV: CLV();    break;
+        case OP_CMP: CMP(val); break;
+        case OP_CPX: CPX(val); break;
+        case OP_CPY: CPY(val); break;
+        case OP_DEX: DEX();    break;
+        case OP_DEY: DEY();    break;
+        case OP_EOR: EOR(val); break;
+        case OP_INX: INX();    break;
+        case OP_INY: INY();    break;
+        case OP_LAX: LAX(val); break;
+        case OP_LDA: LDA(val); break;
+        case OP_LDX: LDX(val); break;
+        case OP_LDY: LDY(val); break;
+        case OP_ORA: ORA(val); break;
+        case OP_SBC: SBC(val); break;
+        case OP_SEC: SEC();    break;
+        case OP_SED: SED();    break;
+        case OP_SEI: SEI();    break;
+        case OP_TAX: TAX();    break;
+        case OP_TAY: TAY();    break;
+        case OP_TSX: TSX();    break;
+        case OP_TXA: TXA();    break;
+        case OP_TXS: TXS();    break;
+        case OP_TYA: TYA();    break;
+        default:               break;
+    }
+}
+
+uint8_t Cpu::Modify(opcode op, uint8_t val) {
+    switch (op) {
+        case OP_ASL: return ASL(val);
+        case OP_DCP: return DCP(val);
+        case OP_DEC: return DEC(val);
+        case OP_INC: return INC(val);
+        case OP_ISB: return ISB(val);
+        case OP_LSR: return LSR(val);
+        case OP_RLA: return RLA(val);
+        case OP_ROL: return ROL(val);
+        case OP_ROR: return ROR(val);
+        case OP_RRA: return RRA(val);
+        case OP_SLO: return SLO(val);
+        case OP_SRE: return SRE(val);
+        default:     return val;
+    }
+}
+
+uint8_t Cpu::Store(opcode op) const {
+    switch (op) {
+        case OP_SAX: return reg_.A & reg_.X;
+        case OP_STX: return reg_.X;
+        case OP_STY: return reg_.Y;
+        default:     return reg_.A;
+    }
+}
+
+
+void Cpu::ADC(uint8_t val) {
     uint16_t sum = reg_.A + val + GetFlag(F_CARRY);
     uint8_t bit7_carry = ((reg_.A & 0x7F) + (val & 0x7F) + GetFlag(F_CARRY)) & 0x80 ? 1 : 0;
 
@@ -313,48 +480,24 @@ void Cpu::ADC(uint16_t addr) {
     }
 }
 
-void Cpu::AND(uint16_t addr) {
-    reg_.A &= mmu_->Read16(addr);
+void Cpu::AND(uint8_t val) {
+    reg_.A &= val;
     SetNZFlag(reg_.A);
 }
 
-void Cpu::ASL(uint16_t addr) {
-    if (mode_ == MODE_ACCUMULATOR) {
-        if (reg_.A & 0x80) {
-            SetFlag(F_CARRY);
-        } else {
-            ClearFlag(F_CARRY);
-        }
-        reg_.A <<= 1;
-        SetNZFlag(reg_.A);
+uint8_t Cpu::ASL(uint8_t val) {
+    if (val & 0x80) {
+        SetFlag(F_CARRY);
     } else {
-        uint8_t val = mmu_->Read8(addr);
-        if (val & 0x80) {
-            SetFlag(F_CARRY);
-        } else {
-            ClearFlag(F_CARRY);
-        }
-        val <<= 1;
-        mmu_->Write8(addr, val);
-        SetNZFlag(val);
+        ClearFlag(F_CARRY);
     }
+    val <<= 1;
+    SetNZFlag(val);
+    return val;
 }
 
 
-void Cpu::BCC(int8_t offset) {
-    Branch(offset, !GetFlag(F_CARRY));
-}
-
-void Cpu::BCS(int8_t offset) {
-    Branch(offset, GetFlag(F_CARRY));
-}
-
-void Cpu::BEQ(int8_t offset) {
-    Branch(offset, GetFlag(F_ZERO));
-}
-
-void Cpu::BIT(uint16_t addr) {
-    uint8_t val = mmu_->Read8(addr);
+void Cpu::BIT(uint8_t val) {
     SetNFlag(val);
     if (val & 0x40) {
         SetFlag(F_OVERFLOW);
@@ -364,24 +507,12 @@ void Cpu::BIT(uint16_t addr) {
     SetZFlag(val & reg_.A);
 }
 
-void Cpu::BMI(int8_t offset) {
-    Branch(offset, GetFlag(F_NEGATIVE));
-}
-
-void Cpu::BNE(int8_t offset) {
-    Branch(offset, !GetFlag(F_ZERO));
-}
-
-void Cpu::BPL(int8_t offset) {
-    Branch(offset, !GetFlag(F_NEGATIVE));
-}
-
-void Cpu::BVC(int8_t offset) {
-    Branch(offset, !GetFlag(F_OVERFLOW));
-}
-
-void Cpu::BVS(int8_t offset) {
-    Branch(offset, GetFlag(F_OVERFLOW));
+void Cpu::BRK(void) {
+    // the return address skips BRK's padding byte
+    Push16(reg_.PC + 1);
+    Push8(GetPushedFlags());
+    SetFlag(F_INT_DISABLE);
+    reg_.PC = mmu_->Read16(0xFFFE);
 }
 
 
@@ -393,38 +524,37 @@ void Cpu::CLD(void) {
     ClearFlag(F_DECIMAL);
 }
 
+void Cpu::CLI(void) {
+    ClearFlag(F_INT_DISABLE);
+}
+
 void Cpu::CLV(void) {
     ClearFlag(F_OVERFLOW);
 }
 
-void Cpu::CMP(uint16_t addr) {
-    uint8_t val = mmu_->Read8(addr);
+void Cpu::CMP(uint8_t val) {
     Compare(reg_.A, val);
 }
 
-void Cpu::CPX(uint16_t addr) {
-    uint8_t val = mmu_->Read8(addr);
+void Cpu::CPX(uint8_t val) {
     Compare(reg_.X, val);
 }
 
-void Cpu::CPY(uint16_t addr) {
-    uint8_t val = mmu_->Read8(addr);
+void Cpu::CPY(uint8_t val) {
     Compare(reg_.Y, val);
 }
 
 
-void Cpu::DCP(uint16_t addr) {
+uint8_t Cpu::DCP(uint8_t val) {
     // DEC + CMP
-    uint8_t val = mmu_->Read8(addr);
     --val;
-    mmu_->Write8(addr, val);
     Compare(reg_.A, val);
+    return val;
 }
 
-void Cpu::DEC(uint16_t addr) {
-    uint8_t val = mmu_->Read8(addr) - 1;
-    mmu_->Write8(addr, val);
-    SetNZFlag(val);
+uint8_t Cpu::DEC(uint8_t val) {
+    SetNZFlag(--val);
+    return val;
 }
 
 void Cpu::DEX(void) {
@@ -436,16 +566,15 @@ void Cpu::DEY(void) {
 }
 
 
-void Cpu::EOR(uint16_t addr) {
-    reg_.A ^= mmu_->Read8(addr);
+void Cpu::EOR(uint8_t val) {
+    reg_.A ^= val;
     SetNZFlag(reg_.A);
 }
 
 
-void Cpu::INC(uint16_t addr) {
-    uint8_t val = mmu_->Read8(addr) + 1;
-    mmu_->Write8(addr, val);
-    SetNZFlag(val);
+uint8_t Cpu::INC(uint8_t val) {
+    SetNZFlag(++val);
+    return val;
 }
 
 void Cpu::INX(void) {
@@ -456,11 +585,11 @@ void Cpu::INY(void) {
     SetNZFlag(++reg_.Y);
 }
 
-void Cpu::ISB(uint16_t addr) {
+uint8_t Cpu::ISB(uint8_t val) {
     // INC + SBC
-    uint8_t val = mmu_->Read8(addr) + 1;
-    mmu_->Write8(addr, val);
-    SBC(addr);
+    ++val;
+    SBC(val);
+    return val;
 }
 
 
@@ -469,59 +598,53 @@ void Cpu::JMP(uint16_t addr) {
 }
 
 void Cpu::JSR(uint16_t addr) {
-    Push16(reg_.PC - 1);
+    uint16_t hi = reg_.PC - 1;
+    Push16(hi);
+    // the high byte is fetched after the pushes, which overwrite it when
+    // code in RAM overlaps the stack
+    if (hi < 0x2000) {
+        addr = (addr & 0xFF) | (mmu_->Read8(hi) << 8);
+    }
     reg_.PC = addr;
 }
 
 
-void Cpu::LAX(uint16_t addr) {
-    // LAX + LDX
-    uint8_t val = mmu_->Read8(addr);
+void Cpu::LAX(uint8_t val) {
+    // LDA + LDX
     reg_.A = val;
     reg_.X = val;
     SetNZFlag(val);
 }
 
-void Cpu::LDA(uint16_t addr) {
-    reg_.A = mmu_->Read8(addr);
+void Cpu::LDA(uint8_t val) {
+    reg_.A = val;
     SetNZFlag(reg_.A);
 }
 
-void Cpu::LDX(uint16_t addr) {
-    reg_.X = mmu_->Read8(addr);
+void Cpu::LDX(uint8_t val) {
+    reg_.X = val;
     SetNZFlag(reg_.X);
 }
 
-void Cpu::LDY(uint16_t addr) {
-    reg_.Y = mmu_->Read8(addr);
+void Cpu::LDY(uint8_t val) {
+    reg_.Y = val;
     SetNZFlag(reg_.Y);
 }
 
-void Cpu::LSR(uint16_t addr) {
-    if (mode_ == MODE_ACCUMULATOR) {
-        if (reg_.A & 0x01) {
-            SetFlag(F_CARRY);
-        } else {
-            ClearFlag(F_CARRY);
-        }
-        reg_.A >>= 1;
-        SetNZFlag(reg_.A);
+uint8_t Cpu::LSR(uint8_t val) {
+    if (val & 0x01) {
+        SetFlag(F_CARRY);
     } else {
-        uint8_t val = mmu_->Read8(addr);
-        if (val & 0x01) {
-            SetFlag(F_CARRY);
-        } else {
-            ClearFlag(F_CARRY);
-        }
-        val >>= 1;
-        mmu_->Write8(addr, val);
-        SetNZFlag(val);
+        ClearFlag(F_CARRY);
     }
+    val >>= 1;
+    SetNZFlag(val);
+    return val;
 }
 
 
-void Cpu::ORA(uint16_t addr) {
-    reg_.A |= mmu_->Read8(addr);
+void Cpu::ORA(uint8_t val) {
+    reg_.A |= val;
     SetNZFlag(reg_.A);
 }
 
@@ -531,79 +654,59 @@ void Cpu::PHA(void) {
 }
 
 void Cpu::PHP(void) {
-    Push8(reg_.P | F_BH | F_BL);
+    Push8(GetPushedFlags());
 }
 
-void Cpu::PLA(void) {
-    reg_.A = Pop8();
+void Cpu::PLA(uint8_t val) {
+    reg_.A = val;
     SetNZFlag(reg_.A);
 }
 
-void Cpu::PLP(void) {
-    reg_.P = (reg_.P & (F_BH | F_BL)) |
-             (Pop8() & ~(F_BH | F_BL));
+void Cpu::PLP(uint8_t val) {
+    SetPulledFlags(val);
 }
 
 
-void Cpu::RLA(uint16_t addr) {
-    ROL(addr);
-    AND(addr);
+uint8_t Cpu::RLA(uint8_t val) {
+    // ROL + AND
+    val = ROL(val);
+    AND(val);
+    return val;
 }
 
-void Cpu::ROL(uint16_t addr) {
+uint8_t Cpu::ROL(uint8_t val) {
     uint8_t c = GetFlag(F_CARRY);
-    if (mode_ == MODE_ACCUMULATOR) {
-        if (reg_.A & 0x80) {
-            SetFlag(F_CARRY);
-        } else {
-            ClearFlag(F_CARRY);
-        }
-        reg_.A = (reg_.A << 1) | c;
-        SetNZFlag(reg_.A);
+    if (val & 0x80) {
+        SetFlag(F_CARRY);
     } else {
-        uint8_t val = mmu_->Read8(addr);
-        if (val & 0x80) {
-            SetFlag(F_CARRY);
-        } else {
-            ClearFlag(F_CARRY);
-        }
-        val = (val << 1) | c;
-        mmu_->Write8(addr, val);
-        SetNZFlag(val);
+        ClearFlag(F_CARRY);
     }
+    val = (val << 1) | c;
+    SetNZFlag(val);
+    return val;
 }
 
-void Cpu::ROR(uint16_t addr) {
+uint8_t Cpu::ROR(uint8_t val) {
     uint8_t c = GetFlag(F_CARRY);
-    if (mode_ == MODE_ACCUMULATOR) {
-        if (reg_.A & 0x01) {
-            SetFlag(F_CARRY);
-        } else {
-            ClearFlag(F_CARRY);
-        }
-        reg_.A = (c << 7) | (reg_.A >> 1);
-        SetNZFlag(reg_.A);
+    if (val & 0x01) {
+        SetFlag(F_CARRY);
     } else {
-        uint8_t val = mmu_->Read8(addr);
-        if (val & 0x01) {
-            SetFlag(F_CARRY);
-        } else {
-            ClearFlag(F_CARRY);
-        }
-        val = (c << 7) | (val >> 1);
-        mmu_->Write8(addr, val);
-        SetNZFlag(val);
+        ClearFlag(F_CARRY);
     }
+    val = (c << 7) | (val >> 1);
+    SetNZFlag(val);
+    return val;
 }
 
-void Cpu::RRA(uint16_t addr) {
-    ROR(addr);
-    ADC(addr);
+uint8_t Cpu::RRA(uint8_t val) {
+    // ROR + ADC
+    val = ROR(val);
+    ADC(val);
+    return val;
 }
 
 void Cpu::RTI(void) {
-    reg_.P = (reg_.P & (F_BH | F_BL)) |
-             (Pop8() & ~(F_BH | F_BL));
+    SetPulledFlags(Pop8());
     reg_.PC = Pop16();
 }
 
@@ -612,27 +715,8 @@ void Cpu::RTS(void) {
 }
 
 
-void Cpu::SAX(uint16_t addr) {
-    mmu_->Write8(addr, reg_.A & reg_.X);
-}
-
-void Cpu::SBC(uint16_t addr) {
-    uint8_t val = ~mmu_->Read8(addr);
-    uint16_t sum = reg_.A + val + GetFlag(F_CARRY);
-    uint8_t bit7_carry = ((reg_.A & 0x7F) + (val & 0x7F) + GetFlag(F_CARRY)) & 0x80 ? 1 : 0;
-
-    reg_.A = sum;
-    SetNZFlag(reg_.A);
-    if (sum > 255) {
-        SetFlag(F_CARRY);
-    } else {
-        ClearFlag(F_CARRY);
-    }
-    if (bit7_carry ^ GetFlag(F_CARRY)) {
-        SetFlag(F_OVERFLOW);
-    } else {
-        ClearFlag(F_OVERFLOW);
-    }
+void Cpu::SBC(uint8_t val) {
+    ADC(~val);
 }
 
 void Cpu::SEC(void) {
@@ -647,30 +731,21 @@ void Cpu::SEI(void) {
     SetFlag(F_INT_DISABLE);
 }
 
-void Cpu::SLO(uint16_t addr) {
-    ASL(addr);
-    ORA(addr);
+uint8_t Cpu::SLO(uint8_t val) {
+    // ASL + ORA
+    val = ASL(val);
+    ORA(val);
+    return val;
 }
 
-void Cpu::SRE(uint16_t addr) {
-    LSR(addr);
-    EOR(addr);
-}
-
-void Cpu::STA(uint16_t addr) {
-    mmu_->Write8(addr, reg_.A);
-}
-
-void Cpu::STX(uint16_t addr) {
-    mmu_->Write8(addr, reg_.X);
-}
-
-void Cpu::STY(uint16_t addr) {
-    mmu_->Write8(addr, reg_.Y);
+uint8_t Cpu::SRE(uint8_t val) {
+    // LSR + EOR
+    val = LSR(val);
+    EOR(val);
+    return val;
 }
 
 
-
 void Cpu::TAX(void) {
     reg_.X = reg_.A;
     SetNZFlag(reg_.X);
@@ -700,276 +775,14 @@ void Cpu::TYA(void) {
     SetNZFlag(reg_.A);
 }
 
-const Cpu::opcode_t Cpu::opcode_table_[256] = {
-    /* 0x00 */ { OP_BRK,     "BRK",            MODE_IMPLIED,            1, 7, 0 },
-    /* 0x01 */ { OP_ORA,     "ORA",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0x02 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x03 */ { OP_SLO,     "SLO",            MODE_X_INDEXED_INDIRECT, 2, 8, 0 },
-    /* 0x04 */ { OP_NOP,     "NOP",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x05 */ { OP_ORA,     "ORA",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x06 */ { OP_ASL,     "ASL",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0x07 */ { OP_SLO,     "SLO",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0x08 */ { OP_PHP,     "PHP",            MODE_IMPLIED,            1, 3, 0 },
-    /* 0x09 */ { OP_ORA,     "ORA",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0x0A */ { OP_ASL,     "ASL",            MODE_ACCUMULATOR,        1, 2, 0 },
-    /* 0x0B */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x0C */ { OP_NOP,     "NOP",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0x0D */ { OP_ORA,     "ORA",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0x0E */ { OP_ASL,     "ASL",            MODE_ABSOLUTE,           3, 6, 0 },
-    /* 0x0F */ { OP_SLO,     "SLO",            MODE_ABSOLUTE,           3, 6, 0 },
-
-    /* 0x10 */ { OP_BPL,     "BPL",            MODE_RELATIVE,           2, 2, 1 },
-    /* 0x11 */ { OP_ORA,     "ORA",            MODE_INDIRECT_Y_INDEXED, 2, 5, 1 },
-    /* 0x12 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x13 */ { OP_SLO,     "SLO",            MODE_INDIRECT_Y_INDEXED, 2, 8, 0 },
-    /* 0x14 */ { OP_NOP,     "NOP",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x15 */ { OP_ORA,     "ORA",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x16 */ { OP_ASL,     "ASL",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0x17 */ { OP_SLO,     "SLO",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0x18 */ { OP_CLC,     "CLC",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x19 */ { OP_ORA,     "ORA",            MODE_ABSOLUTE_Y_INDEXED, 3, 4, 1 },
-    /* 0x1A */ { OP_NOP,     "NOP",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x1B */ { OP_SLO,     "SLO",            MODE_ABSOLUTE_Y_INDEXED, 3, 7, 0 },
-    /* 0x1C */ { OP_NOP,     "NOP",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0x1D */ { OP_ORA,     "ORA",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0x1E */ { OP_ASL,     "ASL",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-    /* 0x1F */ { OP_SLO,     "SLO",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-
-    /* 0x20 */ { OP_JSR,     "JSR",            MODE_ABSOLUTE,           3, 6, 0 },
-    /* 0x21 */ { OP_AND,     "AND",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0x22 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x23 */ { OP_RLA,     "RLA",            MODE_X_INDEXED_INDIRECT, 2, 8, 0 },
-    /* 0x24 */ { OP_BIT,     "BIT",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x25 */ { OP_AND,     "AND",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x26 */ { OP_ROL,     "ROL",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0x27 */ { OP_RLA,     "RLA",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0x28 */ { OP_PLP,     "PLP",            MODE_IMPLIED,            1, 4, 0 },
-    /* 0x29 */ { OP_AND,     "AND",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0x2A */ { OP_ROL,     "ROL",            MODE_ACCUMULATOR,        1, 2, 0 },
-    /* 0x2B */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x2C */ { OP_BIT,     "BIT",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0x2D */ { OP_AND,     "AND",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0x2E */ { OP_ROL,     "ROL",            MODE_ABSOLUTE,           3, 6, 0 },
-    /* 0x2F */ { OP_RLA,     "RLA",            MODE_ABSOLUTE,           3, 6, 0 },
-
-    /* 0x30 */ { OP_BMI,     "BMI",            MODE_RELATIVE,           2, 2, 1 },
-    /* 0x31 */ { OP_AND,     "AND",            MODE_INDIRECT_Y_INDEXED, 2, 5, 1 },
-    /* 0x32 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x33 */ { OP_RLA,     "RLA",            MODE_INDIRECT_Y_INDEXED, 2, 8, 0 },
-    /* 0x34 */ { OP_NOP,     "NOP",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x35 */ { OP_AND,     "AND",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x36 */ { OP_ROL,     "ROL",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0x37 */ { OP_RLA,     "RLA",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0x38 */ { OP_SEC,     "SEC",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x39 */ { OP_AND,     "AND",            MODE_ABSOLUTE_Y_INDEXED, 3, 4, 1 },
-    /* 0x3A */ { OP_NOP,     "NOP",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x3B */ { OP_RLA,     "RLA",            MODE_ABSOLUTE_Y_INDEXED, 3, 7, 0 },
-    /* 0x3C */ { OP_NOP,     "NOP",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0x3D */ { OP_AND,     "AND",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0x3E */ { OP_ROL,     "ROL",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-    /* 0x3F */ { OP_RLA,     "RLA",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-
-    /* 0x40 */ { OP_RTI,     "RTI",            MODE_IMPLIED,            1, 6, 0 },
-    /* 0x41 */ { OP_EOR,     "EOR",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0x42 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x43 */ { OP_SRE,     "SRE",            MODE_X_INDEXED_INDIRECT, 2, 8, 0 },
-    /* 0x44 */ { OP_NOP,     "NOP",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x45 */ { OP_EOR,     "EOR",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x46 */ { OP_LSR,     "LSR",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0x47 */ { OP_SRE,     "SRE",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0x48 */ { OP_PHA,     "PHA",            MODE_IMPLIED,            1, 3, 0 },
-    /* 0x49 */ { OP_EOR,     "EOR",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0x4A */ { OP_LSR,     "LSR",            MODE_ACCUMULATOR,        1, 2, 0 },
-    /* 0x4B */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x4C */ { OP_JMP,     "JMP",            MODE_ABSOLUTE,           3, 3, 0 },
-    /* 0x4D */ { OP_EOR,     "EOR",            MODE_ABSOLUTE,           3, 4, 0},
-    /* 0x4E */ { OP_LSR,     "LSR",            MODE_ABSOLUTE,           3, 6, 0 },
-    /* 0x4F */ { OP_SRE,     "SRE",            MODE_ABSOLUTE,           3, 6, 0 },
-
-    /* 0x50 */ { OP_BVC,     "BVC",            MODE_RELATIVE,           2, 2, 1 },
-    /* 0x51 */ { OP_EOR,     "EOR",            MODE_INDIRECT_Y_INDEXED, 2, 5, 1 },
-    /* 0x52 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x53 */ { OP_SRE,     "SRE",            MODE_INDIRECT_Y_INDEXED, 2, 8, 0 },
-    /* 0x54 */ { OP_NOP,     "NOP",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x55 */ { OP_EOR,     "EOR",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x56 */ { OP_LSR,     "LSR",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0x57 */ { OP_SRE,     "SRE",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0x58 */ { OP_CLI,     "CLI",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x59 */ { OP_EOR,     "EOR",            MODE_ABSOLUTE_Y_INDEXED, 3, 4, 1 },
-    /* 0x5A */ { OP_NOP,     "NOP",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x5B */ { OP_SRE,     "SRE",            MODE_ABSOLUTE_Y_INDEXED, 3, 7, 0 },
-    /* 0x5C */ { OP_NOP,     "NOP",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0x5D */ { OP_EOR,     "EOR",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0x5E */ { OP_LSR,     "LSR",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-    /* 0x5F */ { OP_SRE,     "SRE",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-
-    /* 0x60 */ { OP_RTS,     "RTS",            MODE_IMPLIED,            1, 6, 0 },
-    /* 0x61 */ { OP_ADC,     "ADC",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0x62 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x63 */ { OP_RRA,     "RRA",            MODE_X_INDEXED_INDIRECT, 2, 8, 0 },
-    /* 0x64 */ { OP_NOP,     "NOP",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x65 */ { OP_ADC,     "ADC",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x66 */ { OP_ROR,     "ROR",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0x67 */ { OP_RRA,     "RRA",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0x68 */ { OP_PLA,     "PLA",            MODE_IMPLIED,            1, 4, 0 },
-    /* 0x69 */ { OP_ADC,     "ADC",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0x6A */ { OP_ROR,     "ROR",            MODE_ACCUMULATOR,        1, 2, 0 },
-    /* 0x6B */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x6C */ { OP_JMP,     "JMP",            MODE_INDIRECT,           3, 5, 0 },
-    /* 0x6D */ { OP_ADC,     "ADC",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0x6E */ { OP_ROR,     "ROR",            MODE_ABSOLUTE,           3, 6, 0 },
-    /* 0x6F */ { OP_RRA,     "RRA",            MODE_ABSOLUTE,           3, 6, 0 },
-
-    /* 0x70 */ { OP_BVS,     "BVS",            MODE_RELATIVE,           2, 2, 1 },
-    /* 0x71 */ { OP_ADC,     "ADC",            MODE_INDIRECT_Y_INDEXED, 2, 5, 1 },
-    /* 0x72 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x73 */ { OP_RRA,     "RRA",            MODE_INDIRECT_Y_INDEXED, 2, 8, 0 },
-    /* 0x74 */ { OP_NOP,     "NOP",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x75 */ { OP_ADC,     "ADC",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x76 */ { OP_ROR,     "ROR",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0x77 */ { OP_RRA,     "RRA",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0x78 */ { OP_SEI,     "SEI",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x79 */ { OP_ADC,     "ADC",            MODE_ABSOLUTE_Y_INDEXED, 3, 4, 1 },
-    /* 0x7A */ { OP_NOP,     "NOP",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x7B */ { OP_RRA,     "RRA",            MODE_ABSOLUTE_Y_INDEXED, 3, 7, 0 },
-    /* 0x7C */ { OP_NOP,     "NOP",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0x7D */ { OP_ADC,     "ADC",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0x7E */ { OP_ROR,     "ROR",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-    /* 0x7F */ { OP_RRA,     "RRA",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-
-    /* 0x80 */ { OP_NOP,     "NOP",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0x81 */ { OP_STA,     "STA",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0x82 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x83 */ { OP_SAX,     "SAX",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0x84 */ { OP_STY,     "STY",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x85 */ { OP_STA,     "STA",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x86 */ { OP_STX,     "STX",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x87 */ { OP_SAX,     "SAX",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0x88 */ { OP_DEY,     "DEY",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x89 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x8A */ { OP_TXA,     "TXA",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x8B */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x8C */ { OP_STY,     "STY",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0x8D */ { OP_STA,     "STA",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0x8E */ { OP_STX,     "STX",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0x8F */ { OP_SAX,     "SAX",            MODE_ABSOLUTE,           3, 4, 0 },
-
-    /* 0x90 */ { OP_BCC,     "BCC",            MODE_RELATIVE,           2, 2, 1 },
-    /* 0x91 */ { OP_STA,     "STA",            MODE_INDIRECT_Y_INDEXED, 2, 6, 0 },
-    /* 0x92 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x93 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x94 */ { OP_STY,     "STY",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x95 */ { OP_STA,     "STA",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0x96 */ { OP_STX,     "STX",            MODE_ZEROPAGE_Y_INDEXED, 2, 4, 0 },
-    /* 0x97 */ { OP_SAX,     "SAX",            MODE_ZEROPAGE_Y_INDEXED, 2, 4, 0 },
-    /* 0x98 */ { OP_TYA,     "TYA",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x99 */ { OP_STA,     "STA",            MODE_ABSOLUTE_Y_INDEXED, 3, 5, 0 },
-    /* 0x9A */ { OP_TXS,     "TXS",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0x9B */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x9C */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x9D */ { OP_STA,     "STA",            MODE_ABSOLUTE_X_INDEXED, 3, 5, 0 },
-    /* 0x9E */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0x9F */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-
-    /* 0xA0 */ { OP_LDY,     "LDY",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0xA1 */ { OP_LDA,     "LDA",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0xA2 */ { OP_LDX,     "LDX",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0xA3 */ { OP_LAX,     "LAX",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0xA4 */ { OP_LDY,     "LDY",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0xA5 */ { OP_LDA,     "LDA",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0xA6 */ { OP_LDX,     "LDX",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0xA7 */ { OP_LAX,     "LAX",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0xA8 */ { OP_TAY,     "TAY",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xA9 */ { OP_LDA,     "LDA",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0xAA */ { OP_TAX,     "TAX",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xAB */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0xAC */ { OP_LDY,     "LDY",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0xAD */ { OP_LDA,     "LDA",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0xAE */ { OP_LDX,     "LDX",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0xAF */ { OP_LAX,     "LAX",            MODE_ABSOLUTE,           3, 4, 0 },
-
-    /* 0xB0 */ { OP_BCS,     "BCS",            MODE_RELATIVE,           2, 2, 1 },
-    /* 0xB1 */ { OP_LDA,     "LDA",            MODE_INDIRECT_Y_INDEXED, 2, 5, 1 },
-    /* 0xB2 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0xB3 */ { OP_LAX,     "LAX",            MODE_INDIRECT_Y_INDEXED, 2, 5, 1 },
-    /* 0xB4 */ { OP_LDY,     "LDY",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0xB5 */ { OP_LDA,     "LDA",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0xB6 */ { OP_LDX,     "LDX",            MODE_ZEROPAGE_Y_INDEXED, 2, 4, 0 },
-    /* 0xB7 */ { OP_LAX,     "LAX",            MODE_ZEROPAGE_Y_INDEXED, 2, 4, 0},
-    /* 0xB8 */ { OP_CLV,     "CLV",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xB9 */ { OP_LDA,     "LDA",            MODE_ABSOLUTE_Y_INDEXED, 3, 4, 1 },
-    /* 0xBA */ { OP_TSX,     "TSX",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xBB */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 1 },
-    /* 0xBC */ { OP_LDY,     "LDY",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0xBD */ { OP_LDA,     "LDA",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0xBE */ { OP_LDX,     "LDX",            MODE_ABSOLUTE_Y_INDEXED, 3, 4, 1 },
-    /* 0xBF */ { OP_LAX,     "LAX",            MODE_ABSOLUTE_Y_INDEXED, 3, 4, 1 },
-
-    /* 0xC0 */ { OP_CPY,     "CPY",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0xC1 */ { OP_CMP,     "CMP",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0xC2 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0xC3 */ { OP_DCP,     "DCP",            MODE_X_INDEXED_INDIRECT, 2, 8, 0 },
-    /* 0xC4 */ { OP_CPY,     "CPY",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0xC5 */ { OP_CMP,     "CMP",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0xC6 */ { OP_DEC,     "DEC",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0xC7 */ { OP_DCP,     "DCP",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0xC8 */ { OP_INY,     "INY",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xC9 */ { OP_CMP,     "CMP",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0xCA */ { OP_DEX,     "DEX",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xCB */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0xCC */ { OP_CPY,     "CPY",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0xCD */ { OP_CMP,     "CMP",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0xCE */ { OP_DEC,     "DEC",            MODE_ABSOLUTE,           3, 6, 0 },
-    /* 0xCF */ { OP_DCP,     "DCP",            MODE_ABSOLUTE,           3, 6, 0 },
-
-    /* 0xD0 */ { OP_BNE,     "BNE",            MODE_RELATIVE,           2, 2, 1 },
-    /* 0xD1 */ { OP_CMP,     "CMP",            MODE_INDIRECT_Y_INDEXED, 2, 5, 1 },
-    /* 0xD2 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0xD3 */ { OP_DCP,     "DCP",            MODE_INDIRECT_Y_INDEXED, 2, 8, 0 },
-    /* 0xD4 */ { OP_NOP,     "NOP",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0xD5 */ { OP_CMP,     "CMP",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0xD6 */ { OP_DEC,     "DEC",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0xD7 */ { OP_DCP,     "DCP",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0xD8 */ { OP_CLD,     "CLD",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xD9 */ { OP_CMP,     "CMP",            MODE_ABSOLUTE_Y_INDEXED, 3, 4, 1 },
-    /* 0xDA */ { OP_NOP,     "NOP",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xDB */ { OP_DCP,     "DCP",            MODE_ABSOLUTE_Y_INDEXED, 3, 7, 0 },
-    /* 0xDC */ { OP_NOP,     "NOP",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0xDD */ { OP_CMP,     "CMP",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0xDE */ { OP_DEC,     "DEC",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-    /* 0xDF */ { OP_DCP,     "DCP",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-
-    /* 0xE0 */ { OP_CPX,     "CPX",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0xE1 */ { OP_SBC,     "SBC",            MODE_X_INDEXED_INDIRECT, 2, 6, 0 },
-    /* 0xE2 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0xE3 */ { OP_ISB,     "ISB",            MODE_X_INDEXED_INDIRECT, 2, 8, 0 },
-    /* 0xE4 */ { OP_CPX,     "CPX",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0xE5 */ { OP_SBC,     "SBC",            MODE_ZEROPAGE,           2, 3, 0 },
-    /* 0xE6 */ { OP_INC,     "INC",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0xE7 */ { OP_ISB,     "ISB",            MODE_ZEROPAGE,           2, 5, 0 },
-    /* 0xE8 */ { OP_INX,     "INX",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xE9 */ { OP_SBC,     "SBC",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0xEA */ { OP_NOP,     "NOP",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xEB */ { OP_SBC,     "SBC",            MODE_IMMEDIATE,          2, 2, 0 },
-    /* 0xEC */ { OP_CPX,     "CPX",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0xED */ { OP_SBC,     "SBC",            MODE_ABSOLUTE,           3, 4, 0 },
-    /* 0xEE */ { OP_INC,     "INC",            MODE_ABSOLUTE,           3, 6, 0 },
-    /* 0xEF */ { OP_ISB,     "ISB",            MODE_ABSOLUTE,           3, 6, 0 },
-
-    /* 0xF0 */ { OP_BEQ,     "BEQ",            MODE_RELATIVE,           2, 2, 1 },
-    /* 0xF1 */ { OP_SBC,     "SBC",            MODE_INDIRECT_Y_INDEXED, 2, 5, 1 },
-    /* 0xF2 */ { OP_INVALID, "INVALID OPCODE", MODE_INVALID,            0, 0, 0 },
-    /* 0xF3 */ { OP_ISB,     "ISB",            MODE_INDIRECT_Y_INDEXED, 2, 8, 0 },
-    /* 0xF4 */ { OP_NOP,     "NOP",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0xF5 */ { OP_SBC,     "SBC",            MODE_ZEROPAGE_X_INDEXED, 2, 4, 0 },
-    /* 0xF6 */ { OP_INC,     "INC",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0xF7 */ { OP_ISB,     "ISB",            MODE_ZEROPAGE_X_INDEXED, 2, 6, 0 },
-    /* 0xF8 */ { OP_SED,     "SED",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xF9 */ { OP_SBC,     "SBC",            MODE_ABSOLUTE_Y_INDEXED, 3, 4, 1 },
-    /* 0xFA */ { OP_NOP,     "NOP",            MODE_IMPLIED,            1, 2, 0 },
-    /* 0xFB */ { OP_ISB,     "ISB",            MODE_ABSOLUTE_Y_INDEXED, 3, 7, 0 },
-    /* 0xFC */ { OP_NOP,     "NOP",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0xFD */ { OP_SBC,     "SBC",            MODE_ABSOLUTE_X_INDEXED, 3, 4, 1 },
-    /* 0xFE */ { OP_INC,     "INC",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 },
-    /* 0xFF */ { OP_ISB,     "ISB",            MODE_ABSOLUTE_X_INDEXED, 3, 7, 0 }
-};
+Cpu::opcode_t Cpu::GetOpcode(uint8_t opcode) {
+    const opcode_hot& hot = hot_opcodes.entries[opcode];
+    opcode_t op;
+    op.op = (enum opcode)hot.op;
+    op.name = opcode_names[hot.op];
+    op.mode = (addr_mode)hot.mode;
+    op.size = hot.size;
+    op.cycles = hot.cycles & OPC_CYCLES_MASK;
+    op.pagecrossed_cycles = hot.cycles >> OPC_PENALTY_SHIFT;
+    return op;
+}
@@ -2,9 +2,14 @@
 #define _CPU_H
 
 #include <cstdint>
+#include <string>
 
 class Nes;
 class Mmu;
+class Debugger;
+class CodeDataLogger;
+class ITraceSink;
+class FlightRecorder;
 
 typedef struct {
     uint8_t A;
@@ -15,6 +20,11 @@ typedef struct {
     uint8_t P;
 } registers;
 
+typedef struct {
+    registers reg;
+    uint64_t cycles;
+} cpu_state;
+
 class Cpu {
 public:
     enum status_flag {
@@ -71,7 +81,7 @@ public:
         int         pagecrossed_cycles;
     } opcode_t;
 
-    Cpu(Nes* nes, Mmu* mmu);
+    Cpu(Nes* nes, Mmu* mmu, Debugger* debugger);
     ~Cpu() = default;
 
     void PowerOn(void);
@@ -79,19 +89,57 @@ public:
     void Step(void);
 
     void SetPC(uint16_t addr);
-
-    uint8_t GetFlag(int flag);
-    void SetFlag(int flag);
-    void ClearFlag(int flag);
+    const registers& GetRegisters(void) const { return reg_; }
+    // Address of the instruction being executed.
+    uint16_t GetOpcodePC(void) const { return op_pc_; }
+    uint64_t GetCycles(void) const { return cycles_; }
+    // Instructions started since construction, for statistics; not part of
+    // the saved state.
+    uint64_t GetInstructions(void) const { return instructions_; }
+    // Halts the CPU for cycles, e.g. while DMA owns the bus.
+    void Stall(uint64_t cycles) { cycles_ += cycles; }
+    void SetCodeDataLogger(CodeDataLogger* cdl) { cdl_ = cdl; }
+    // The trace goes to the CPU log category and to the sink, if any; both
+    // are off while tracing is disabled.
+    void SetTraceEnabled(bool enabled) { trace_ = enabled; }
+    bool IsTraceEnabled(void) const { return trace_; }
+    void SetTraceSink(ITraceSink* sink) { trace_sink_ = sink; }
+    void SetFlightRecorder(FlightRecorder* recorder) { recorder_ = recorder; }
+    // One line of the nestest.log format.
+    static std::string FormatTrace(const registers& reg, uint8_t opcode, uint16_t operand,
+                                   uint64_t cycles);
+
+    // Decode table entry with its mnemonic, for tracing and the static
+    // analysis tools (opcode.h).
+    static opcode_t GetOpcode(uint8_t opcode);
+
+    void SaveState(cpu_state* state) const;
+    void LoadState(const cpu_state* state);
+
+    uint8_t GetFlag(int flag) const { return (reg_.P & flag) ? 1 : 0; }
+    void SetFlag(int flag) { reg_.P |= flag; }
+    void ClearFlag(int flag) { reg_.P &= ~flag; }
 
 private:
+    // The per-cycle core drives the same registers through the shared
+    // instruction semantics below.
+    friend class CycleCpu;
+
     Nes* nes_;
     Mmu* mmu_;
+    Debugger* debugger_;
+    CodeDataLogger* cdl_;
     registers reg_;
-    addr_mode mode_;
-    static const opcode_t opcode_table_[256];
+    uint16_t op_pc_;
 
     uint64_t cycles_;
+    uint64_t instructions_;
+    bool trace_;
+    ITraceSink* trace_sink_;
+    FlightRecorder* recorder_;
+
+    bool IsTracing(void) const;
+    void Trace(const registers& reg, uint8_t opcode, uint16_t operand, uint64_t cycles);
 
     void Push8(uint8_t val);
     uint8_t Pop8(void);
@@ -103,74 +151,76 @@ private:
     void SetZFlag(uint8_t val);
     uint64_t GetBranchCycles(int8_t offset);
     void Branch(int8_t offset, bool cond);
+    bool IsBranchTaken(opcode op);
     void Compare(uint8_t a, uint8_t b);
+    // P as pushed by PHP/BRK, and as pulled by PLP/RTI.
+    uint8_t GetPushedFlags(void) const { return reg_.P | F_BH | F_BL; }
+    void SetPulledFlags(uint8_t val);
+
+    // Instruction semantics on values; the cores do the bus accesses.
+    // Execute covers reads and implied instructions, Modify the
+    // read-modify-write ones and returns the value written back, Store
+    // gives the value of a store.
+    void Execute(opcode op, uint8_t val);
+    uint8_t Modify(opcode op, uint8_t val);
+    uint8_t Store(opcode op) const;
 
-    void ADC(uint16_t addr);
-    void AND(uint16_t addr);
-    void ASL(uint16_t addr);
+    void ADC(uint8_t val);
+    void AND(uint8_t val);
+    uint8_t ASL(uint8_t val);
 
-    void BCC(int8_t offset);
-    void BCS(int8_t offset);
-    void BEQ(int8_t offset);
-    void BIT(uint16_t addr);
-    void BMI(int8_t offset);
-    void BNE(int8_t offset);
-    void BPL(int8_t offset);
-    void BVC(int8_t offset);
-    void BVS(int8_t offset);
+    void BIT(uint8_t val);
+    void BRK(void);
 
     void CLC(void);
     void CLD(void);
+    void CLI(void);
     void CLV(void);
-    void CMP(uint16_t addr);
-    void CPX(uint16_t addr);
-    void CPY(uint16_t addr);
+    void CMP(uint8_t val);
+    void CPX(uint8_t val);
+    void CPY(uint8_t val);
 
-    void DCP(uint16_t addr);
-    void DEC(uint16_t addr);
+    uint8_t DCP(uint8_t val);
+    uint8_t DEC(uint8_t val);
     void DEX(void);
     void DEY(void);
 
-    void EOR(uint16_t addr);
+    void EOR(uint8_t val);
 
-    void INC(uint16_t addr);
+    uint8_t INC(uint8_t val);
     void INX(void);
     void INY(void);
-    void ISB(uint16_t addr);
+    uint8_t ISB(uint8_t val);
 
     void JMP(uint16_t addr);
     void JSR(uint16_t addr);
 
-    void LAX(uint16_t addr);
-    void LDA(uint16_t addr);
-    void LDX(uint16_t addr);
-    void LDY(uint16_t addr);
-    void LSR(uint16_t addr);
+    void LAX(uint8_t val);
+    void LDA(uint8_t val);
+    void LDX(uint8_t val);
+    void LDY(uint8_t val);
+    uint8_t LSR(uint8_t val);
 
-    void ORA(uint16_t addr);
+    void ORA(uint8_t val);
 
     void PHA(void);
     void PHP(void);
-    void PLA(void);
-    void PLP(void);
+    void PLA(uint8_t val);
+    void PLP(uint8_t val);
 
-    void RLA(uint16_t addr);
-    void ROL(uint16_t addr);
-    void ROR(uint16_t addr);
-    void RRA(uint16_t addr);
+    uint8_t RLA(uint8_t val);
+    uint8_t ROL(uint8_t val);
+    uint8_t ROR(uint8_t val);
+    uint8_t RRA(uint8_t val);
     void RTI(void);
     void RTS(void);
 
-    void SAX(uint16_t addr);
-    void SBC(uint16_t addr);
+    void SBC(uint8_t val);
     void SEC(void);
     void SED(void);
     void SEI(void);
-    void SLO(uint16_t addr);
-    void SRE(uint16_t addr);
-    void STA(uint16_t addr);
-    void STX(uint16_t addr);
-    void STY(uint16_t addr);
+    uint8_t SLO(uint8_t val);
+    uint8_t SRE(uint8_t val);
 
     void TAX(void);
     void TAY(void);
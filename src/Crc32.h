@@ -0,0 +1,22 @@
+#ifndef _CRC32_H
+#define _CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32 (IEEE 802.3, as used by ROM databases). Large buffers are folded
+// with PCLMULQDQ when the CPU supports it, the rest uses slicing-by-8
+// tables. The SSE4.2 crc32 instruction computes CRC-32C, a different
+// polynomial, so it can't be used for these checksums.
+class Crc32 {
+public:
+    // crc continues a previous result, 0 starts a new checksum.
+    static uint32_t Compute(const uint8_t* data, size_t size, uint32_t crc=0);
+    static uint32_t ComputeTable(const uint8_t* data, size_t size, uint32_t crc=0);
+    static bool HasClmul(void);
+
+private:
+    Crc32() = delete;
+};
+
+#endif
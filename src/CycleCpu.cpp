@@ -0,0 +1,410 @@
+#include "CycleCpu.h"
+#include "Mmu.h"
+#include "Debugger.h"
+#include "CodeDataLogger.h"
+#include "FlightRecorder.h"
+#include "Logging.h"
+#include "opcode.h"
+
+CycleCpu::CycleCpu(Cpu* cpu, Mmu* mmu, Debugger* debugger) :
+    cpu_(cpu), mmu_(mmu), debugger_(debugger), cycle_(0), access_(0), opcode_(0),
+    op_(Cpu::OP_INVALID), mode_(Cpu::MODE_INVALID), kind_(KIND_JAM), size_(0), addr_(0),
+    base_(0), data_(0), operand_(0), operand_bytes_(0), trace_cycles_(0)
+{
+    trace_reg_ = cpu_->GetRegisters();
+}
+
+void CycleCpu::Reset(void) {
+    cycle_ = 0;
+    access_ = 0;
+}
+
+void CycleCpu::Tick(void) {
+    if (cycle_ == 0) {
+        uint16_t pc = cpu_->reg_.PC;
+        if (debugger_->IsWatched(pc, BP_EXEC) && debugger_->OnExec(pc)) {
+            return;
+        }
+        // the counter moves first so an access sees the same count as
+        // in Cpu::Step, which adds the whole instruction up front
+        trace_cycles_ = cpu_->cycles_;
+        cpu_->cycles_++;
+        cycle_ = 1;
+        Fetch();
+        return;
+    }
+
+    cpu_->cycles_++;
+    cycle_++;
+    if (Run()) {
+        cycle_ = 0;
+    }
+}
+
+void CycleCpu::Step(void) {
+    do {
+        Tick();
+    } while (cycle_ != 0 && !debugger_->IsPaused());
+}
+
+uint8_t CycleCpu::Read(uint16_t addr) {
+    return mmu_->Read8(addr);
+}
+
+void CycleCpu::Write(uint16_t addr, uint8_t data) {
+    mmu_->Write8(addr, data);
+}
+
+uint8_t CycleCpu::FetchOperand(void) {
+    uint8_t data = Read(cpu_->reg_.PC++);
+    operand_ |= data << (8 * operand_bytes_);
+    if (++operand_bytes_ == size_ - 1) {
+        if (cpu_->IsTracing()) {
+            cpu_->Trace(trace_reg_, opcode_, operand_, trace_cycles_);
+        }
+        if (cpu_->recorder_ != nullptr) {
+            cpu_->recorder_->SetOperand(operand_);
+        }
+    }
+    return data;
+}
+
+void CycleCpu::Push(uint8_t data) {
+    Write(0x100 | cpu_->reg_.SP, data);
+    cpu_->reg_.SP--;
+}
+
+uint8_t CycleCpu::Pull(void) {
+    cpu_->reg_.SP++;
+    return Read(0x100 | cpu_->reg_.SP);
+}
+
+void CycleCpu::Fetch(void) {
+    registers& reg = cpu_->reg_;
+
+    trace_reg_ = reg;
+    cpu_->op_pc_ = reg.PC;
+    cpu_->instructions_++;
+#ifdef NES_CDL
+    if (cpu_->cdl_ != nullptr) {
+        cpu_->cdl_->BeginFetch(reg.PC);
+    }
+#endif
+    opcode_ = Read(reg.PC++);
+    const opcode_hot& hot = hot_opcodes.entries[opcode_];
+    op_ = (Cpu::opcode)hot.op;
+    mode_ = (Cpu::addr_mode)hot.mode;
+    kind_ = opcode_kinds[hot.op];
+    size_ = hot.size;
+    access_ = 0;
+    operand_ = 0;
+    operand_bytes_ = 0;
+#ifdef NES_CDL
+    // the whole instruction is logged now; its operand fetches are skipped
+    // as data reads until the next opcode fetch
+    if (cpu_->cdl_ != nullptr) {
+        cpu_->cdl_->LogCode(cpu_->op_pc_, size_);
+        cpu_->cdl_->BeginFetch(cpu_->op_pc_);
+    }
+#endif
+
+    // the trace waits for the operand, the recorder takes it later: bus
+    // writes before the last operand fetch (JSR's pushes) belong after it
+    if (size_ <= 1 && cpu_->IsTracing()) {
+        cpu_->Trace(trace_reg_, opcode_, 0, trace_cycles_);
+    }
+    if (cpu_->recorder_ != nullptr) {
+        cpu_->recorder_->RecordInstruction(trace_reg_, opcode_, 0, trace_cycles_);
+    }
+}
+
+// Cycle sequences after the opcode fetch, as listed in 64doc.
+bool CycleCpu::Run(void) {
+    registers& reg = cpu_->reg_;
+
+    switch (kind_) {
+        case KIND_BRANCH:
+            if (cycle_ == 2) {
+                data_ = FetchOperand();
+                return !cpu_->IsBranchTaken(op_);
+            }
+            if (cycle_ == 3) {
+                Read(reg.PC);
+                addr_ = reg.PC + (int8_t)data_;
+                bool crossed = cpu_->IsPageCrossed(addr_, reg.PC);
+                reg.PC = (reg.PC & 0xFF00) | (addr_ & 0xFF);
+                return !crossed;
+            }
+            Read(reg.PC);
+            reg.PC = addr_;
+            return true;
+
+        case KIND_JMP:
+            switch (cycle_) {
+                case 2:
+                    addr_ = FetchOperand();
+                    return false;
+                case 3:
+                    addr_ |= FetchOperand() << 8;
+                    if (mode_ == Cpu::MODE_ABSOLUTE) {
+                        reg.PC = addr_;
+                        return true;
+                    }
+                    return false;
+                case 4:
+                    data_ = Read(addr_);
+                    return false;
+                default:
+                    // the pointer's high byte doesn't carry into the next page
+                    reg.PC = (Read((addr_ & 0xFF00) | ((addr_ + 1) & 0xFF)) << 8) | data_;
+                    return true;
+            }
+
+        case KIND_JSR:
+            switch (cycle_) {
+                case 2:
+                    addr_ = FetchOperand();
+                    return false;
+                case 3:
+                    Read(0x100 | reg.SP);
+                    return false;
+                case 4:
+                    Push(reg.PC >> 8);
+                    return false;
+                case 5:
+                    Push(reg.PC & 0xFF);
+                    return false;
+                default:
+                    addr_ |= FetchOperand() << 8;
+                    reg.PC = addr_;
+                    return true;
+            }
+
+        case KIND_RTS:
+            switch (cycle_) {
+                case 2:
+                    Read(reg.PC);
+                    return false;
+                case 3:
+                    Read(0x100 | reg.SP);
+                    return false;
+                case 4:
+                    addr_ = Pull();
+                    return false;
+                case 5:
+                    addr_ |= Pull() << 8;
+                    return false;
+                default:
+                    Read(addr_);
+                    reg.PC = addr_ + 1;
+                    return true;
+            }
+
+        case KIND_RTI:
+            switch (cycle_) {
+                case 2:
+                    Read(reg.PC);
+                    return false;
+                case 3:
+                    Read(0x100 | reg.SP);
+                    return false;
+                case 4:
+                    cpu_->SetPulledFlags(Pull());
+                    return false;
+                case 5:
+                    addr_ = Pull();
+                    return false;
+                default:
+                    reg.PC = (Pull() << 8) | addr_;
+                    return true;
+            }
+
+        case KIND_BRK:
+            switch (cycle_) {
+                case 2:
+                    // padding byte, skipped by the return address
+                    Read(reg.PC++);
+                    return false;
+                case 3:
+                    Push(reg.PC >> 8);
+                    return false;
+                case 4:
+                    Push(reg.PC & 0xFF);
+                    return false;
+                case 5:
+                    Push(cpu_->GetPushedFlags());
+                    cpu_->SetFlag(Cpu::F_INT_DISABLE);
+                    return false;
+                case 6:
+                    data_ = Read(0xFFFE);
+                    return false;
+                default:
+                    reg.PC = (Read(0xFFFF) << 8) | data_;
+                    return true;
+            }
+
+        case KIND_PUSH:
+            if (cycle_ == 2) {
+                Read(reg.PC);
+                return false;
+            }
+            Push((op_ == Cpu::OP_PHA) ? reg.A : cpu_->GetPushedFlags());
+            return true;
+
+        case KIND_PULL:
+            if (cycle_ == 2) {
+                Read(reg.PC);
+                return false;
+            }
+            if (cycle_ == 3) {
+                Read(0x100 | reg.SP);
+                return false;
+            }
+            if (op_ == Cpu::OP_PLA) {
+                cpu_->PLA(Pull());
+            } else {
+                cpu_->PLP(Pull());
+            }
+            return true;
+
+        case KIND_JAM:
+            // the CPU stays on this opcode but the clock keeps running
+            reg.PC = cpu_->op_pc_;
+            LOG(CPU, WARN, "Illegal instructions");
+            if (cpu_->recorder_ != nullptr) {
+                cpu_->recorder_->OnIllegalOpcode();
+            }
+            return true;
+
+        default:
+            return RunAddressing();
+    }
+}
+
+bool CycleCpu::RunAddressing(void) {
+    registers& reg = cpu_->reg_;
+
+    if (access_ != 0 && cycle_ >= access_) {
+        return RunAccess(cycle_ - access_);
+    }
+
+    switch (mode_) {
+        case Cpu::MODE_IMPLIED:
+        case Cpu::MODE_ACCUMULATOR:
+            Read(reg.PC);
+            if (kind_ == KIND_RMW) {
+                reg.A = cpu_->Modify(op_, reg.A);
+            } else {
+                cpu_->Execute(op_, 0);
+            }
+            return true;
+        case Cpu::MODE_IMMEDIATE:
+            cpu_->Execute(op_, FetchOperand());
+            return true;
+        case Cpu::MODE_ZEROPAGE:
+            addr_ = FetchOperand();
+            access_ = 3;
+            return false;
+        case Cpu::MODE_ZEROPAGE_X_INDEXED:
+        case Cpu::MODE_ZEROPAGE_Y_INDEXED:
+            if (cycle_ == 2) {
+                addr_ = FetchOperand();
+                return false;
+            }
+            Read(addr_);
+            addr_ = (addr_ + ((mode_ == Cpu::MODE_ZEROPAGE_X_INDEXED) ? reg.X : reg.Y)) & 0xFF;
+            access_ = 4;
+            return false;
+        case Cpu::MODE_ABSOLUTE:
+            if (cycle_ == 2) {
+                addr_ = FetchOperand();
+                return false;
+            }
+            addr_ |= FetchOperand() << 8;
+            access_ = 4;
+            return false;
+        case Cpu::MODE_ABSOLUTE_X_INDEXED:
+        case Cpu::MODE_ABSOLUTE_Y_INDEXED:
+            if (cycle_ == 2) {
+                base_ = FetchOperand();
+                return false;
+            }
+            if (cycle_ == 3) {
+                base_ |= FetchOperand() << 8;
+                addr_ = base_ + ((mode_ == Cpu::MODE_ABSOLUTE_X_INDEXED) ? reg.X : reg.Y);
+                return false;
+            }
+            return RunFixup();
+        case Cpu::MODE_X_INDEXED_INDIRECT:
+            switch (cycle_) {
+                case 2:
+                    data_ = FetchOperand();
+                    return false;
+                case 3:
+                    Read(data_);
+                    data_ += reg.X;
+                    return false;
+                case 4:
+                    addr_ = Read(data_);
+                    return false;
+                default:
+                    addr_ |= Read((uint8_t)(data_ + 1)) << 8;
+                    access_ = 6;
+                    return false;
+            }
+        case Cpu::MODE_INDIRECT_Y_INDEXED:
+            switch (cycle_) {
+                case 2:
+                    data_ = FetchOperand();
+                    return false;
+                case 3:
+                    base_ = Read(data_);
+                    return false;
+                case 4:
+                    base_ |= Read((uint8_t)(data_ + 1)) << 8;
+                    addr_ = base_ + reg.Y;
+                    return false;
+                default:
+                    return RunFixup();
+            }
+        default:
+            return true;
+    }
+}
+
+// Indexed modes read from the address before the carry into the high byte
+// is fixed. Reads that didn't cross a page are done; everything else
+// repeats the access on the next cycle.
+bool CycleCpu::RunFixup(void) {
+    uint16_t unfixed = (base_ & 0xFF00) | (addr_ & 0xFF);
+    if (kind_ == KIND_READ && unfixed == addr_) {
+        cpu_->Execute(op_, Read(addr_));
+        return true;
+    }
+    Read(unfixed);
+    access_ = cycle_ + 1;
+    return false;
+}
+
+bool CycleCpu::RunAccess(int cycle) {
+    switch (kind_) {
+        case KIND_READ:
+            cpu_->Execute(op_, Read(addr_));
+            return true;
+        case KIND_WRITE:
+            Write(addr_, cpu_->Store(op_));
+            return true;
+        default:
+            // read-modify-write: the unmodified value is written back first
+            if (cycle == 0) {
+                data_ = Read(addr_);
+                return false;
+            }
+            if (cycle == 1) {
+                Write(addr_, data_);
+                return false;
+            }
+            Write(addr_, cpu_->Modify(op_, data_));
+            return true;
+    }
+}
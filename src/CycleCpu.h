@@ -0,0 +1,65 @@
+#ifndef _CYCLE_CPU_H
+#define _CYCLE_CPU_H
+
+#include <cstdint>
+#include "Cpu.h"
+
+class Mmu;
+class Debugger;
+
+// Per-cycle core: runs the instructions of a Cpu one bus cycle per Tick,
+// with the dummy reads and writes of the real 6502, for games that depend
+// on timing within an instruction. It decodes with the same tables
+// (opcode.h) and executes with the same semantics as Cpu::Step, and works
+// on the Cpu's registers and cycle counter, so the two cores can be
+// switched between instructions and share save states. Nes picks the core
+// (Nes::SetCpuCore); the fast core doesn't pay for this one.
+class CycleCpu {
+public:
+    CycleCpu(Cpu* cpu, Mmu* mmu, Debugger* debugger);
+    ~CycleCpu() = default;
+
+    // Drops a partly executed instruction, e.g. after Cpu::LoadState.
+    void Reset(void);
+    // One bus cycle.
+    void Tick(void);
+    // To the end of the current instruction, or through the next one.
+    void Step(void);
+    // Between instructions.
+    bool IsIdle(void) const { return cycle_ == 0; }
+
+private:
+    Cpu* cpu_;
+    Mmu* mmu_;
+    Debugger* debugger_;
+
+    int cycle_;             // cycle of the current instruction, 0 when idle
+    int access_;            // cycle of the first data access, 0 until known
+    uint8_t opcode_;
+    Cpu::opcode op_;
+    Cpu::addr_mode mode_;
+    uint8_t kind_;
+    uint8_t size_;
+    uint16_t addr_;
+    uint16_t base_;         // indexed modes: address before indexing
+    uint8_t data_;
+    uint16_t operand_;
+    int operand_bytes_;
+    registers trace_reg_;   // registers and cycles at the opcode fetch
+    uint64_t trace_cycles_;
+
+    uint8_t Read(uint16_t addr);
+    void Write(uint16_t addr, uint8_t data);
+    uint8_t FetchOperand(void);
+    void Push(uint8_t data);
+    uint8_t Pull(void);
+
+    void Fetch(void);
+    // Each returns true on the last cycle of the instruction.
+    bool Run(void);
+    bool RunAddressing(void);
+    bool RunFixup(void);
+    bool RunAccess(int cycle);
+};
+
+#endif
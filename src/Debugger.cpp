@@ -0,0 +1,174 @@
+#include "Debugger.h"
+#include "Mmu.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+Debugger::Debugger(Nes* nes) :
+    nes_(nes), cpu_(nullptr), next_id_(1), enabled_(true), paused_(false),
+    resume_pc_(0), resume_cycles_(UINT64_MAX)
+{
+    memset(pages_, 0, sizeof(pages_));
+    memset(&hit_, 0, sizeof(hit_));
+}
+
+int Debugger::AddBreakpoint(uint8_t type, uint16_t addr_start, uint16_t addr_end,
+                            const bp_condition* cond) {
+    breakpoint bp;
+    bp.id = next_id_++;
+    bp.type = type;
+    bp.addr_start = min(addr_start, addr_end);
+    bp.addr_end = max(addr_start, addr_end);
+    if (cond != nullptr) {
+        bp.cond = *cond;
+    } else {
+        bp.cond.reg = BP_REG_NONE;
+        bp.cond.cmp = BP_CMP_EQ;
+        bp.cond.value = 0;
+    }
+    breakpoints_.push_back(bp);
+    UpdatePages();
+    return bp.id;
+}
+
+bool Debugger::RemoveBreakpoint(int id) {
+    auto it = find_if(breakpoints_.begin(), breakpoints_.end(),
+        [id](const breakpoint& bp) { return bp.id == id; });
+    if (it == breakpoints_.end()) {
+        return false;
+    }
+    breakpoints_.erase(it);
+    UpdatePages();
+    return true;
+}
+
+void Debugger::ClearBreakpoints(void) {
+    breakpoints_.clear();
+    UpdatePages();
+}
+
+void Debugger::SetEnabled(bool enabled) {
+    enabled_ = enabled;
+    UpdatePages();
+}
+
+void Debugger::Resume(void) {
+    if (paused_ && hit_.type == BP_EXEC) {
+        resume_pc_ = hit_.addr;
+        resume_cycles_ = hit_.cycles;
+    }
+    paused_ = false;
+}
+
+bool Debugger::OnExec(uint16_t pc) {
+    if (paused_) {
+        return true;
+    }
+    const registers& reg = cpu_->GetRegisters();
+    uint64_t cycles = cpu_->GetCycles();
+    if (pc == resume_pc_ && cycles == resume_cycles_) {
+        resume_cycles_ = UINT64_MAX;
+        return false;
+    }
+
+    const breakpoint* bp = Match(BP_EXEC, pc, reg);
+    if (bp == nullptr) {
+        return false;
+    }
+    hit_.id = bp->id;
+    hit_.type = BP_EXEC;
+    hit_.addr = pc;
+    hit_.data = 0;
+    hit_.reg = reg;
+    hit_.cycles = cycles;
+    paused_ = true;
+    return true;
+}
+
+void Debugger::OnAccess(uint8_t type, uint16_t addr, uint8_t data) {
+    // the first hit of an instruction is the one reported
+    if (paused_ || cpu_ == nullptr) {
+        return;
+    }
+    // PC already points past the instruction doing the access
+    registers reg = cpu_->GetRegisters();
+    reg.PC = cpu_->GetOpcodePC();
+    const breakpoint* bp = Match(type, addr, reg);
+    if (bp == nullptr) {
+        return;
+    }
+    hit_.id = bp->id;
+    hit_.type = type;
+    hit_.addr = addr;
+    hit_.data = data;
+    hit_.reg = reg;
+    hit_.cycles = cpu_->GetCycles();
+    paused_ = true;
+}
+
+void Debugger::UpdatePages(void) {
+    memset(pages_, 0, sizeof(pages_));
+    if (!enabled_) {
+        return;
+    }
+    for (const breakpoint& bp : breakpoints_) {
+        for (int page = bp.addr_start >> 8; page <= (bp.addr_end >> 8); page++) {
+            if (page < 0x20) {
+                // every mirror of a watched RAM page is watched
+                for (int mirror = page & ((RAM_SIZE >> 8) - 1); mirror < 0x20;
+                     mirror += RAM_SIZE >> 8) {
+                    pages_[mirror] |= bp.type;
+                }
+            } else {
+                pages_[page] |= bp.type;
+            }
+        }
+    }
+}
+
+bool Debugger::Covers(const breakpoint& bp, uint16_t addr) {
+    if (addr < 0x2000) {
+        for (int mirror = addr & (RAM_SIZE - 1); mirror < 0x2000; mirror += RAM_SIZE) {
+            if (mirror >= bp.addr_start && mirror <= bp.addr_end) {
+                return true;
+            }
+        }
+        return false;
+    }
+    return addr >= bp.addr_start && addr <= bp.addr_end;
+}
+
+const breakpoint* Debugger::Match(uint8_t type, uint16_t addr, const registers& reg) const {
+    for (const breakpoint& bp : breakpoints_) {
+        if ((bp.type & type) && Covers(bp, addr) && Test(bp.cond, reg)) {
+            return &bp;
+        }
+    }
+    return nullptr;
+}
+
+bool Debugger::Test(const bp_condition& cond, const registers& reg) {
+    uint16_t val;
+    switch (cond.reg) {
+        case BP_REG_A:  val = reg.A;  break;
+        case BP_REG_X:  val = reg.X;  break;
+        case BP_REG_Y:  val = reg.Y;  break;
+        case BP_REG_SP: val = reg.SP; break;
+        case BP_REG_P:  val = reg.P;  break;
+        case BP_REG_PC: val = reg.PC; break;
+        default:
+            return true;
+    }
+
+    switch (cond.cmp) {
+        case BP_CMP_EQ:   return val == cond.value;
+        case BP_CMP_NE:   return val != cond.value;
+        case BP_CMP_LT:   return val < cond.value;
+        case BP_CMP_LE:   return val <= cond.value;
+        case BP_CMP_GT:   return val > cond.value;
+        case BP_CMP_GE:   return val >= cond.value;
+        case BP_CMP_MASK: return (val & cond.value) != 0;
+    }
+    return false;
+}
@@ -0,0 +1,120 @@
+#ifndef _DEBUGGER_H
+#define _DEBUGGER_H
+
+#include <cstdint>
+#include <vector>
+#include "Cpu.h"
+
+#define DEBUG_PAGES     256
+
+class Nes;
+
+// Breakpoint types, also the per-page flags of the page bitmap.
+enum breakpoint_type {
+    BP_EXEC  = (1 << 0),
+    BP_READ  = (1 << 1),
+    BP_WRITE = (1 << 2)
+};
+
+enum bp_register {
+    BP_REG_NONE,        // unconditional
+    BP_REG_A,
+    BP_REG_X,
+    BP_REG_Y,
+    BP_REG_SP,
+    BP_REG_P,
+    BP_REG_PC
+};
+
+enum bp_compare {
+    BP_CMP_EQ,
+    BP_CMP_NE,
+    BP_CMP_LT,
+    BP_CMP_LE,
+    BP_CMP_GT,
+    BP_CMP_GE,
+    BP_CMP_MASK         // any of the bits in value set
+};
+
+typedef struct {
+    bp_register reg;
+    bp_compare cmp;
+    uint16_t value;
+} bp_condition;
+
+typedef struct {
+    int id;
+    uint8_t type;       // BP_EXEC | BP_READ | BP_WRITE
+    uint16_t addr_start;
+    uint16_t addr_end;  // inclusive
+    bp_condition cond;
+} breakpoint;
+
+typedef struct {
+    int id;             // breakpoint that fired
+    uint8_t type;       // access that fired it
+    uint16_t addr;
+    uint8_t data;       // value read or written
+    registers reg;      // PC is the instruction doing the access
+    uint64_t cycles;
+} breakpoint_hit;
+
+// Checks on the hot paths are a single lookup in a page bitmap: only
+// accesses to a page that holds a breakpoint of that type go on to match
+// the breakpoint list. A hit pauses Nes::RunFrame; execution breakpoints
+// stop before the instruction, watchpoints after the access.
+class Debugger {
+public:
+    Debugger(Nes* nes);
+    ~Debugger() = default;
+
+    void SetCpu(Cpu* cpu) { cpu_ = cpu; }
+
+    // Returns the breakpoint id.
+    int AddBreakpoint(uint8_t type, uint16_t addr_start, uint16_t addr_end,
+                      const bp_condition* cond=nullptr);
+    int AddBreakpoint(uint8_t type, uint16_t addr, const bp_condition* cond=nullptr) {
+        return AddBreakpoint(type, addr, addr, cond);
+    }
+    bool RemoveBreakpoint(int id);
+    void ClearBreakpoints(void);
+    const std::vector<breakpoint>& GetBreakpoints(void) const { return breakpoints_; }
+
+    bool IsPaused(void) const { return paused_; }
+    void Pause(void) { paused_ = true; }
+    // Continues past the breakpoint that caused the pause.
+    void Resume(void);
+    const breakpoint_hit& GetHit(void) const { return hit_; }
+
+    // While disabled no breakpoint fires; the list is kept.
+    void SetEnabled(bool enabled);
+    bool IsEnabled(void) const { return enabled_; }
+
+    bool IsWatched(uint16_t addr, uint8_t type) const { return pages_[addr >> 8] & type; }
+    // Slow paths, only called for watched pages. OnExec returns true when
+    // the instruction at pc must not run.
+    bool OnExec(uint16_t pc);
+    void OnAccess(uint8_t type, uint16_t addr, uint8_t data);
+
+private:
+    Nes* nes_;
+    Cpu* cpu_;
+    uint8_t pages_[DEBUG_PAGES];
+    std::vector<breakpoint> breakpoints_;
+    int next_id_;
+    bool enabled_;
+
+    bool paused_;
+    breakpoint_hit hit_;
+    // the execution breakpoint being resumed from, skipped once
+    uint16_t resume_pc_;
+    uint64_t resume_cycles_;
+
+    void UpdatePages(void);
+    const breakpoint* Match(uint8_t type, uint16_t addr, const registers& reg) const;
+    // true if addr, or a RAM mirror of it, lies in the breakpoint's range
+    static bool Covers(const breakpoint& bp, uint16_t addr);
+    static bool Test(const bp_condition& cond, const registers& reg);
+};
+
+#endif
@@ -0,0 +1,102 @@
+#include "DeltaCodec.h"
+#include <cstring>
+
+// a literal run only ends on this many unchanged bytes, which bounds the
+// token count and keeps short gaps from splitting runs
+#define MIN_SKIP    4
+
+static inline uint8_t* PutVarint(uint8_t* out, size_t val) {
+    while (val >= 0x80) {
+        *out++ = (uint8_t)(val | 0x80);
+        val >>= 7;
+    }
+    *out++ = (uint8_t)val;
+    return out;
+}
+
+static inline const uint8_t* GetVarint(const uint8_t* in, const uint8_t* end, size_t* val) {
+    size_t v = 0;
+    int shift = 0;
+    while (in < end && shift < 64) {
+        uint8_t b = *in++;
+        v |= (size_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *val = v;
+            return in;
+        }
+        shift += 7;
+    }
+    return nullptr;
+}
+
+static inline bool Equal64(const uint8_t* a, const uint8_t* b) {
+    uint64_t x, y;
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    return x == y;
+}
+
+size_t DeltaCodec::Encode(const uint8_t* cur, const uint8_t* prev, size_t size, uint8_t* out) {
+    uint8_t* start = out;
+    size_t pos = 0;
+
+    while (pos < size) {
+        size_t skip_start = pos;
+        while (pos + 8 <= size && Equal64(cur + pos, prev + pos)) {
+            pos += 8;
+        }
+        while (pos < size && cur[pos] == prev[pos]) {
+            ++pos;
+        }
+        if (pos == size) {
+            break;  // trailing unchanged bytes need no token
+        }
+
+        size_t lit_start = pos;
+        while (pos < size) {
+            if (cur[pos] != prev[pos]) {
+                ++pos;
+                continue;
+            }
+            size_t same = pos;
+            while (same < size && same - pos < MIN_SKIP && cur[same] == prev[same]) {
+                ++same;
+            }
+            if (same - pos >= MIN_SKIP || same == size) {
+                break;
+            }
+            pos = same;
+        }
+
+        out = PutVarint(out, lit_start - skip_start);
+        out = PutVarint(out, pos - lit_start);
+        for (size_t i = lit_start; i < pos; i++) {
+            *out++ = cur[i] ^ prev[i];
+        }
+    }
+    return out - start;
+}
+
+bool DeltaCodec::Apply(uint8_t* buf, size_t size, const uint8_t* in, size_t in_size) {
+    const uint8_t* end = in + in_size;
+    size_t pos = 0;
+
+    while (in < end) {
+        size_t skip, count;
+        in = GetVarint(in, end, &skip);
+        if (in == nullptr) {
+            return false;
+        }
+        in = GetVarint(in, end, &count);
+        if (in == nullptr || pos + skip + count > size || (size_t)(end - in) < count) {
+            return false;
+        }
+        pos += skip;
+        for (size_t i = 0; i < count; i++) {
+            buf[pos + i] ^= in[i];
+        }
+        pos += count;
+        in += count;
+    }
+    return true;
+}
@@ -0,0 +1,27 @@
+#ifndef _DELTA_CODEC_H
+#define _DELTA_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+// XOR delta between two equally sized buffers, run-length coded as a list of
+// tokens: varint skip (unchanged bytes), varint count, count XOR bytes.
+// Unchanged regions cost nothing, so mostly static state such as RAM
+// compresses to a few bytes per frame.
+class DeltaCodec {
+public:
+    // Worst case encoded size of a delta over size bytes.
+    static size_t Bound(size_t size) { return 2 * size + 16; }
+
+    // Encodes cur ^ prev into out, returns the encoded length.
+    static size_t Encode(const uint8_t* cur, const uint8_t* prev, size_t size, uint8_t* out);
+
+    // XORs an encoded delta into buf. Applying the same delta twice undoes it,
+    // so a delta restores either side from the other.
+    static bool Apply(uint8_t* buf, size_t size, const uint8_t* in, size_t in_size);
+
+private:
+    DeltaCodec() = delete;
+};
+
+#endif
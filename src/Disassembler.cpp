@@ -0,0 +1,372 @@
+#include "Disassembler.h"
+#include "Cpu.h"
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+
+#define OPCODE_ASL_A    0x0A
+#define OPCODE_PHA      0x48
+#define OPCODE_PLA      0x68
+#define OPCODE_TAY      0xA8
+#define OPCODE_STA_ZP   0x85
+#define OPCODE_STA_ABS  0x8D
+#define OPCODE_LDA_ABSY 0xB9
+#define OPCODE_LDA_ABSX 0xBD
+
+Disassembler::Disassembler(const uint8_t* prg, size_t size) :
+    prg_(prg), size_(size), base_(0x10000 - (size < 0x8000 ? size : 0x8000)),
+    map_(size, 0), insn_(size, 0), label_(size, 0)
+{
+
+}
+
+void Disassembler::Analyze(void) {
+    // NMI, reset, IRQ
+    MarkData(0xFFFA, 6);
+    Queue(ReadWord(0xFFFA), true);
+    Queue(ReadWord(0xFFFC), true);
+    Queue(ReadWord(0xFFFE), true);
+
+    // Tables are read once no other code is left to find, so their end is
+    // where the next known code starts.
+    size_t next_table = 0;
+    while (!pending_.empty() || next_table < tables_.size()) {
+        while (!pending_.empty()) {
+            uint16_t addr = pending_.back();
+            pending_.pop_back();
+            Trace(addr);
+        }
+        if (next_table < tables_.size()) {
+            ReadJumpTable(tables_[next_table++]);
+        }
+    }
+}
+
+void Disassembler::AddEntryPoint(uint16_t addr) {
+    Queue(addr, false);
+}
+
+size_t Disassembler::GetCodeBytes(void) const {
+    size_t count = 0;
+    for (uint8_t flags : map_) {
+        count += (flags & CDL_CODE) != 0;
+    }
+    return count;
+}
+
+size_t Disassembler::GetDataBytes(void) const {
+    size_t count = 0;
+    for (uint8_t flags : map_) {
+        count += (flags & (CDL_CODE | CDL_DATA)) == CDL_DATA;
+    }
+    return count;
+}
+
+bool Disassembler::ToOffset(uint16_t addr, size_t* offset) const {
+    if (addr < 0x8000 || size_ == 0) {
+        return false;
+    }
+    *offset = (addr - 0x8000) & (size_ - 1);
+    return true;
+}
+
+uint8_t Disassembler::ReadByte(uint16_t addr) const {
+    size_t offset;
+    return ToOffset(addr, &offset) ? prg_[offset] : 0;
+}
+
+uint16_t Disassembler::ReadWord(uint16_t addr) const {
+    return ReadByte(addr) | (ReadByte(addr + 1) << 8);
+}
+
+void Disassembler::Queue(uint16_t addr, bool indirect) {
+    size_t offset;
+    if (!ToOffset(addr, &offset)) {
+        return;     // code in RAM can't be followed statically
+    }
+    label_[offset] = 1;
+    if (indirect) {
+        map_[offset] |= CDL_INDIRECT_CODE;
+    }
+    if (!insn_[offset]) {
+        pending_.push_back(addr);
+    }
+}
+
+void Disassembler::MarkData(uint16_t addr, size_t len) {
+    size_t offset;
+    for (size_t i = 0; i < len; i++) {
+        if (ToOffset(addr + i, &offset)) {
+            map_[offset] |= CDL_DATA;
+        }
+    }
+}
+
+void Disassembler::Trace(uint16_t addr) {
+    insn history[DISASM_HISTORY];
+    int count = 0;
+
+    for (;;) {
+        size_t offset;
+        if (!ToOffset(addr, &offset) || insn_[offset] || (map_[offset] & CDL_CODE)) {
+            return;     // left ROM, already traced, or inside another instruction
+        }
+        const Cpu::opcode_t op = Cpu::GetOpcode(prg_[offset]);
+        if (op.op == Cpu::OP_INVALID) {
+            return;
+        }
+        for (int i = 1; i < op.size; i++) {
+            size_t operand_offset;
+            if (!ToOffset(addr + i, &operand_offset) || (map_[operand_offset] & CDL_CODE)) {
+                return;
+            }
+        }
+
+        insn cur;
+        cur.addr = addr;
+        cur.opcode = prg_[offset];
+        cur.operand = (op.size == 3) ? ReadWord(addr + 1) :
+                      (op.size == 2) ? ReadByte(addr + 1) : 0;
+        insn_[offset] = 1;
+        for (int i = 0; i < op.size; i++) {
+            size_t code_offset = 0;
+            ToOffset(addr + i, &code_offset);
+            map_[code_offset] |= CDL_CODE;
+        }
+
+        switch (op.op) {
+            case Cpu::OP_JSR:
+                Queue(cur.operand, false);
+                if (IsJumpEngine(cur.operand)) {
+                    // inline word table after the JSR, which never returns here
+                    AddJumpTable(addr + 3, addr + 4, 0);
+                    return;
+                }
+                break;
+            case Cpu::OP_JMP:
+                if (op.mode == Cpu::MODE_ABSOLUTE) {
+                    Queue(cur.operand, false);
+                } else if (cur.operand >= 0x8000) {
+                    MarkData(cur.operand, 2);
+                    Queue(ReadWord(cur.operand), true);
+                } else {
+                    MatchJumpTable(history, count, cur);
+                }
+                return;
+            case Cpu::OP_RTS:
+                MatchJumpTable(history, count, cur);
+                return;
+            case Cpu::OP_RTI:
+            case Cpu::OP_BRK:
+                return;
+            case Cpu::OP_STA:
+            case Cpu::OP_STX:
+            case Cpu::OP_STY:
+            case Cpu::OP_SAX:
+                // writes to ROM space go to mapper registers
+                break;
+            default:
+                if (op.mode == Cpu::MODE_RELATIVE) {
+                    Queue(addr + 2 + (int8_t)cur.operand, false);
+                } else if ((op.mode == Cpu::MODE_ABSOLUTE ||
+                            op.mode == Cpu::MODE_ABSOLUTE_X_INDEXED ||
+                            op.mode == Cpu::MODE_ABSOLUTE_Y_INDEXED) && cur.operand >= 0x8000) {
+                    MarkData(cur.operand, 1);
+                }
+                break;
+        }
+
+        if (count == DISASM_HISTORY) {
+            for (int i = 1; i < DISASM_HISTORY; i++) {
+                history[i - 1] = history[i];
+            }
+            --count;
+        }
+        history[count++] = cur;
+        addr += op.size;
+    }
+}
+
+bool Disassembler::IsJumpEngine(uint16_t addr) const {
+    return ReadByte(addr) == OPCODE_ASL_A &&
+           ReadByte(addr + 1) == OPCODE_TAY &&
+           ReadByte(addr + 2) == OPCODE_PLA;
+}
+
+void Disassembler::AddJumpTable(uint16_t lo, uint16_t hi, int adjust) {
+    for (const jump_table& table : tables_) {
+        if (table.lo == lo && table.hi == hi) {
+            return;
+        }
+    }
+    jump_table table;
+    table.lo = lo;
+    table.hi = hi;
+    table.stride = (hi == lo + 1) ? 2 : 1;
+    table.adjust = adjust;
+    tables_.push_back(table);
+}
+
+void Disassembler::ReadJumpTable(const jump_table& table) {
+    for (int i = 0; i < DISASM_MAX_JUMP_TABLE; i++) {
+        uint16_t lo = table.lo + i * table.stride;
+        uint16_t hi = table.hi + i * table.stride;
+        size_t lo_offset, hi_offset;
+        if (!ToOffset(lo, &lo_offset) || !ToOffset(hi, &hi_offset)) {
+            break;
+        }
+        // the table ends at known code, or where the high byte table starts
+        if ((map_[lo_offset] & CDL_CODE) || (map_[hi_offset] & CDL_CODE)) {
+            break;
+        }
+        if (i > 0 && (label_[lo_offset] || (table.stride == 1 && lo == table.hi))) {
+            break;
+        }
+        uint16_t target = (prg_[lo_offset] | (prg_[hi_offset] << 8)) + table.adjust;
+        if (target < 0x8000) {
+            break;
+        }
+        MarkData(lo, 1);
+        MarkData(hi, 1);
+        Queue(target, true);
+    }
+}
+
+void Disassembler::MatchJumpTable(const insn* history, int count, const insn& last) {
+    const Cpu::opcode_t op = Cpu::GetOpcode(last.opcode);
+
+    if (op.op == Cpu::OP_JMP) {
+        // LDA lo,X / STA ptr / LDA hi,X / STA ptr+1 / JMP (ptr), in any order
+        int lo = -1, hi = -1;
+        for (int i = 1; i < count; i++) {
+            const insn& load = history[i - 1];
+            const insn& store = history[i];
+            if ((store.opcode != OPCODE_STA_ZP && store.opcode != OPCODE_STA_ABS) ||
+                (load.opcode != OPCODE_LDA_ABSX && load.opcode != OPCODE_LDA_ABSY)) {
+                continue;
+            }
+            if (store.operand == last.operand) {
+                lo = load.operand;
+            } else if (store.operand == (uint16_t)(last.operand + 1)) {
+                hi = load.operand;
+            }
+        }
+        if (lo >= 0 && hi >= 0) {
+            AddJumpTable(lo, hi, 0);
+        }
+    } else if (count >= 4) {
+        // LDA hi,X / PHA / LDA lo,X / PHA / RTS
+        const insn* h = &history[count - 4];
+        bool indexed = (h[0].opcode == OPCODE_LDA_ABSX || h[0].opcode == OPCODE_LDA_ABSY) &&
+                       h[2].opcode == h[0].opcode;
+        if (indexed && h[1].opcode == OPCODE_PHA && h[3].opcode == OPCODE_PHA) {
+            AddJumpTable(h[2].operand, h[0].operand, 1);
+        }
+    }
+}
+
+int Disassembler::Format(uint16_t addr, const uint8_t* bytes, char* buf, size_t len) {
+    const Cpu::opcode_t op = Cpu::GetOpcode(bytes[0]);
+    uint16_t operand = (op.size == 3) ? (bytes[1] | (bytes[2] << 8)) :
+                       (op.size == 2) ? bytes[1] : 0;
+
+    switch (op.mode) {
+        case Cpu::MODE_ACCUMULATOR:
+            snprintf(buf, len, "%s A", op.name);
+            break;
+        case Cpu::MODE_IMPLIED:
+            snprintf(buf, len, "%s", op.name);
+            break;
+        case Cpu::MODE_IMMEDIATE:
+            snprintf(buf, len, "%s #$%02X", op.name, operand);
+            break;
+        case Cpu::MODE_ZEROPAGE:
+            snprintf(buf, len, "%s $%02X", op.name, operand);
+            break;
+        case Cpu::MODE_ZEROPAGE_X_INDEXED:
+            snprintf(buf, len, "%s $%02X,X", op.name, operand);
+            break;
+        case Cpu::MODE_ZEROPAGE_Y_INDEXED:
+            snprintf(buf, len, "%s $%02X,Y", op.name, operand);
+            break;
+        case Cpu::MODE_ABSOLUTE:
+            snprintf(buf, len, "%s $%04X", op.name, operand);
+            break;
+        case Cpu::MODE_ABSOLUTE_X_INDEXED:
+            snprintf(buf, len, "%s $%04X,X", op.name, operand);
+            break;
+        case Cpu::MODE_ABSOLUTE_Y_INDEXED:
+            snprintf(buf, len, "%s $%04X,Y", op.name, operand);
+            break;
+        case Cpu::MODE_INDIRECT:
+            snprintf(buf, len, "%s ($%04X)", op.name, operand);
+            break;
+        case Cpu::MODE_X_INDEXED_INDIRECT:
+            snprintf(buf, len, "%s ($%02X,X)", op.name, operand);
+            break;
+        case Cpu::MODE_INDIRECT_Y_INDEXED:
+            snprintf(buf, len, "%s ($%02X),Y", op.name, operand);
+            break;
+        case Cpu::MODE_RELATIVE:
+            snprintf(buf, len, "%s $%04X", op.name, (uint16_t)(addr + 2 + (int8_t)operand));
+            break;
+        default:
+            snprintf(buf, len, ".byte $%02X", bytes[0]);
+            return 1;
+    }
+    return op.size;
+}
+
+void Disassembler::WriteListing(ostream& os) const {
+    char text[32];
+    char line[96];
+
+    size_t offset = 0;
+    while (offset < size_) {
+        uint16_t addr = base_ + offset;
+        if (label_[offset] && insn_[offset]) {
+            snprintf(line, sizeof(line), "L%04X:\n", addr);
+            os << line;
+        }
+
+        if (insn_[offset]) {
+            int size = Format(addr, &prg_[offset], text, sizeof(text));
+            char hex[9] = "";
+            int pos = 0;
+            for (int i = 0; i < size; i++) {
+                pos += snprintf(hex + pos, sizeof(hex) - pos, i ? " %02X" : "%02X", prg_[offset + i]);
+            }
+            snprintf(line, sizeof(line), "%04X  %-8s  %s\n", addr, hex, text);
+            os << line;
+            offset += size;
+            continue;
+        }
+
+        // a run of up to 8 bytes of the same class
+        bool data = (map_[offset] & CDL_DATA) != 0;
+        size_t end = offset + 1;
+        while (end < size_ && end - offset < 8 && !insn_[end] &&
+               ((map_[end] & CDL_DATA) != 0) == data) {
+            ++end;
+        }
+        int pos = snprintf(line, sizeof(line), "%04X  .byte ", addr);
+        for (size_t i = offset; i < end; i++) {
+            pos += snprintf(line + pos, sizeof(line) - pos, i > offset ? ",$%02X" : "$%02X", prg_[i]);
+        }
+        snprintf(line + pos, sizeof(line) - pos, data ? "\n" : "    ; unknown\n");
+        os << line;
+        offset = end;
+    }
+}
+
+bool Disassembler::SaveMap(const char* filename, size_t chr_size) const {
+    ofstream file(filename, ios::out | ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.write((const char*)map_.data(), map_.size());
+    vector<uint8_t> chr(chr_size, 0);
+    file.write((const char*)chr.data(), chr.size());
+    return (bool)file;
+}
@@ -0,0 +1,80 @@
+#ifndef _DISASSEMBLER_H
+#define _DISASSEMBLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "CodeDataMap.h"
+
+#define DISASM_MAX_JUMP_TABLE   128     // entries read from one detected table
+#define DISASM_HISTORY          8       // instructions kept for pattern matching
+
+// Static recursive-descent analysis of a PRG-ROM mapped at $8000-$FFFF
+// (NROM: 16 KB images are mirrored). Walks from the NMI, reset and IRQ
+// vectors, following JMP/JSR/branches and jump tables recognised from the
+// usual idioms:
+//   LDA lo,X / STA ptr / LDA hi,X / STA ptr+1 / JMP (ptr)
+//   LDA hi,X / PHA / LDA lo,X / PHA / RTS
+//   JSR engine, where engine starts with ASL A / TAY / PLA (inline table)
+// The result is a CDL map (CodeDataMap.h) and a listing.
+class Disassembler {
+public:
+    Disassembler(const uint8_t* prg, size_t size);
+    ~Disassembler() = default;
+
+    // Adds the three vectors as entry points and analyzes everything
+    // reachable from them and from AddEntryPoint.
+    void Analyze(void);
+    void AddEntryPoint(uint16_t addr);
+
+    const std::vector<uint8_t>& GetMap(void) const { return map_; }
+    bool IsInstruction(size_t offset) const { return insn_[offset] != 0; }
+    size_t GetCodeBytes(void) const;
+    size_t GetDataBytes(void) const;
+    size_t GetJumpTables(void) const { return tables_.size(); }
+
+    void WriteListing(std::ostream& os) const;
+    // CDL file, with chr_size zeroed CHR flags after the PRG map.
+    bool SaveMap(const char* filename, size_t chr_size=0) const;
+
+    // One instruction in nestest log syntax, e.g. "LDA $0200,X".
+    // Returns the instruction size.
+    static int Format(uint16_t addr, const uint8_t* bytes, char* buf, size_t len);
+
+private:
+    typedef struct {
+        uint16_t addr;
+        uint8_t opcode;
+        uint16_t operand;
+    } insn;
+
+    typedef struct {
+        uint16_t lo;        // table of target low bytes
+        uint16_t hi;        // table of target high bytes
+        int stride;         // 2 for interleaved word tables
+        int adjust;         // 1 for RTS tables, which hold target - 1
+    } jump_table;
+
+    const uint8_t* prg_;
+    size_t size_;
+    uint16_t base_;                 // CPU address listed for offset 0
+    std::vector<uint8_t> map_;
+    std::vector<uint8_t> insn_;     // 1 at instruction starts
+    std::vector<uint8_t> label_;    // 1 at branch/jump targets
+    std::vector<uint16_t> pending_;
+    std::vector<jump_table> tables_;
+
+    bool ToOffset(uint16_t addr, size_t* offset) const;
+    uint8_t ReadByte(uint16_t addr) const;
+    uint16_t ReadWord(uint16_t addr) const;
+    void Queue(uint16_t addr, bool indirect);
+    void MarkData(uint16_t addr, size_t len);
+    void Trace(uint16_t addr);
+    bool IsJumpEngine(uint16_t addr) const;
+    void AddJumpTable(uint16_t lo, uint16_t hi, int adjust);
+    void ReadJumpTable(const jump_table& table);
+    void MatchJumpTable(const insn* history, int count, const insn& last);
+};
+
+#endif
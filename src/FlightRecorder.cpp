@@ -0,0 +1,212 @@
+#include "FlightRecorder.h"
+#include "Logging.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+static const uint8_t flight_magic[4] = { 0x4E, 0x46, 0x52, 0x1A };
+static const int fatal_signals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+
+#define FLIGHT_ALT_STACK_SIZE   0x10000
+
+// Read by the signal handler.
+static FlightRecorder* volatile signal_recorder = nullptr;
+// Handlers run here, so a stack overflow can still be dumped.
+static char alt_stack[FLIGHT_ALT_STACK_SIZE];
+
+FlightRecorder::FlightRecorder(uint32_t capacity) :
+    mask_(0), pos_(0), last_(0), cycles_(0), illegal_dumped_(false)
+{
+    uint32_t size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    ring_.resize(size);
+    memset(ring_.data(), 0, size * sizeof(flight_record));
+    mask_ = size - 1;
+    dump_file_[0] = '\0';
+}
+
+FlightRecorder::~FlightRecorder() {
+    if (signal_recorder == this) {
+        signal_recorder = nullptr;
+    }
+}
+
+void FlightRecorder::SetDumpFile(const char* filename) {
+    strncpy(dump_file_, filename, sizeof(dump_file_) - 1);
+    dump_file_[sizeof(dump_file_) - 1] = '\0';
+}
+
+static bool WriteAll(int fd, const void* data, size_t size) {
+    const char* p = (const char*)data;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Only async-signal-safe calls from here on.
+bool FlightRecorder::WriteDump(int fd, flight_reason reason, int signal) const {
+    uint64_t size = ring_.size();
+    uint64_t count = pos_ < size ? pos_ : size;
+    uint64_t first = (pos_ - count) & mask_;
+
+    flight_hdr header;
+    memcpy(header.magic, flight_magic, sizeof(header.magic));
+    header.version = FLIGHT_VERSION;
+    header.record_size = sizeof(flight_record);
+    header.count = count;
+    header.total = pos_;
+    header.cycles = cycles_;
+    header.reason = reason;
+    header.signal = signal;
+
+    // oldest first: the tail of the ring, then its head
+    uint64_t tail = size - first < count ? size - first : count;
+    return WriteAll(fd, &header, sizeof(header)) &&
+           WriteAll(fd, &ring_[first], tail * sizeof(flight_record)) &&
+           WriteAll(fd, &ring_[0], (count - tail) * sizeof(flight_record));
+}
+
+bool FlightRecorder::Dump(const char* filename, flight_reason reason) const {
+    int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = WriteDump(fd, reason, 0);
+    return close(fd) == 0 && ok;
+}
+
+void FlightRecorder::OnStateLoad(uint64_t cycles) {
+    // going forward, e.g. back from run-ahead, leaves the counts monotonic
+    if (cycles >= cycles_) {
+        return;
+    }
+    flight_record& rec = ring_[pos_++ & mask_];
+    memset(&rec, 0, sizeof(rec));
+    rec.cycles = cycles_;
+    rec.addr = cycles_ >> 32;
+    rec.operand = cycles_ >> 48;
+    rec.type = FLIGHT_STATE_LOAD;
+    cycles_ = cycles;
+}
+
+void FlightRecorder::OnIllegalOpcode(void) {
+    if (illegal_dumped_ || dump_file_[0] == '\0') {
+        return;
+    }
+    illegal_dumped_ = true;
+    if (Dump(dump_file_, FLIGHT_REASON_ILLEGAL)) {
+        LOG(CPU, ERROR, std::string("Illegal opcode, flight recorder written to ") + dump_file_);
+    }
+}
+
+void FlightRecorder::OnSignal(int signal) {
+    // the interrupted code may be about to look at errno
+    int saved_errno = errno;
+    FlightRecorder* recorder = signal_recorder;
+    if (recorder != nullptr && recorder->dump_file_[0] != '\0') {
+        int fd = open(recorder->dump_file_, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            recorder->WriteDump(fd, FLIGHT_REASON_SIGNAL, signal);
+            close(fd);
+        }
+    }
+    if (signal != SIGUSR1) {
+        // the handler was reset on entry: die the way we would have
+        raise(signal);
+    }
+    errno = saved_errno;
+}
+
+void FlightRecorder::InstallSignalHandlers(FlightRecorder* recorder) {
+    signal_recorder = recorder;
+
+    stack_t stack;
+    stack.ss_sp = alt_stack;
+    stack.ss_size = sizeof(alt_stack);
+    stack.ss_flags = 0;
+    sigaltstack(&stack, nullptr);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = OnSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_ONSTACK | SA_RESETHAND;
+    for (int signal : fatal_signals) {
+        sigaction(signal, &action, nullptr);
+    }
+    action.sa_flags = SA_ONSTACK | SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+}
+
+bool FlightRecorder::Load(const char* filename, flight_hdr* header,
+                          vector<flight_record>* records, vector<uint64_t>* cycles) {
+    ifstream file(filename, ios::in | ios::binary);
+    if (!file.read((char*)header, sizeof(*header)) ||
+        memcmp(header->magic, flight_magic, sizeof(header->magic)) != 0 ||
+        header->version != FLIGHT_VERSION ||
+        header->record_size != sizeof(flight_record)) {
+        return false;
+    }
+    // reject a count the file is too short for before allocating it
+    file.seekg(0, ios::end);
+    uint64_t size = (uint64_t)file.tellg() - sizeof(*header);
+    if (header->count > size / sizeof(flight_record)) {
+        return false;
+    }
+    file.seekg(sizeof(*header));
+    records->resize(header->count);
+    if (!file.read((char*)records->data(), records->size() * sizeof(flight_record))) {
+        return false;
+    }
+
+    // between markers counts only move forward, so each record is at most
+    // 2^32 cycles before the next one
+    cycles->resize(records->size());
+    uint64_t full = header->cycles;
+    for (size_t i = records->size(); i-- > 0;) {
+        const flight_record& rec = (*records)[i];
+        if (rec.type == FLIGHT_STATE_LOAD) {
+            full = ((uint64_t)rec.operand << 48) | ((uint64_t)rec.addr << 32) | rec.cycles;
+        } else {
+            full -= (uint32_t)((uint32_t)full - rec.cycles);
+        }
+        (*cycles)[i] = full;
+    }
+    return true;
+}
+
+string FlightRecorder::Format(const flight_record& rec, uint64_t cycles) {
+    if (rec.type == FLIGHT_STATE_LOAD) {
+        return "      ; state loaded, cycles went back";
+    }
+    if (rec.type == FLIGHT_WRITE) {
+        stringstream ss;
+        ss << hex << setfill('0') << uppercase
+           << "      $" << setw(4) << rec.addr << " <- " << setw(2) << (int)rec.data
+           << dec << "  CPUC:" << cycles;
+        return ss.str();
+    }
+    registers reg;
+    reg.A = rec.A;
+    reg.X = rec.X;
+    reg.Y = rec.Y;
+    reg.PC = rec.addr;
+    reg.SP = rec.SP;
+    reg.P = rec.P;
+    return Cpu::FormatTrace(reg, rec.data, rec.operand, cycles);
+}
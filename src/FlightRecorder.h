@@ -0,0 +1,141 @@
+#ifndef _FLIGHT_RECORDER_H
+#define _FLIGHT_RECORDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Cpu.h"
+
+#define FLIGHT_VERSION      1
+#define FLIGHT_RECORDS      4096    // ring size, a power of two (64 KB)
+#define FLIGHT_PATH_MAX     256
+
+// Dump file layout:
+//   flight_hdr
+//   flight_record records[count], oldest first
+// Records keep the low 32 bits of the cycle count; the full count of the
+// newest one is in the header, and the decoder (Load) unwraps backwards
+// from it. Where the count went back (a state was loaded) a marker record
+// holds the full count of the record before it.
+
+enum flight_record_type {
+    FLIGHT_INSTRUCTION = 1,     // registers before the instruction ran
+    FLIGHT_WRITE,               // CPU bus write during the last instruction
+    FLIGHT_STATE_LOAD           // cycles went back; addr and operand are the
+                                // high 32 bits of the count before
+};
+
+enum flight_reason {
+    FLIGHT_REASON_REQUEST,
+    FLIGHT_REASON_ILLEGAL,      // OP_INVALID was executed
+    FLIGHT_REASON_SIGNAL        // the signal is in flight_hdr.signal
+};
+
+typedef struct {
+    uint32_t cycles;            // low 32 bits
+    uint16_t addr;              // instruction PC, or write address
+    uint16_t operand;           // operand bytes, or 0
+    uint8_t type;               // flight_record_type
+    uint8_t data;               // opcode, or value written
+    uint8_t A;
+    uint8_t X;
+    uint8_t Y;
+    uint8_t P;
+    uint8_t SP;
+    uint8_t reserved;
+} flight_record;
+
+typedef struct {
+    uint8_t magic[4];           // 0x4E 0x46 0x52 0x1A ("NFR" followed by DOS EOF)
+    uint32_t version;
+    uint32_t record_size;       // sizeof(flight_record)
+    uint32_t count;             // records that follow
+    uint64_t total;             // records ever written, including overwritten ones
+    uint64_t cycles;            // full cycle count of the newest record
+    uint32_t reason;            // flight_reason
+    uint32_t signal;
+} flight_hdr;
+
+// Always-on history of the last instructions and bus writes, cheap enough
+// to leave attached in production (Nes::SetFlightRecorder): one 16-byte
+// store per instruction or write. The ring is written out on request, the
+// first time the CPU executes an illegal opcode, and from a fatal signal
+// once InstallSignalHandlers has run. Dumping only uses open/write/close on
+// preallocated memory, so it is async-signal-safe.
+class FlightRecorder {
+public:
+    FlightRecorder(uint32_t capacity=FLIGHT_RECORDS);
+    ~FlightRecorder();
+
+    uint32_t GetCapacity(void) const { return ring_.size(); }
+
+    // Where automatic dumps go.
+    void SetDumpFile(const char* filename);
+    const char* GetDumpFile(void) const { return dump_file_; }
+    bool Dump(const char* filename, flight_reason reason=FLIGHT_REASON_REQUEST) const;
+
+    void RecordInstruction(const registers& reg, uint8_t opcode, uint16_t operand,
+                           uint64_t cycles) {
+        last_ = pos_;
+        flight_record& rec = ring_[pos_++ & mask_];
+        rec.cycles = cycles;
+        rec.addr = reg.PC;
+        rec.operand = operand;
+        rec.type = FLIGHT_INSTRUCTION;
+        rec.data = opcode;
+        rec.A = reg.A;
+        rec.X = reg.X;
+        rec.Y = reg.Y;
+        rec.P = reg.P;
+        rec.SP = reg.SP;
+        cycles_ = cycles;
+    }
+    // CycleCpu records an instruction at its opcode fetch, so writes come
+    // after it as in Cpu::Step, and fills the operand in once it's read.
+    void SetOperand(uint16_t operand) {
+        if (pos_ - last_ <= mask_) {
+            ring_[last_ & mask_].operand = operand;
+        }
+    }
+    void RecordWrite(uint16_t addr, uint8_t data) {
+        flight_record& rec = ring_[pos_++ & mask_];
+        rec.cycles = cycles_;
+        rec.addr = addr;
+        rec.operand = 0;
+        rec.type = FLIGHT_WRITE;
+        rec.data = data;
+    }
+    // Nes::LoadState, with the cycle count of the loaded state.
+    void OnStateLoad(uint64_t cycles);
+    // Dumps to the dump file once; a jammed CPU keeps re-executing the
+    // opcode.
+    void OnIllegalOpcode(void);
+    bool HasDumpedIllegal(void) const { return illegal_dumped_; }
+    uint64_t GetTotal(void) const { return pos_; }
+
+    // SIGSEGV, SIGBUS, SIGILL, SIGFPE and SIGABRT dump recorder to its
+    // dump file before the process dies; SIGUSR1 dumps and carries on.
+    // One recorder per process; nullptr leaves the handlers installed but
+    // stops the dumps.
+    static void InstallSignalHandlers(FlightRecorder* recorder);
+
+    // Reads a dump; cycles receives the full cycle count of every record.
+    static bool Load(const char* filename, flight_hdr* header,
+                     std::vector<flight_record>* records, std::vector<uint64_t>* cycles);
+    // nestest.log format for instructions; writes are indented below them.
+    static std::string Format(const flight_record& rec, uint64_t cycles);
+
+private:
+    std::vector<flight_record> ring_;
+    uint64_t mask_;
+    uint64_t pos_;
+    uint64_t last_;         // pos_ of the last instruction
+    uint64_t cycles_;
+    bool illegal_dumped_;
+    char dump_file_[FLIGHT_PATH_MAX];
+
+    bool WriteDump(int fd, flight_reason reason, int signal) const;
+    static void OnSignal(int signal);
+};
+
+#endif
@@ -0,0 +1,117 @@
+#include "FramePipeline.h"
+#include "Nes.h"
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+#define PIPELINE_IDLE_WAIT_MS   2
+
+static uint64_t NowNs(void) {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FramePipeline::FramePipeline(IVideoOutput* output, int scale) :
+    output_(output), scale_(scale < 1 ? 1 : scale), ntsc_(nullptr), running_(false),
+    produced_(0), presented_(0), skipped_(0), latency_ns_(0)
+{
+    SetNtscFilter(nullptr);
+}
+
+FramePipeline::~FramePipeline() {
+    Stop();
+}
+
+void FramePipeline::SetNtscFilter(const NtscFilter* ntsc) {
+    ntsc_ = ntsc;
+    size_t size = (ntsc_ != nullptr) ? NTSC_WIDTH * NTSC_HEIGHT : PPU_WIDTH * PPU_HEIGHT;
+    rgb_.resize(size);
+    scaled_.resize(size * scale_ * scale_);
+}
+
+void FramePipeline::Start(void) {
+    if (running_) {
+        return;
+    }
+    running_ = true;
+    thread_ = thread(&FramePipeline::Run, this);
+}
+
+void FramePipeline::Stop(void) {
+    if (!running_) {
+        return;
+    }
+    running_ = false;
+    wake_.notify_one();
+    thread_.join();
+    if (frames_.Acquire()) {
+        Present(*frames_.GetFront());
+    }
+}
+
+// Emulation thread: a 60 KB copy, then straight back to the next frame.
+void FramePipeline::OnFrame(Nes* nes) {
+    video_frame* frame = frames_.GetBack();
+    frame->frame = nes->GetFrame();
+    frame->emphasis = nes->GetEmphasis();
+    memcpy(frame->pixels, nes->GetFrameBuffer(), sizeof(frame->pixels));
+    frame->time_ns = NowNs();
+    if (frames_.Publish()) {
+        skipped_++;
+    }
+    produced_++;
+    wake_.notify_one();
+}
+
+void FramePipeline::Run(void) {
+    unique_lock<mutex> guard(lock_);
+    while (running_) {
+        if (!frames_.Acquire()) {
+            // a notify between Acquire and the wait is caught by the timeout
+            wake_.wait_for(guard, chrono::milliseconds(PIPELINE_IDLE_WAIT_MS));
+            continue;
+        }
+        Present(*frames_.GetFront());
+    }
+}
+
+void FramePipeline::Present(const video_frame& frame) {
+    int width = PPU_WIDTH;
+    if (ntsc_ != nullptr) {
+        ntsc_->Filter(frame.pixels, frame.emphasis, frame.frame, rgb_.data());
+        width = NTSC_WIDTH;
+    } else {
+        palette_.Convert(frame.pixels, rgb_.data(), rgb_.size());
+    }
+
+    const uint32_t* out = rgb_.data();
+    if (scale_ > 1) {
+        // nearest neighbour: widen each row once, then repeat it
+        int scaled_width = width * scale_;
+        for (int y = 0; y < PPU_HEIGHT; y++) {
+            uint32_t* row = &scaled_[(size_t)y * scale_ * scaled_width];
+            const uint32_t* src = &rgb_[y * width];
+            for (int x = 0; x < scaled_width; x++) {
+                row[x] = src[x / scale_];
+            }
+            for (int k = 1; k < scale_; k++) {
+                memcpy(row + k * scaled_width, row, scaled_width * sizeof(uint32_t));
+            }
+        }
+        out = scaled_.data();
+    }
+    output_->OnVideoFrame(out, width * scale_, PPU_HEIGHT * scale_, frame.frame);
+
+    latency_ns_ += NowNs() - frame.time_ns;
+    presented_++;
+}
+
+pipeline_stats FramePipeline::GetStats(void) const {
+    pipeline_stats stats;
+    stats.produced = produced_;
+    stats.presented = presented_;
+    stats.skipped = skipped_;
+    stats.latency_ns = latency_ns_;
+    return stats;
+}
@@ -0,0 +1,79 @@
+#ifndef _FRAME_PIPELINE_H
+#define _FRAME_PIPELINE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "IFrameSink.h"
+#include "IVideoOutput.h"
+#include "NtscFilter.h"
+#include "Palette.h"
+#include "Ppu.h"
+#include "TripleBuffer.h"
+
+typedef struct {
+    uint64_t produced;      // frames handed over by the emulation thread
+    uint64_t presented;     // frames sent to the output
+    uint64_t skipped;       // frames replaced by a newer one before conversion
+    uint64_t latency_ns;    // sum over presented frames, handoff to output done
+} pipeline_stats;
+
+// Second pipeline stage: as the Nes frame sink it copies each frame's
+// palette indices into a triple buffer and returns, and its own thread
+// converts the newest frame to RGB (or runs the NTSC filter), scales it and
+// passes it to the output.
+// Emulation of the next frame overlaps conversion of the last one; when
+// the output falls behind, stale frames are skipped rather than queued.
+class FramePipeline : public IFrameSink {
+public:
+    FramePipeline(IVideoOutput* output, int scale=1);
+    ~FramePipeline();
+
+    // Palette to convert with; set before Start.
+    Palette* GetPalette(void) { return &palette_; }
+    // Replaces the palette conversion, doubling the width; nullptr to turn
+    // it off. Set before Start.
+    void SetNtscFilter(const NtscFilter* ntsc);
+
+    void Start(void);
+    // Presents the last frame if it is still pending, then joins the thread.
+    void Stop(void);
+
+    virtual void OnFrame(Nes* nes);
+
+    pipeline_stats GetStats(void) const;
+
+private:
+    typedef struct {
+        uint64_t frame;
+        uint64_t time_ns;   // steady clock at handoff
+        uint8_t emphasis;
+        uint8_t pixels[PPU_WIDTH * PPU_HEIGHT];
+    } video_frame;
+
+    IVideoOutput* output_;
+    int scale_;
+    Palette palette_;
+    const NtscFilter* ntsc_;
+    TripleBuffer<video_frame> frames_;
+    std::vector<uint32_t> rgb_;
+    std::vector<uint32_t> scaled_;
+
+    std::thread thread_;
+    std::atomic<bool> running_;
+    std::mutex lock_;           // only for sleeping while there is no frame
+    std::condition_variable wake_;
+
+    std::atomic<uint64_t> produced_;
+    std::atomic<uint64_t> presented_;
+    std::atomic<uint64_t> skipped_;
+    std::atomic<uint64_t> latency_ns_;
+
+    void Run(void);
+    void Present(const video_frame& frame);
+};
+
+#endif
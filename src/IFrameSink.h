@@ -0,0 +1,14 @@
+#ifndef _IFRAME_SINK_H
+#define _IFRAME_SINK_H
+
+class Nes;
+
+class IFrameSink {
+public:
+    virtual ~IFrameSink() = default;
+
+    // Called at the end of every frame that is run with output enabled.
+    virtual void OnFrame(Nes* nes) = 0;
+};
+
+#endif
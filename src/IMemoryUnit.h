@@ -9,6 +9,11 @@ public:
 
     virtual uint8_t Read8(uint16_t addr) = 0;
     virtual void Write8(uint16_t addr, uint8_t data) = 0;
+
+    // Direct pointer to the 256 bytes of the page starting at addr, for
+    // units whose reads are plain memory without side effects. Bulk
+    // transfers use it to skip per-byte Read8 calls.
+    virtual const uint8_t* GetPage(uint16_t addr) { return nullptr; }
 };
 
 #endif
@@ -0,0 +1,15 @@
+#ifndef _ISEARCH_SCORE_H
+#define _ISEARCH_SCORE_H
+
+#include <cstdint>
+
+class ISearchScore {
+public:
+    virtual ~ISearchScore() = default;
+
+    // Rates a state from its RAM_SIZE bytes of internal RAM; higher is
+    // better. Called from every search worker at once.
+    virtual double Score(const uint8_t* ram) = 0;
+};
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef _ITRACE_SINK_H
+#define _ITRACE_SINK_H
+
+#include <cstdint>
+#include "Cpu.h"
+
+class ITraceSink {
+public:
+    virtual ~ITraceSink() = default;
+
+    // Every traced instruction, with the registers and cycle count before
+    // it runs; operand bytes past the instruction's size are 0.
+    virtual void OnInstruction(const registers& reg, uint8_t opcode, uint16_t operand,
+                               uint64_t cycles) = 0;
+};
+
+#endif
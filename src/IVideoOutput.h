@@ -0,0 +1,15 @@
+#ifndef _IVIDEO_OUTPUT_H
+#define _IVIDEO_OUTPUT_H
+
+#include <cstdint>
+
+class IVideoOutput {
+public:
+    virtual ~IVideoOutput() = default;
+
+    // A finished frame of 0x00RRGGBB pixels, row by row. Called from the
+    // FramePipeline thread; rgb is only valid during the call.
+    virtual void OnVideoFrame(const uint32_t* rgb, int width, int height, uint64_t frame) = 0;
+};
+
+#endif
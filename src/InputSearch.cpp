@@ -0,0 +1,319 @@
+#include "InputSearch.h"
+#include "DeltaCodec.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <unordered_set>
+
+using namespace std;
+
+#define DROPPED     0xFFFFFFFF
+// pool waits are timed, like Logging's: the untimed wait needs a newer
+// libstdc++ runtime than the one some builds run against
+#define WAIT_MS     100
+
+struct InputSearch::Worker {
+    unique_ptr<Nes> nes;    // allocated on its own, cache-aligned
+    nes_state state;        // restored beam state
+    nes_state child;
+    vector<uint8_t> delta;
+    vector<candidate> candidates;
+
+    mutex lock;
+    deque<uint32_t> queue;  // own tasks from the back, stolen from the front
+
+    uint64_t expanded;
+    uint64_t frames;
+    uint64_t steals;
+};
+
+InputSearch::InputSearch(const char* rom, ISearchScore* score, const search_config& config) :
+    score_(score), config_(config), loaded_(true), batch_(0), running_(0), stop_(false),
+    task_(nullptr), arena_(config.arena_size), arena_used_(0), arena_base_(0)
+{
+    static const uint8_t inputs[] = {
+        0, Controller::BUTTON_A, Controller::BUTTON_B, Controller::BUTTON_SELECT,
+        Controller::BUTTON_START, Controller::BUTTON_UP, Controller::BUTTON_DOWN,
+        Controller::BUTTON_LEFT, Controller::BUTTON_RIGHT
+    };
+    SetInputs(inputs, sizeof(inputs));
+
+    int threads = config_.threads;
+    if (threads <= 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threads; i++) {
+        unique_ptr<Worker> worker(new Worker);
+        worker->nes.reset(new Nes);
+        worker->nes->PowerOn();
+        loaded_ = worker->nes->LoadRom(rom, SAVE_RAM_COPY) && loaded_;
+        worker->delta.resize(DeltaCodec::Bound(sizeof(nes_state)));
+        workers_.push_back(move(worker));
+    }
+    for (int i = 1; i < threads; i++) {
+        pool_.emplace_back(&InputSearch::PoolThread, this, i);
+    }
+    memset(&stats_, 0, sizeof(stats_));
+}
+
+InputSearch::~InputSearch() {
+    {
+        lock_guard<mutex> lock(pool_mutex_);
+        stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (thread& t : pool_) {
+        t.join();
+    }
+}
+
+search_config InputSearch::DefaultConfig(void) {
+    search_config config;
+    config.depth = 60;
+    config.frames_per_step = 1;
+    config.beam_width = 64;
+    config.threads = 0;
+    config.arena_size = SEARCH_ARENA_SIZE;
+    return config;
+}
+
+void InputSearch::SetInputs(const uint8_t* inputs, size_t count) {
+    inputs_.assign(inputs, inputs + count);
+}
+
+void InputSearch::RunTasks(size_t count, void (InputSearch::*task)(Worker*, size_t)) {
+    size_t n = workers_.size();
+    for (size_t w = 0; w < n; w++) {
+        // contiguous blocks keep neighbouring beam entries on one worker
+        for (size_t i = count * w / n; i < count * (w + 1) / n; i++) {
+            workers_[w]->queue.push_back(i);
+        }
+    }
+
+    {
+        lock_guard<mutex> lock(pool_mutex_);
+        task_ = task;
+        running_ = pool_.size();
+        ++batch_;
+    }
+    start_cv_.notify_all();
+    RunQueue(0);
+
+    // the next batch only starts once every thread is done with this one
+    unique_lock<mutex> lock(pool_mutex_);
+    while (running_ != 0) {
+        done_cv_.wait_for(lock, chrono::milliseconds(WAIT_MS));
+    }
+}
+
+void InputSearch::PoolThread(size_t id) {
+    uint64_t batch = 0;
+    unique_lock<mutex> lock(pool_mutex_);
+    for (;;) {
+        while (!stop_ && batch_ == batch) {
+            start_cv_.wait_for(lock, chrono::milliseconds(WAIT_MS));
+        }
+        if (stop_) {
+            return;
+        }
+        batch = batch_;
+        lock.unlock();
+        RunQueue(id);
+        lock.lock();
+        if (--running_ == 0) {
+            done_cv_.notify_one();
+        }
+    }
+}
+
+void InputSearch::RunQueue(size_t id) {
+    size_t n = workers_.size();
+    Worker* self = workers_[id].get();
+    for (;;) {
+        uint32_t i;
+        bool found = false;
+        {
+            lock_guard<mutex> guard(self->lock);
+            if (!self->queue.empty()) {
+                i = self->queue.back();
+                self->queue.pop_back();
+                found = true;
+            }
+        }
+        for (size_t k = 1; k < n && !found; k++) {
+            Worker* victim = workers_[(id + k) % n].get();
+            lock_guard<mutex> guard(victim->lock);
+            if (!victim->queue.empty()) {
+                i = victim->queue.front();
+                victim->queue.pop_front();
+                found = true;
+                self->steals++;
+            }
+        }
+        // no task is added while a batch runs, so empty queues mean done
+        if (!found) {
+            return;
+        }
+        (this->*task_)(self, i);
+    }
+}
+
+void InputSearch::Restore(Worker* worker, const beam_node& node) {
+    worker->state = start_;
+    DeltaCodec::Apply((uint8_t*)&worker->state, sizeof(nes_state), arena_.data() + node.offset,
+                      node.size);
+    worker->nes->LoadState(&worker->state);
+}
+
+void InputSearch::RunStep(Worker* worker, uint8_t input) {
+    worker->nes->SetInput(0, input);
+    worker->nes->SetInput(1, 0);
+    for (int i = 0; i < config_.frames_per_step; i++) {
+        worker->nes->RunFrame(false, false, false);
+    }
+    worker->frames += config_.frames_per_step;
+}
+
+void InputSearch::Expand(Worker* worker, size_t node) {
+    for (size_t i = 0; i < inputs_.size(); i++) {
+        if (i == 0) {
+            Restore(worker, beam_[node]);
+        } else {
+            worker->nes->LoadState(&worker->state);
+        }
+        RunStep(worker, inputs_[i]);
+
+        candidate c;
+        c.node = node;
+        c.input = inputs_[i];
+        c.hash = worker->nes->GetStateHash();
+        c.score = score_->Score(worker->nes->GetRam());
+        worker->candidates.push_back(c);
+        worker->expanded++;
+    }
+}
+
+// Kept children are run again from their parent rather than stored for
+// every candidate, which bounds memory by the beam instead of the fan-out.
+void InputSearch::Store(Worker* worker, size_t index) {
+    const candidate& c = kept_[index];
+    Restore(worker, beam_[c.node]);
+    RunStep(worker, c.input);
+    worker->nes->SaveState(&worker->child);
+
+    size_t size = DeltaCodec::Encode((const uint8_t*)&worker->child, (const uint8_t*)&start_,
+                                     sizeof(nes_state), worker->delta.data());
+    size_t offset = arena_used_.fetch_add(size);
+    if (offset + size > arena_.size() / 2) {
+        next_[index].size = DROPPED;
+        return;
+    }
+    memcpy(&arena_[arena_base_ + offset], worker->delta.data(), size);
+    next_[index].offset = arena_base_ + offset;
+    next_[index].size = size;
+}
+
+double InputSearch::Run(const nes_state& start, vector<uint8_t>* path) {
+    auto start_time = chrono::steady_clock::now();
+    memset(&stats_, 0, sizeof(stats_));
+    for (auto& worker : workers_) {
+        worker->expanded = 0;
+        worker->frames = 0;
+        worker->steals = 0;
+    }
+    path->clear();
+    if (!loaded_ || workers_.empty()) {
+        return 0;
+    }
+
+    // the start is the all-zero delta
+    start_ = start;
+    links_.clear();
+    beam_node root;
+    root.offset = 0;
+    root.size = 0;
+    root.link = NO_LINK;
+    beam_.assign(1, root);
+    arena_base_ = 0;
+
+    workers_[0]->nes->LoadState(&start_);
+    double best_score = score_->Score(workers_[0]->nes->GetRam());
+    uint32_t best_link = NO_LINK;
+
+    vector<candidate> all;
+    unordered_set<uint64_t> seen;
+    for (int step = 0; step < config_.depth && !beam_.empty(); step++) {
+        for (auto& worker : workers_) {
+            worker->candidates.clear();
+        }
+        RunTasks(beam_.size(), &InputSearch::Expand);
+
+        all.clear();
+        for (auto& worker : workers_) {
+            all.insert(all.end(), worker->candidates.begin(), worker->candidates.end());
+        }
+        // a total order, so the beam doesn't depend on which worker ran what
+        sort(all.begin(), all.end(), [](const candidate& a, const candidate& b) {
+            if (a.score != b.score) {
+                return a.score > b.score;
+            }
+            if (a.node != b.node) {
+                return a.node < b.node;
+            }
+            return a.input < b.input;
+        });
+
+        kept_.clear();
+        seen.clear();
+        for (const candidate& c : all) {
+            if (!seen.insert(c.hash).second) {
+                stats_.duplicates++;
+            } else if ((int)kept_.size() < config_.beam_width) {
+                kept_.push_back(c);
+            }
+        }
+
+        next_.resize(kept_.size());
+        for (size_t i = 0; i < kept_.size(); i++) {
+            search_link link;
+            link.parent = beam_[kept_[i].node].link;
+            link.input = kept_[i].input;
+            next_[i].link = links_.size();
+            links_.push_back(link);
+        }
+        if (!kept_.empty() && kept_[0].score > best_score) {
+            best_score = kept_[0].score;
+            best_link = next_[0].link;
+        }
+
+        // the beam being expanded lives in the other half
+        arena_base_ = (arena_base_ == 0) ? arena_.size() / 2 : 0;
+        arena_used_ = 0;
+        RunTasks(kept_.size(), &InputSearch::Store);
+
+        size_t n = 0;
+        for (size_t i = 0; i < next_.size(); i++) {
+            if (next_[i].size == DROPPED) {
+                stats_.dropped++;
+            } else {
+                next_[n++] = next_[i];
+            }
+        }
+        next_.resize(n);
+        beam_.swap(next_);
+    }
+
+    for (uint32_t link = best_link; link != NO_LINK; link = links_[link].parent) {
+        path->insert(path->end(), config_.frames_per_step, links_[link].input);
+    }
+    reverse(path->begin(), path->end());
+
+    for (auto& worker : workers_) {
+        stats_.expanded += worker->expanded;
+        stats_.frames += worker->frames;
+        stats_.steals += worker->steals;
+    }
+    stats_.seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+    return best_score;
+}
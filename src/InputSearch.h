@@ -0,0 +1,124 @@
+#ifndef _INPUT_SEARCH_H
+#define _INPUT_SEARCH_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Nes.h"
+#include "ISearchScore.h"
+
+#define SEARCH_ARENA_SIZE   (64 << 20)
+
+typedef struct {
+    int depth;              // search steps
+    int frames_per_step;    // frames each input is held for
+    int beam_width;         // states kept per step
+    int threads;
+    size_t arena_size;      // bytes for stored states, two steps' worth
+} search_config;
+
+typedef struct {
+    uint64_t expanded;      // child states emulated
+    uint64_t duplicates;    // children with the state hash of a kept one
+    uint64_t dropped;       // kept states that didn't fit in the arena
+    uint64_t steals;        // expansions taken from another worker's queue
+    uint64_t frames;        // frames emulated
+    double seconds;
+} search_stats;
+
+// Beam search over port 0 controller inputs: every step tries each
+// candidate input on each state of the beam, scores the results and keeps
+// the best beam_width distinct ones (by Nes::GetStateHash). Each worker
+// thread owns a Nes with the ROM loaded; states of the beam are stored as
+// DeltaCodec deltas against the start state in a fixed arena, so memory
+// doesn't grow with the search. Frontier states are spread over per-worker
+// queues and idle workers steal from the others. Worker threads live as
+// long as the search and wait for each batch of tasks; the calling thread
+// is worker 0.
+class InputSearch {
+public:
+    InputSearch(const char* rom, ISearchScore* score, const search_config& config);
+    ~InputSearch();
+
+    static search_config DefaultConfig(void);
+
+    bool IsLoaded(void) const { return loaded_; }
+    // Inputs tried at every step; by default none and each single button.
+    void SetInputs(const uint8_t* inputs, size_t count);
+
+    // Searches from start. Returns the best score seen and its inputs, one
+    // byte per frame, in path; an empty path means start itself scored best.
+    // Results don't depend on the thread count unless states are dropped.
+    double Run(const nes_state& start, std::vector<uint8_t>* path);
+    const search_stats& GetStats(void) const { return stats_; }
+
+private:
+    typedef struct {
+        uint32_t parent;    // index in links_, NO_LINK for the start
+        uint8_t input;
+    } search_link;
+
+    typedef struct {
+        uint32_t offset;    // delta in the arena
+        uint32_t size;
+        uint32_t link;      // path to this state, NO_LINK for the start
+    } beam_node;
+
+    typedef struct {
+        uint32_t node;      // parent in the beam
+        uint8_t input;
+        uint64_t hash;
+        double score;
+    } candidate;
+
+    struct Worker;
+    static const uint32_t NO_LINK = 0xFFFFFFFF;
+
+    ISearchScore* score_;
+    search_config config_;
+    bool loaded_;
+    std::vector<uint8_t> inputs_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    // Threads of workers 1..n-1, started by the constructor and joined by
+    // the destructor. Between batches they wait on start_cv_ for batch_ to
+    // change; RunTasks sets task_ and running_, bumps batch_, and waits on
+    // done_cv_ until every pool thread has counted running_ down to zero.
+    std::vector<std::thread> pool_;
+    std::mutex pool_mutex_;
+    std::condition_variable start_cv_;
+    std::condition_variable done_cv_;
+    uint64_t batch_;        // RunTasks calls so far
+    size_t running_;        // pool threads still in the current batch
+    bool stop_;             // set by the destructor to end the threads
+    void (InputSearch::*task_)(Worker*, size_t);
+
+    nes_state start_;
+    std::vector<uint8_t> arena_;
+    std::atomic<size_t> arena_used_;
+    size_t arena_base_;     // half of the arena for the next step
+    std::vector<beam_node> beam_;
+    std::vector<beam_node> next_;
+    std::vector<candidate> kept_;   // parents of next_
+    std::vector<search_link> links_;
+    search_stats stats_;
+
+    // Runs task(worker, i) for every i < count across the workers.
+    void RunTasks(size_t count, void (InputSearch::*task)(Worker*, size_t));
+    void PoolThread(size_t id);
+    // Runs task_ on the own queue of worker id, then steals, until all
+    // queues are empty.
+    void RunQueue(size_t id);
+    // Tasks: tries every input on beam_[node]; stores next_[index].
+    void Expand(Worker* worker, size_t node);
+    void Store(Worker* worker, size_t index);
+    void Restore(Worker* worker, const beam_node& node);
+    void RunStep(Worker* worker, uint8_t input);
+};
+
+#endif
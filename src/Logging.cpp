@@ -0,0 +1,226 @@
+#include "Logging.h"
+#include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+atomic<uint8_t> Logging::levels_[LOG_CAT_COUNT];
+
+Logging::Logging() :
+    enabled_(false), policy_(OVERFLOW_BLOCK), fd_(-1), num_buffers_(0), dropped_(0),
+    stop_(false), flush_requests_(0), flushes_done_(0)
+{
+    memset(configured_levels_, LOG_LEVEL_TRACE, sizeof(configured_levels_));
+    batch_.reserve(LOG_BATCH_SIZE);
+}
+
+void Logging::SetLevel(int category, int level) {
+    configured_levels_[category] = level;
+    ApplyLevels();
+}
+
+void Logging::ApplyLevels(void) {
+    bool enabled = enabled_.load(memory_order_relaxed);
+    for (int i = 0; i < LOG_CAT_COUNT; i++) {
+        levels_[i].store(enabled ? configured_levels_[i] : LOG_LEVEL_NONE, memory_order_relaxed);
+    }
+}
+
+Logging::~Logging() {
+    Close();
+}
+
+void Logging::Init(const char* filename) {
+    Close();
+
+    fd_ = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        return;
+    }
+    filename_ = filename;
+    stop_ = false;
+    thread_ = thread(&Logging::WriterThread, this);
+    enabled_.store(true, memory_order_release);
+    ApplyLevels();
+}
+
+void Logging::Close(void) {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    enabled_.store(false, memory_order_release);
+    ApplyLevels();
+    {
+        lock_guard<mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+
+    close(fd_);
+    fd_ = -1;
+}
+
+void Logging::Flush(void) {
+    unique_lock<mutex> lock(mutex_);
+    if (!thread_.joinable()) {
+        return;
+    }
+    uint64_t request = ++flush_requests_;
+    cv_.notify_one();
+    while (flushes_done_ < request && !stop_) {
+        flushed_cv_.wait_for(lock, chrono::milliseconds(LOG_POLL_MS));
+    }
+}
+
+uint64_t Logging::GetDropped(void) const {
+    uint64_t dropped = dropped_.load(memory_order_relaxed);
+    size_t count = num_buffers_.load(memory_order_acquire);
+    for (size_t i = 0; i < count; i++) {
+        dropped += buffers_[i]->dropped.load(memory_order_relaxed);
+    }
+    return dropped;
+}
+
+Logging::log_buffer* Logging::GetBuffer(void) {
+    thread_local buffer_owner owner;
+    if (owner.buffer != nullptr) {
+        return owner.buffer;
+    }
+
+    lock_guard<mutex> lock(buffers_mutex_);
+    size_t count = num_buffers_.load(memory_order_relaxed);
+    // A ring left by an exited thread: its records are still drained in
+    // order, the new owner appends behind them.
+    for (size_t i = 0; i < count; i++) {
+        if (!buffers_[i]->owned.load(memory_order_acquire)) {
+            buffers_[i]->owned.store(true, memory_order_relaxed);
+            owner.buffer = buffers_[i].get();
+            return owner.buffer;
+        }
+    }
+    if (count == LOG_MAX_THREADS) {
+        return nullptr;
+    }
+    buffers_[count].reset(new log_buffer);
+    buffers_[count]->head.store(0, memory_order_relaxed);
+    buffers_[count]->tail.store(0, memory_order_relaxed);
+    buffers_[count]->dropped.store(0, memory_order_relaxed);
+    buffers_[count]->owned.store(true, memory_order_relaxed);
+    num_buffers_.store(count + 1, memory_order_release);
+    owner.buffer = buffers_[count].get();
+    return owner.buffer;
+}
+
+void Logging::Write(const char* data, size_t size) {
+    if (!enabled_.load(memory_order_relaxed)) {
+        return;
+    }
+    log_buffer* buf = GetBuffer();
+    if (buf == nullptr) {
+        dropped_.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    if (size > LOG_BUFFER_SIZE / 4) {
+        size = LOG_BUFFER_SIZE / 4;
+    }
+    uint32_t len = size;
+    size_t need = sizeof(len) + size;
+    size_t tail = buf->tail.load(memory_order_relaxed);
+    while (LOG_BUFFER_SIZE - (tail - buf->head.load(memory_order_acquire)) < need) {
+        if (policy_.load(memory_order_relaxed) == OVERFLOW_DROP ||
+            !enabled_.load(memory_order_relaxed)) {
+            buf->dropped.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        this_thread::yield();
+    }
+
+    // length prefix and payload, either of which may wrap around
+    const uint8_t* parts[2] = { (const uint8_t*)&len, (const uint8_t*)data };
+    size_t sizes[2] = { sizeof(len), size };
+    size_t pos = tail;
+    for (int p = 0; p < 2; p++) {
+        size_t off = pos & (LOG_BUFFER_SIZE - 1);
+        size_t first = min(sizes[p], (size_t)LOG_BUFFER_SIZE - off);
+        memcpy(&buf->data[off], parts[p], first);
+        memcpy(&buf->data[0], parts[p] + first, sizes[p] - first);
+        pos += sizes[p];
+    }
+    buf->tail.store(pos, memory_order_release);
+}
+
+bool Logging::Drain(void) {
+    bool drained = false;
+    size_t count = num_buffers_.load(memory_order_acquire);
+
+    for (size_t i = 0; i < count; i++) {
+        log_buffer* buf = buffers_[i].get();
+        size_t head = buf->head.load(memory_order_relaxed);
+        size_t tail = buf->tail.load(memory_order_acquire);
+
+        while (head != tail) {
+            uint32_t len;
+            uint8_t* plen = (uint8_t*)&len;
+            for (size_t k = 0; k < sizeof(len); k++) {
+                plen[k] = buf->data[(head + k) & (LOG_BUFFER_SIZE - 1)];
+            }
+            head += sizeof(len);
+
+            if (batch_.size() + len + 1 > LOG_BATCH_SIZE) {
+                WriteBatch();
+            }
+            size_t off = head & (LOG_BUFFER_SIZE - 1);
+            size_t first = min((size_t)len, (size_t)LOG_BUFFER_SIZE - off);
+            batch_.insert(batch_.end(), &buf->data[off], &buf->data[off] + first);
+            batch_.insert(batch_.end(), &buf->data[0], &buf->data[0] + (len - first));
+            batch_.push_back('\n');
+            head += len;
+
+            buf->head.store(head, memory_order_release);
+            drained = true;
+        }
+    }
+    return drained;
+}
+
+void Logging::WriteBatch(void) {
+    size_t done = 0;
+    while (done < batch_.size()) {
+        ssize_t n = write(fd_, batch_.data() + done, batch_.size() - done);
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+    batch_.clear();
+}
+
+void Logging::WriterThread(void) {
+    unique_lock<mutex> lock(mutex_);
+    while (true) {
+        uint64_t request = flush_requests_;
+        lock.unlock();
+        bool drained = Drain();
+        if (!drained) {
+            WriteBatch();
+        }
+        lock.lock();
+
+        if (!drained) {
+            // every ring was empty after the request was seen
+            if (flushes_done_ < request) {
+                flushes_done_ = request;
+                flushed_cv_.notify_all();
+            }
+            if (stop_) {
+                break;
+            }
+            cv_.wait_for(lock, chrono::milliseconds(LOG_POLL_MS));
+        }
+    }
+    flushed_cv_.notify_all();
+}
@@ -1,48 +1,194 @@
 #ifndef _LOGGING_H
 #define _LOGGING_H
 
-#include <fstream>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
-#ifdef LOGGING_ENABLED
-    #define LOG_INIT(filename) Logging::Instance().Init(filename)
-    #define LOG_DEBUG(expr) Logging::Instance().Log(expr)
-#else
-    #define LOG_INIT(filename)
-    #define LOG_DEBUG(expr)
+#define LOG_LEVEL_NONE      0
+#define LOG_LEVEL_ERROR     1
+#define LOG_LEVEL_WARN      2
+#define LOG_LEVEL_INFO      3
+#define LOG_LEVEL_DEBUG     4
+#define LOG_LEVEL_TRACE     5
+
+#define LOG_CAT_CORE        0
+#define LOG_CAT_CPU         1
+#define LOG_CAT_MMU         2
+#define LOG_CAT_CARTRIDGE   3
+#define LOG_CAT_PPU         4
+#define LOG_CAT_APU         5
+#define LOG_CAT_COUNT       6
+
+// Compile-time ceiling per category, set by the build (NES_LOG_LEVEL*).
+// Messages above it are removed entirely.
+#ifndef LOG_MAX_LEVEL
+    #ifdef LOGGING_ENABLED
+        #define LOG_MAX_LEVEL LOG_LEVEL_TRACE
+    #else
+        #define LOG_MAX_LEVEL LOG_LEVEL_NONE
+    #endif
+#endif
+#ifndef LOG_MAX_LEVEL_CORE
+    #define LOG_MAX_LEVEL_CORE LOG_MAX_LEVEL
+#endif
+#ifndef LOG_MAX_LEVEL_CPU
+    #define LOG_MAX_LEVEL_CPU LOG_MAX_LEVEL
+#endif
+#ifndef LOG_MAX_LEVEL_MMU
+    #define LOG_MAX_LEVEL_MMU LOG_MAX_LEVEL
+#endif
+#ifndef LOG_MAX_LEVEL_CARTRIDGE
+    #define LOG_MAX_LEVEL_CARTRIDGE LOG_MAX_LEVEL
+#endif
+#ifndef LOG_MAX_LEVEL_PPU
+    #define LOG_MAX_LEVEL_PPU LOG_MAX_LEVEL
 #endif
+#ifndef LOG_MAX_LEVEL_APU
+    #define LOG_MAX_LEVEL_APU LOG_MAX_LEVEL
+#endif
+
+// LOG_ENABLED(CPU, TRACE): false at compile time above the ceiling,
+// otherwise one load and compare against the runtime level.
+#define LOG_COMPILED(cat, level) (LOG_LEVEL_##level <= LOG_MAX_LEVEL_##cat)
+#define LOG_ENABLED(cat, level) \
+    (LOG_COMPILED(cat, level) && Logging::IsEnabled(LOG_CAT_##cat, LOG_LEVEL_##level))
+
+// expr is only evaluated when the message is emitted
+#define LOG(cat, level, expr) \
+    do { \
+        if (LOG_ENABLED(cat, level)) { \
+            Logging::Instance().Log(expr); \
+        } \
+    } while (0)
 
+#define LOG_INIT(filename) Logging::Instance().Init(filename)
+#define LOG_FLUSH() Logging::Instance().Flush()
+#define LOG_DEBUG(expr) LOG(CORE, DEBUG, expr)
+
+#define LOG_BUFFER_SIZE     (1 << 20)   // per producer thread
+#define LOG_BATCH_SIZE      (1 << 20)   // bytes per write(2)
+#define LOG_POLL_MS         5
+#define LOG_MAX_THREADS     64      // alive at once
+
+// Asynchronous line logger. Each producer thread appends preformatted
+// records to its own lock-free ring; a background thread drains all rings
+// into large batched writes. A thread's ring is handed to the next new
+// thread once it exits. Producers never take a lock or make a
+// syscall. When a ring is full the record is either waited for
+// (OVERFLOW_BLOCK, the default, so traces stay complete) or dropped and
+// counted (OVERFLOW_DROP).
 class Logging {
 public:
+    enum overflow_policy {
+        OVERFLOW_BLOCK,
+        OVERFLOW_DROP
+    };
+
     static Logging& Instance(void) {
         static Logging instance_;
         return instance_;
     }
 
-    ~Logging() = default;
+    ~Logging();
 
-    void Init(const char* filename) {
-        if (stream_.is_open()) {
-            stream_.close();
-        }
-        stream_.open(filename);
-        filename_ = filename;
+    void Init(const char* filename);
+    void Close(void);
+    // Returns once everything logged before the call is written.
+    void Flush(void);
+
+    // Runtime level per category. Nothing passes while no log file is open.
+    static bool IsEnabled(int category, int level) {
+        return level <= levels_[category].load(std::memory_order_relaxed);
     }
+    void SetLevel(int category, int level);
+    int GetLevel(int category) const { return configured_levels_[category]; }
+
+    void SetOverflowPolicy(overflow_policy policy) { policy_ = policy; }
+    uint64_t GetDropped(void) const;
+
+    void Log(const std::string& str) { Write(str.data(), str.size()); }
+    void Log(const char* str) { Write(str, strlen(str)); }
 
     template<typename T>
     void Log(T const& v) {
-        stream_ << v << std::endl;
+        if (!enabled_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        thread_local std::ostringstream ss;
+        ss.str(std::string());
+        ss << v;
+        Log(ss.str());
     }
 
+    // One record, written out as a line.
+    void Write(const char* data, size_t size);
+
 private:
     // singleton
-    Logging() = default;
+    Logging();
     Logging(const Logging&) = delete;
     Logging(Logging&&) = delete;
     Logging& operator=(const Logging&) = delete;
     Logging& operator=(Logging&&) = delete;
 
-    std::ofstream stream_;
+    // padded rather than alignas(64): C++14 new ignores extended alignment
+    struct log_buffer {
+        std::atomic<size_t> head;   // writer thread
+        char pad0[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<size_t> tail;   // producer thread
+        char pad1[64 - sizeof(std::atomic<size_t>)];
+        std::atomic<uint64_t> dropped;
+        std::atomic<bool> owned;    // by a live producer thread
+        uint8_t data[LOG_BUFFER_SIZE];
+    };
+    // thread_local, releases the thread's ring when the thread exits
+    struct buffer_owner {
+        log_buffer* buffer = nullptr;
+        ~buffer_owner() {
+            if (buffer != nullptr) {
+                buffer->owned.store(false, std::memory_order_release);
+            }
+        }
+    };
+
+    log_buffer* GetBuffer(void);
+    bool Drain(void);
+    void WriteBatch(void);
+    void WriterThread(void);
+
+    // read by every producer thread, written by SetLevel, Init and Close
+    static std::atomic<uint8_t> levels_[LOG_CAT_COUNT];
+    uint8_t configured_levels_[LOG_CAT_COUNT];
+    void ApplyLevels(void);
+
+    std::atomic<bool> enabled_;
+    std::atomic<overflow_policy> policy_;
+    int fd_;
     std::string filename_;
+
+    // append-only, rings are reused rather than freed; the writer reads the
+    // first num_buffers_ without locking
+    std::mutex buffers_mutex_;
+    std::unique_ptr<log_buffer> buffers_[LOG_MAX_THREADS];
+    std::atomic<size_t> num_buffers_;
+    std::atomic<uint64_t> dropped_;
+
+    std::vector<char> batch_;
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable flushed_cv_;
+    bool stop_;
+    uint64_t flush_requests_;
+    uint64_t flushes_done_;
 };
 
 #endif
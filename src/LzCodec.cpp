@@ -0,0 +1,129 @@
+#include "LzCodec.h"
+#include <cstring>
+#include <vector>
+
+#define LZ_MIN_MATCH    4
+#define LZ_LAST_LITERALS 5      // matches stop this far from the end
+#define LZ_MAX_OFFSET   0xFFFF
+#define LZ_HASH_BITS    14
+
+static inline uint32_t Load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// lengths of 15 and up continue in bytes of 255 plus a final remainder
+static uint8_t* PutLength(uint8_t* out, size_t len) {
+    for (; len >= 255; len -= 255) {
+        *out++ = 255;
+    }
+    *out++ = len;
+    return out;
+}
+
+static uint8_t* PutSequence(uint8_t* out, const uint8_t* literals, size_t count,
+                            size_t offset, size_t match) {
+    size_t len = match - LZ_MIN_MATCH;
+    *out++ = ((count < 15 ? count : 15) << 4) | (match == 0 ? 0 : (len < 15 ? len : 15));
+    if (count >= 15) {
+        out = PutLength(out, count - 15);
+    }
+    memcpy(out, literals, count);
+    out += count;
+    if (match != 0) {
+        *out++ = offset & 0xFF;
+        *out++ = offset >> 8;
+        if (len >= 15) {
+            out = PutLength(out, len - 15);
+        }
+    }
+    return out;
+}
+
+size_t LzCodec::Compress(const uint8_t* in, size_t size, uint8_t* out) {
+    // positions + 1, 0 for none
+    std::vector<uint32_t> table(1 << LZ_HASH_BITS, 0);
+    uint8_t* start = out;
+    size_t anchor = 0;
+    size_t pos = 0;
+
+    while (pos + LZ_MIN_MATCH + LZ_LAST_LITERALS <= size) {
+        uint32_t v = Load32(in + pos);
+        uint32_t& slot = table[Hash(v)];
+        size_t ref = slot;
+        slot = pos + 1;
+        if (ref == 0 || pos - (ref - 1) > LZ_MAX_OFFSET || Load32(in + ref - 1) != v) {
+            pos++;
+            continue;
+        }
+        ref--;
+        size_t match = LZ_MIN_MATCH;
+        while (pos + match + LZ_LAST_LITERALS < size && in[ref + match] == in[pos + match]) {
+            match++;
+        }
+        out = PutSequence(out, in + anchor, pos - anchor, pos - ref, match);
+        pos += match;
+        anchor = pos;
+    }
+    // the last sequence is literals only
+    out = PutSequence(out, in + anchor, size - anchor, 0, 0);
+    return out - start;
+}
+
+static bool GetLength(const uint8_t** in, const uint8_t* end, size_t* len) {
+    uint8_t b;
+    do {
+        if (*in == end) {
+            return false;
+        }
+        b = *(*in)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+bool LzCodec::Decompress(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size) {
+    const uint8_t* end = in + in_size;
+    size_t pos = 0;
+
+    while (in < end) {
+        uint8_t token = *in++;
+        size_t count = token >> 4;
+        if (count == 15 && !GetLength(&in, end, &count)) {
+            return false;
+        }
+        if ((size_t)(end - in) < count || out_size - pos < count) {
+            return false;
+        }
+        memcpy(out + pos, in, count);
+        in += count;
+        pos += count;
+        if (in == end) {
+            break;
+        }
+
+        if (end - in < 2) {
+            return false;
+        }
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+        size_t match = token & 0x0F;
+        if (match == 15 && !GetLength(&in, end, &match)) {
+            return false;
+        }
+        match += LZ_MIN_MATCH;
+        if (offset == 0 || offset > pos || out_size - pos < match) {
+            return false;
+        }
+        // byte by byte: a match may overlap its own output
+        for (size_t i = 0; i < match; i++, pos++) {
+            out[pos] = out[pos - offset];
+        }
+    }
+    return pos == out_size;
+}
@@ -0,0 +1,25 @@
+#ifndef _LZ_CODEC_H
+#define _LZ_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Byte-oriented LZ77 in the style of LZ4 blocks: sequences of a token
+// (literal count, match length), the literals, and a 16-bit back offset.
+// Fast enough to compress trace output as it is produced.
+class LzCodec {
+public:
+    // Worst case compressed size of size bytes.
+    static size_t Bound(size_t size) { return size + size / 255 + 16; }
+
+    // Compresses into out, returns the compressed length.
+    static size_t Compress(const uint8_t* in, size_t size, uint8_t* out);
+
+    // Returns false unless in decodes to exactly out_size bytes.
+    static bool Decompress(const uint8_t* in, size_t in_size, uint8_t* out, size_t out_size);
+
+private:
+    LzCodec() = delete;
+};
+
+#endif
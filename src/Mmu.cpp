@@ -1,26 +1,65 @@
 #include "Mmu.h"
+#include "Debugger.h"
+#include "FlightRecorder.h"
 #include <cassert>
+#include <cstring>
 
-Mmu::Mmu(Nes* nes) :
-    nes_(nes)
+Mmu::Mmu(Nes* nes, Debugger* debugger) :
+    nes_(nes), debugger_(debugger), recorder_(nullptr), range_count_(0)
 {
+    memset(page_units_, 0, sizeof(page_units_));
+    memset(ranges_, 0, sizeof(ranges_));
+    memset(ram_, 0, sizeof(ram_));
+    MarkAllDirty();
+}
 
+void Mmu::PowerOn(void) {
+    // fixed power-on contents keep runs reproducible
+    memset(ram_, 0, sizeof(ram_));
+    MarkAllDirty();
 }
 
 void Mmu::AddMemoryMap(IMemoryUnit* unit, uint16_t addr_start, uint16_t addr_end) {
-    assert(addr_start < MEMORY_MAP_SIZE);
-    for (int i = addr_start; i < addr_end; i++) {
-        mem_units_[i] = unit;
+    assert(addr_start <= addr_end && range_count_ < MMU_RANGES);
+    ranges_[range_count_].unit = unit;
+    ranges_[range_count_].addr_start = addr_start;
+    ranges_[range_count_].addr_end = addr_end;
+    range_count_++;
+
+    // a page goes to the fast table only if no range starts or ends inside
+    // it, so one unit owns all of it
+    for (int page = 0; page < MMU_PAGES; page++) {
+        int first = page << 8;
+        int last = first | 0xFF;
+        IMemoryUnit* owner = FindUnit(first);
+        for (int i = 0; i < range_count_; i++) {
+            if ((first < ranges_[i].addr_start && ranges_[i].addr_start <= last) ||
+                (first <= ranges_[i].addr_end && ranges_[i].addr_end < last)) {
+                owner = nullptr;
+            }
+        }
+        page_units_[page] = owner;
+    }
+}
+
+IMemoryUnit* Mmu::FindUnit(uint16_t addr) const {
+    for (int i = range_count_ - 1; i >= 0; i--) {
+        if (ranges_[i].addr_start <= addr && addr <= ranges_[i].addr_end) {
+            return ranges_[i].unit;
+        }
     }
+    return nullptr;
 }
 
 uint8_t Mmu::Read8(uint16_t addr) {
     uint8_t data;
 
     if (addr < 0x2000) {
-        data = ram_[addr & 0x1FFF];
+        data = ram_[addr & (RAM_SIZE - 1)];
     } else {
-        data = mem_units_[addr]->Read8(addr);
+        IMemoryUnit* unit = GetUnit(addr);
+        // unmapped addresses read back as 0
+        data = (unit != nullptr) ? unit->Read8(addr) : 0;
     }
     // else if (addr < 0x4000) {
     //     // TODO: PPU
@@ -36,17 +75,43 @@ uint8_t Mmu::Read8(uint16_t addr) {
     //     _cartr
     // }
 
+    if (debugger_->IsWatched(addr, BP_READ)) {
+        debugger_->OnAccess(BP_READ, addr, data);
+    }
     return data;
 }
 
 void Mmu::Write8(uint16_t addr, uint8_t data) {
+    uint16_t page = addr >> 8;
     if (addr < 0x2000) {
-        ram_[addr & 0x1FFF] = data;
+        ram_[addr & (RAM_SIZE - 1)] = data;
+        page &= (RAM_SIZE >> 8) - 1;
     } else {
-        if (mem_units_[addr] != nullptr) {
-            mem_units_[addr]->Write8(addr, data);
+        IMemoryUnit* unit = GetUnit(addr);
+        if (unit != nullptr) {
+            unit->Write8(addr, data);
         }
     }
+    dirty_[page >> 6] |= 1ull << (page & 63);
+    if (recorder_ != nullptr) {
+        recorder_->RecordWrite(addr, data);
+    }
+    if (debugger_->IsWatched(addr, BP_WRITE)) {
+        debugger_->OnAccess(BP_WRITE, addr, data);
+    }
+}
+
+const uint8_t* Mmu::GetPage(uint16_t addr) {
+    addr &= 0xFF00;
+    if (addr < 0x2000) {
+        return &ram_[addr & (RAM_SIZE - 1)];
+    }
+    // only pages backed by a single unit can be handed out whole
+    IMemoryUnit* unit = page_units_[addr >> 8];
+    if (unit == nullptr) {
+        return nullptr;
+    }
+    return unit->GetPage(addr);
 }
 
 uint16_t Mmu::Read16(uint16_t addr) {
@@ -65,3 +130,21 @@ uint16_t Mmu::Read16_S(uint16_t addr) {
     uint16_t val_h = Read8(addr_h | ((addr_l + 1) & 0xFF)) ;
     return (val_h << 8) | val_l;
 }
+
+void Mmu::TakeDirtyPages(uint64_t* pages) {
+    memcpy(pages, dirty_, sizeof(dirty_));
+    memset(dirty_, 0, sizeof(dirty_));
+}
+
+void Mmu::MarkAllDirty(void) {
+    memset(dirty_, 0xFF, sizeof(dirty_));
+}
+
+void Mmu::SaveState(mmu_state* state) const {
+    memcpy(state->ram, ram_, sizeof(ram_));
+}
+
+void Mmu::LoadState(const mmu_state* state) {
+    memcpy(ram_, state->ram, sizeof(ram_));
+    MarkAllDirty();
+}
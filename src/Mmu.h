@@ -6,25 +6,73 @@
 
 #define MEMORY_MAP_SIZE 0x10000
 #define RAM_SIZE        0x800
+#define MMU_PAGES       (MEMORY_MAP_SIZE >> 8)
+#define MMU_DIRTY_WORDS (MMU_PAGES / 64)
+#define MMU_RANGES      8
 
 class Nes;
+class Debugger;
+class FlightRecorder;
+
+typedef struct {
+    uint8_t ram[RAM_SIZE];
+} mmu_state;
+
+typedef struct {
+    IMemoryUnit* unit;
+    uint16_t addr_start;
+    uint16_t addr_end;      // inclusive
+} mmu_range;
 
 class Mmu : public IMemoryUnit {
 public:
-    Mmu(Nes* nes);
+    Mmu(Nes* nes, Debugger* debugger);
     ~Mmu() = default;
 
+    void PowerOn(void);
+    // At most MMU_RANGES ranges; later ones take precedence where they
+    // overlap.
     void AddMemoryMap(IMemoryUnit* unit, uint16_t addr_start, uint16_t addr_end);
     virtual uint8_t Read8(uint16_t addr);
     virtual void Write8(uint16_t addr, uint8_t data);
+    virtual const uint8_t* GetPage(uint16_t addr);
     uint16_t Read16(uint16_t addr);
     void Write16(uint16_t addr, uint16_t data);
     uint16_t Read16_S(uint16_t addr);
 
+    // The internal RAM itself, valid as long as the Mmu.
+    const uint8_t* GetRam(void) const { return ram_; }
+
+    // Pages written since the last call, one bit per 256-byte page of the
+    // CPU address space (bit n of word w: page w * 64 + n). RAM writes mark
+    // the page of $0000-$07FF they land in, not the mirror. Clears the set.
+    void TakeDirtyPages(uint64_t* pages);
+    // For memory changed behind the bus, e.g. by LoadState.
+    void MarkAllDirty(void);
+    // Receives every write through the bus.
+    void SetFlightRecorder(FlightRecorder* recorder) { recorder_ = recorder; }
+
+    void SaveState(mmu_state* state) const;
+    void LoadState(const mmu_state* state);
+
 private:
     Nes* nes_;
-    IMemoryUnit* mem_units_[MEMORY_MAP_SIZE];
+    Debugger* debugger_;
+    FlightRecorder* recorder_;
+    // Unit of each 256-byte page when a single unit covers it. Pages shared
+    // by several units, such as $4000-$40FF, are nullptr and resolved
+    // through ranges_.
+    IMemoryUnit* page_units_[MMU_PAGES];
+    mmu_range ranges_[MMU_RANGES];
+    int range_count_;
     uint8_t ram_[RAM_SIZE];
+    uint64_t dirty_[MMU_DIRTY_WORDS];
+
+    IMemoryUnit* GetUnit(uint16_t addr) const {
+        IMemoryUnit* unit = page_units_[addr >> 8];
+        return (unit != nullptr) ? unit : FindUnit(addr);
+    }
+    IMemoryUnit* FindUnit(uint16_t addr) const;
 };
 
 #endif
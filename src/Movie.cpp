@@ -0,0 +1,180 @@
+#include "Movie.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static const uint8_t movie_magic[4] = { 0x4E, 0x4D, 0x56, 0x1A };
+static const uint8_t index_magic[4] = { 0x4E, 0x4D, 0x49, 0x1A };
+
+Movie::Movie(Nes* nes) :
+    nes_(nes), mode_(MOVIE_MODE_IDLE), keyframe_interval_(MOVIE_KEYFRAME_INTERVAL),
+    frame_(0), frame_count_(0), desynced_(false)
+{
+
+}
+
+Movie::~Movie() {
+    Close();
+}
+
+bool Movie::Record(const char* filename, uint32_t keyframe_interval) {
+    Close();
+
+    file_.open(filename, ios::out | ios::binary | ios::trunc);
+    if (!file_.is_open() || keyframe_interval == 0) {
+        return false;
+    }
+
+    movie_hdr header;
+    memcpy(header.magic, movie_magic, sizeof(header.magic));
+    header.version = MOVIE_VERSION;
+    header.keyframe_interval = keyframe_interval;
+    header.state_size = sizeof(nes_state);
+    file_.write((const char*)&header, sizeof(header));
+
+    mode_ = MOVIE_MODE_RECORD;
+    keyframe_interval_ = keyframe_interval;
+    frame_ = 0;
+    frame_count_ = 0;
+    desynced_ = false;
+    index_.clear();
+    return true;
+}
+
+bool Movie::Play(const char* filename) {
+    Close();
+
+    file_.open(filename, ios::in | ios::binary);
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    movie_hdr header;
+    movie_footer footer;
+    file_.read((char*)&header, sizeof(header));
+    file_.seekg(-(streamoff)sizeof(footer), ios::end);
+    file_.read((char*)&footer, sizeof(footer));
+    if (!file_ ||
+        memcmp(header.magic, movie_magic, sizeof(header.magic)) != 0 ||
+        memcmp(footer.magic, index_magic, sizeof(footer.magic)) != 0 ||
+        header.version != MOVIE_VERSION ||
+        header.state_size != sizeof(nes_state) ||
+        header.keyframe_interval == 0 ||
+        footer.keyframe_count == 0) {
+        file_.close();
+        return false;
+    }
+
+    index_.resize(footer.keyframe_count);
+    file_.seekg(footer.index_offset);
+    file_.read((char*)index_.data(), index_.size() * sizeof(movie_keyframe));
+    if (!file_) {
+        file_.close();
+        return false;
+    }
+
+    mode_ = MOVIE_MODE_PLAYBACK;
+    keyframe_interval_ = header.keyframe_interval;
+    frame_count_ = footer.frame_count;
+    desynced_ = false;
+    return Seek(0);
+}
+
+void Movie::Close(void) {
+    if (mode_ == MOVIE_MODE_RECORD) {
+        movie_footer footer;
+        footer.index_offset = file_.tellp();
+        footer.frame_count = frame_count_;
+        footer.keyframe_count = index_.size();
+        memcpy(footer.magic, index_magic, sizeof(footer.magic));
+        file_.write((const char*)index_.data(), index_.size() * sizeof(movie_keyframe));
+        file_.write((const char*)&footer, sizeof(footer));
+    }
+    if (file_.is_open()) {
+        file_.close();
+    }
+    mode_ = MOVIE_MODE_IDLE;
+}
+
+void Movie::RecordFrame(const uint8_t* input) {
+    if (mode_ != MOVIE_MODE_RECORD) {
+        return;
+    }
+
+    if (frame_ % keyframe_interval_ == 0) {
+        movie_keyframe keyframe;
+        keyframe.frame = frame_;
+        keyframe.offset = file_.tellp();
+        index_.push_back(keyframe);
+
+        nes_->SaveState(&state_);
+        file_.write((const char*)&state_, sizeof(state_));
+    }
+
+    file_.write((const char*)input, NUM_PORTS);
+    for (int port = 0; port < NUM_PORTS; port++) {
+        nes_->SetInput(port, input[port]);
+    }
+    frame_count_ = ++frame_;
+}
+
+bool Movie::PlayFrame(void) {
+    if (mode_ != MOVIE_MODE_PLAYBACK || frame_ >= frame_count_) {
+        return false;
+    }
+
+    if (frame_ % keyframe_interval_ == 0) {
+        // verify the replay is still bit-exact against the recording
+        file_.read((char*)&recorded_state_, sizeof(recorded_state_));
+        nes_->SaveState(&state_);
+        if (memcmp(&state_, &recorded_state_, sizeof(state_)) != 0) {
+            desynced_ = true;
+        }
+    }
+
+    uint8_t input[NUM_PORTS];
+    file_.read((char*)input, sizeof(input));
+    if (!file_) {
+        return false;
+    }
+    for (int port = 0; port < NUM_PORTS; port++) {
+        nes_->SetInput(port, input[port]);
+    }
+    ++frame_;
+    return true;
+}
+
+bool Movie::Seek(uint64_t frame) {
+    if (mode_ != MOVIE_MODE_PLAYBACK || frame > frame_count_) {
+        return false;
+    }
+
+    // index is sorted by frame: find the last keyframe at or before frame
+    auto it = upper_bound(index_.begin(), index_.end(), frame,
+        [](uint64_t f, const movie_keyframe& k) { return f < k.frame; });
+    if (it == index_.begin()) {
+        return false;
+    }
+    --it;
+
+    file_.clear();
+    file_.seekg(it->offset);
+    file_.read((char*)&state_, sizeof(state_));
+    if (!file_) {
+        return false;
+    }
+    nes_->LoadState(&state_);
+
+    // rewind onto the keyframe so PlayFrame consumes it like normal playback
+    file_.seekg(it->offset);
+    frame_ = it->frame;
+    while (frame_ < frame) {
+        if (!PlayFrame()) {
+            return false;
+        }
+        // the movie sets the input, and skipped frames aren't shown
+        nes_->RunFrame(false, false, false);
+    }
+    return true;
+}
@@ -0,0 +1,80 @@
+#ifndef _MOVIE_H
+#define _MOVIE_H
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#include "Nes.h"
+
+#define MOVIE_VERSION               1
+#define MOVIE_KEYFRAME_INTERVAL     600     // ~10 seconds at 60 fps
+
+// File layout:
+//   movie_hdr
+//   block 0: nes_state keyframe, NUM_PORTS input bytes per frame
+//   block 1: ...                 (one block every keyframe_interval frames)
+//   movie_keyframe index[keyframe_count]
+//   movie_footer
+// Inputs of a block follow its keyframe, so playback and seeking only ever
+// read forward from one keyframe and memory use does not grow with length.
+
+typedef struct {
+    uint8_t magic[4];           // 0x4E 0x4D 0x56 0x1A ("NMV" followed by DOS EOF)
+    uint32_t version;
+    uint32_t keyframe_interval; // frames per block
+    uint32_t state_size;        // sizeof(nes_state) of the recording build
+} movie_hdr;
+
+typedef struct {
+    uint64_t frame;             // movie frame the keyframe was taken at
+    uint64_t offset;            // file offset of the keyframe
+} movie_keyframe;
+
+typedef struct {
+    uint64_t index_offset;
+    uint64_t frame_count;
+    uint32_t keyframe_count;
+    uint8_t magic[4];           // 0x4E 0x4D 0x49 0x1A ("NMI" followed by DOS EOF)
+} movie_footer;
+
+class Movie {
+public:
+    enum movie_mode {
+        MOVIE_MODE_IDLE,
+        MOVIE_MODE_RECORD,
+        MOVIE_MODE_PLAYBACK
+    };
+
+    Movie(Nes* nes);
+    ~Movie();
+
+    bool Record(const char* filename, uint32_t keyframe_interval=MOVIE_KEYFRAME_INTERVAL);
+    bool Play(const char* filename);
+    void Close(void);
+
+    // Called once per frame, before Nes::RunFrame.
+    void RecordFrame(const uint8_t* input);
+    bool PlayFrame(void);
+
+    // Restores the nearest keyframe at or before frame and emulates the rest.
+    bool Seek(uint64_t frame);
+
+    movie_mode GetMode(void) const { return mode_; }
+    uint64_t GetFrame(void) const { return frame_; }
+    uint64_t GetFrameCount(void) const { return frame_count_; }
+    bool IsDesynced(void) const { return desynced_; }
+
+private:
+    Nes* nes_;
+    movie_mode mode_;
+    std::fstream file_;
+    uint32_t keyframe_interval_;
+    uint64_t frame_;
+    uint64_t frame_count_;
+    bool desynced_;
+    std::vector<movie_keyframe> index_;
+    nes_state state_;
+    nes_state recorded_state_;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef _MPSC_QUEUE_H
+#define _MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded multi-producer/single-consumer queue. Every slot carries a
+// sequence number telling whose turn it is: producers claim a slot with a
+// CAS on tail_ and publish it by bumping its sequence, so they only retry
+// when another producer won the same slot. Pop is a few loads and two
+// release stores and never waits, even while a claimed slot is still being
+// filled. N must be a power of two.
+template<typename T, size_t N>
+class MpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscQueue size must be a power of two");
+
+public:
+    MpscQueue() : head_(0), tail_(0) {
+        for (size_t i = 0; i < N; i++) {
+            buf_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+    ~MpscQueue() = default;
+
+    // producer side, any thread
+    bool Push(const T& val) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        slot* s;
+        for (;;) {
+            s = &buf_[tail & (N - 1)];
+            intptr_t diff = (intptr_t)s->seq.load(std::memory_order_acquire) - (intptr_t)tail;
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;   // full: the consumer hasn't freed the slot
+            } else {
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        s->val = val;
+        s->seq.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side, one thread
+    bool Pop(T* val) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        slot& s = buf_[head & (N - 1)];
+        if (s.seq.load(std::memory_order_acquire) != head + 1) {
+            return false;
+        }
+        *val = s.val;
+        s.seq.store(head + N, std::memory_order_release);
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Includes slots claimed but not yet published.
+    size_t Size(void) const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    bool Empty(void) const { return Size() == 0; }
+
+private:
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    typedef struct {
+        std::atomic<size_t> seq;
+        T val;
+    } slot;
+
+    // consumer and producer indices on separate cache lines
+    alignas(64) std::atomic<size_t> head_;
+    alignas(64) std::atomic<size_t> tail_;
+    alignas(64) slot buf_[N];
+};
+
+#endif
@@ -1,47 +1,235 @@
 #include "Nes.h"
 #include "Cpu.h"
+#include "CycleCpu.h"
 #include "Mmu.h"
 #include "Cartridge.h"
+#include "Controller.h"
+#include "Ppu.h"
+#include "OamDma.h"
+#include "FlightRecorder.h"
+#include "StateHash.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
 
 using namespace std;
 
-Nes::Nes() {
-    mmu_ = make_unique<Mmu>(this);
-    cpu_ = make_unique<Cpu>(this, mmu_.get());
-    cartridge_ = make_unique<Cartridge>(this, mmu_.get());
+Nes::Nes() :
+    debugger_(this), mmu_(this, &debugger_), cpu_(this, &mmu_, &debugger_),
+    cycle_cpu_(&cpu_, &mmu_, &debugger_), cartridge_(this, &mmu_), controller_(this), ppu_(this),
+    oam_dma_(this, &mmu_, &cpu_, &ppu_, &debugger_), frame_sink_(nullptr), rom_db_(nullptr), recorder_(nullptr),
+    cpu_core_(CPU_CORE_FAST), active_core_(CPU_CORE_FAST), frame_(0), frame_started_(false)
+{
+    debugger_.SetCpu(&cpu_);
+    cpu_.SetCodeDataLogger(cartridge_.GetCodeDataLogger());
 
-    mmu_->AddMemoryMap(mmu_.get(), 0x0000, 0x1FFF);
-    // TODO: PPU
-    // TODO: APU/IO
-    mmu_->AddMemoryMap(cartridge_.get(), 0x4020, 0xFFFF);
+    mmu_.AddMemoryMap(&mmu_, 0x0000, 0x1FFF);
+    mmu_.AddMemoryMap(&ppu_, 0x2000, 0x3FFF);
+    // TODO: APU
+    mmu_.AddMemoryMap(&oam_dma_, 0x4014, 0x4014);
+    mmu_.AddMemoryMap(&controller_, 0x4016, 0x4017);
+    mmu_.AddMemoryMap(&cartridge_, 0x4020, 0xFFFF);
 }
 
-Nes::~Nes() {
-    cpu_ = nullptr;
-    mmu_ = nullptr;
-    cartridge_ = nullptr;
+Nes::~Nes() = default;
+
+void* Nes::operator new(size_t size) {
+    // aligned_alloc wants a multiple of the alignment
+    void* ptr = aligned_alloc(NES_ALIGNMENT, (size + NES_ALIGNMENT - 1) & ~(size_t)(NES_ALIGNMENT - 1));
+    if (ptr == nullptr) {
+        throw bad_alloc();
+    }
+    return ptr;
+}
+
+void Nes::operator delete(void* ptr) {
+    free(ptr);
 }
 
 void Nes::PowerOn(void) {
-    cpu_->PowerOn();
+    mmu_.PowerOn();
+    ppu_.PowerOn();
+    cpu_.PowerOn();
 }
 
 void Nes::Run(const char* rom, emu_mode mode) {
-    cartridge_->LoadRom(rom);
-    cpu_->Reset();
+    LoadRom(rom);
+    Reset(mode);
+    for(int i = 0; i < 10000; i++) {
+        StepCpu();
+    }
+}
+
+void Nes::StepCpu(void) {
+    if (active_core_ == CPU_CORE_CYCLE) {
+        cycle_cpu_.Step();
+    } else {
+        cpu_.Step();
+    }
+}
+
+bool Nes::LoadRom(const char* rom, save_ram_mode save) {
+    bool loaded = cartridge_.LoadRom(rom, rom_db_, save);
+    // PRG RAM may now be a different buffer
+    mmu_.MarkAllDirty();
+    UpdateCpuCore();
+    return loaded;
+}
+
+void Nes::SetCpuCore(cpu_core core) {
+    cpu_core_ = core;
+    UpdateCpuCore();
+}
+
+void Nes::UpdateCpuCore(void) {
+    active_core_ = cartridge_.GetRomInfo().cycle_cpu ? CPU_CORE_CYCLE : cpu_core_;
+    cycle_cpu_.Reset();
+}
+
+void Nes::Reset(emu_mode mode) {
+    cpu_.Reset();
+    cycle_cpu_.Reset();
     if (mode == EMU_MODE_AUTOMATED) {
-        cpu_->SetPC(0xC000);
+        cpu_.SetPC(0xC000);
     }
-    for(int i = 0; i < 10000; i++) {
-        cpu_->Step();
+    frame_ = 0;
+    frame_started_ = false;
+}
+
+void Nes::RunFrame(bool present, bool latch_input, bool record) {
+    uint64_t frame_end = ((frame_ + 1) * CPU_CYCLES_PER_FRAME_X2) / 2;
+    // frames run without record leave these as they found them
+    CodeDataLogger* cdl = cartridge_.GetCodeDataLogger();
+    bool trace = cpu_.IsTraceEnabled();
+    bool logging = cdl->IsEnabled();
+    bool breakpoints = debugger_.IsEnabled();
+
+    // a frame resumed after a breakpoint has already latched its input
+    if (latch_input && !frame_started_) {
+        controller_.Latch();
+    }
+    frame_started_ = true;
+    if (!record) {
+        cpu_.SetTraceEnabled(false);
+        cpu_.SetFlightRecorder(nullptr);
+        mmu_.SetFlightRecorder(nullptr);
+        cdl->SetEnabled(false);
+        debugger_.SetEnabled(false);
+    }
+    if (active_core_ == CPU_CORE_CYCLE) {
+        // frames still end between instructions, so nes_state needs no
+        // CycleCpu state
+        while ((cpu_.GetCycles() < frame_end || !cycle_cpu_.IsIdle()) &&
+               !debugger_.IsPaused()) {
+            cycle_cpu_.Tick();
+        }
+    } else {
+        while (cpu_.GetCycles() < frame_end && !debugger_.IsPaused()) {
+            cpu_.Step();
+        }
+    }
+    if (!record) {
+        cpu_.SetTraceEnabled(trace);
+        cpu_.SetFlightRecorder(recorder_);
+        mmu_.SetFlightRecorder(recorder_);
+        cdl->SetEnabled(logging);
+        debugger_.SetEnabled(breakpoints);
+    }
+    if (debugger_.IsPaused()) {
+        return;
+    }
+    frame_started_ = false;
+    ppu_.StartVBlank();
+    ++frame_;
+
+    if (present && frame_sink_ != nullptr) {
+        frame_sink_->OnFrame(this);
+    }
+}
+
+void Nes::RunCycles(uint64_t cycles) {
+    while (cpu_.GetCycles() < cycles && !debugger_.IsPaused()) {
+        uint64_t frame_end = ((frame_ + 1) * CPU_CYCLES_PER_FRAME_X2) / 2;
+        if (frame_end <= cycles) {
+            RunFrame();
+        } else {
+            StepCpu();
+        }
+    }
+}
+
+void Nes::SetInput(int port, uint8_t buttons) {
+    controller_.SetButtons(port, buttons);
+}
+
+uint8_t Nes::GetInput(int port) const {
+    return controller_.GetButtons(port);
+}
+
+bool Nes::SubmitInput(const input_frame& input) {
+    return controller_.Submit(input);
+}
+
+void Nes::RunFrames(const input_frame* input, size_t frames, bool output) {
+    for (size_t i = 0; i < frames; i++) {
+        for (int port = 0; port < NUM_PORTS; port++) {
+            controller_.SetButtons(port, input[i].buttons[port]);
+        }
+        RunFrame(output, false);
+    }
+}
+
+void Nes::SaveState(nes_state* state) const {
+    // clear struct padding so identical machines give identical blobs
+    memset(state, 0, sizeof(*state));
+    state->frame = frame_;
+    cpu_.SaveState(&state->cpu);
+    mmu_.SaveState(&state->mmu);
+    cartridge_.SaveState(&state->cartridge);
+    controller_.SaveState(&state->controller);
+    ppu_.SaveState(&state->ppu);
+}
+
+void Nes::LoadState(const nes_state* state) {
+    if (recorder_ != nullptr) {
+        recorder_->OnStateLoad(state->cpu.cycles);
+    }
+    frame_ = state->frame;
+    frame_started_ = false;
+    cpu_.LoadState(&state->cpu);
+    cycle_cpu_.Reset();
+    mmu_.LoadState(&state->mmu);
+    cartridge_.LoadState(&state->cartridge);
+    controller_.LoadState(&state->controller);
+    ppu_.LoadState(&state->ppu);
+}
+
+uint64_t Nes::GetStateHash(void) {
+    uint64_t dirty[MMU_DIRTY_WORDS];
+    mmu_.TakeDirtyPages(dirty);
+
+    // everything but the memory arrays, which are hashed in place
+    nes_state state;
+    state.frame = frame_;
+    cpu_.SaveState(&state.cpu);
+    memcpy(state.cartridge.mapper_regs, cartridge_.GetMapperRegs(),
+           sizeof(state.cartridge.mapper_regs));
+    controller_.SaveState(&state.controller);
+    ppu_.SaveState(&state.ppu);
+
+    if (state_hash_ == nullptr) {
+        state_hash_.reset(new StateHash);
     }
+    // RAM is pages $00-$07, PRG RAM pages $60-$7F
+    return state_hash_->Update(state, mmu_.GetRam(), (uint32_t)dirty[0] & 0xFF,
+                               cartridge_.GetPrgRam(), (uint32_t)(dirty[1] >> 32));
 }
 
 // void Nes::RunTestRom(const char* rom) {
-//     cartridge_->LoadRom(rom);
-//     cpu_->Reset();
-//     cpu_->SetPC(0xC000);
+//     cartridge_.LoadRom(rom, rom_db_);
+//     cpu_.Reset();
+//     cpu_.SetPC(0xC000);
 //     for(int i = 0; i < 50; i++) {
-//         cpu_->Step();
+//         cpu_.Step();
 //     }
 // }
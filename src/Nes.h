@@ -1,29 +1,148 @@
 #ifndef _NES_H
 #define _NES_H
 
+#include <cstddef>
 #include <memory>
+#include "Cpu.h"
+#include "CycleCpu.h"
+#include "Mmu.h"
+#include "Cartridge.h"
+#include "Controller.h"
+#include "Ppu.h"
+#include "OamDma.h"
+#include "IFrameSink.h"
+#include "Debugger.h"
 
-class Cpu;
-class Mmu;
-class Cartridge;
+// NTSC: 341 * 262 - 0.5 PPU dots per frame, 3 dots per CPU cycle
+#define CPU_CYCLES_PER_FRAME_X2 59561
+#define NES_ALIGNMENT           64      // cache line
 
+// Full machine state, fixed-size so it can be copied and stored as a blob.
+typedef struct {
+    uint64_t frame;
+    cpu_state cpu;
+    mmu_state mmu;
+    cartridge_state cartridge;
+    controller_state controller;
+    ppu_state ppu;
+} nes_state;
+
+class RomDatabase;
+class StateHash;
+
+// The components are members rather than separate allocations, so a Nes
+// is one block (see bench_footprint) starting on a cache line; ROM images
+// and decode tables are shared between instances.
 class Nes {
 public:
     enum emu_mode {
         EMU_MODE_NORMAL,
         EMU_MODE_AUTOMATED
     };
+    enum cpu_core {
+        CPU_CORE_FAST,      // Cpu::Step, an instruction at a time
+        CPU_CORE_CYCLE      // CycleCpu, a bus cycle at a time
+    };
     Nes();
     ~Nes();
 
+    // C++14 new ignores the alignment of over-aligned types.
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
     void PowerOn(void);
     void Run(const char* rom, emu_mode mode=EMU_MODE_NORMAL);
     // void RunTestRom(const char* rom);
 
+    // Instances that are only simulated, e.g. search workers, should load
+    // with SAVE_RAM_COPY so battery RAM never reaches the .sav file.
+    bool LoadRom(const char* rom, save_ram_mode save=SAVE_RAM_WRITE_BACK);
+    // Known dumps get their header corrected from db on the next LoadRom.
+    void SetRomDatabase(RomDatabase* db) { rom_db_ = db; }
+    // CPU core for this run. ROMs flagged in the database always get the
+    // per-cycle core; GetCpuCore returns the core in use.
+    void SetCpuCore(cpu_core core);
+    cpu_core GetCpuCore(void) const { return active_core_; }
+    void Reset(emu_mode mode=EMU_MODE_NORMAL);
+    // present: call the frame sink. latch_input: take the next queued host
+    // input; speculative frames skip it so they don't consume input of later
+    // frames. record: the trace, flight recorder, CDL and breakpoints see the
+    // frame. Frames that are rolled back with LoadState (run-ahead, input
+    // search, movie seek) run without, so their cycles never reach a sink.
+    void RunFrame(bool present=true, bool latch_input=true, bool record=true);
+    // Whole frames while they end within the budget, then single
+    // instructions up to the CPU cycle count cycles.
+    void RunCycles(uint64_t cycles);
+    uint64_t GetFrame(void) const { return frame_; }
+    uint64_t GetCycles(void) const { return cpu_.GetCycles(); }
+    uint64_t GetInstructions(void) const { return cpu_.GetInstructions(); }
+    // Start somewhere other than the reset vector, e.g. $C000 for
+    // nestest's automated mode.
+    void SetPC(uint16_t addr) { cpu_.SetPC(addr); }
+
+    // Emulation thread: sets pad state directly, e.g. from a movie.
+    void SetInput(int port, uint8_t buttons);
+    uint8_t GetInput(int port) const;
+    // Host threads, any number of them: queued and latched at the start of a
+    // later frame, in submission order. Returns false when the queue is full.
+    bool SubmitInput(const input_frame& input);
+    // Headless runs: one frame per entry of input.
+    void RunFrames(const input_frame* input, size_t frames, bool output=true);
+
+    void SetFrameSink(IFrameSink* sink) { frame_sink_ = sink; }
+    // Live views for observers, valid as long as the Nes: RAM_SIZE bytes of
+    // internal RAM and the Ppu frame buffer.
+    const uint8_t* GetRam(void) const { return mmu_.GetRam(); }
+    const uint8_t* GetFrameBuffer(void) const { return ppu_.GetFrameBuffer(); }
+    uint8_t GetEmphasis(void) const { return ppu_.GetEmphasis(); }
+
+    // A breakpoint hit stops RunFrame early; the next RunFrame after
+    // Debugger::Resume finishes the frame.
+    Debugger* GetDebugger(void) { return &debugger_; }
+    bool IsPaused(void) const { return debugger_.IsPaused(); }
+
+    // PRG coverage of the loaded ROM, recorded in NES_CDL builds.
+    CodeDataLogger* GetCodeDataLogger(void) { return cartridge_.GetCodeDataLogger(); }
+    // Receives the CPU trace of recorded frames, e.g. a TraceWriter.
+    void SetTraceSink(ITraceSink* sink) { cpu_.SetTraceSink(sink); }
+    // Keeps the last instructions and bus writes (FlightRecorder), or
+    // nullptr to stop. LoadState marks where the cycle count went back.
+    void SetFlightRecorder(FlightRecorder* recorder) {
+        recorder_ = recorder;
+        cpu_.SetFlightRecorder(recorder);
+        mmu_.SetFlightRecorder(recorder);
+    }
+
+    void SaveState(nes_state* state) const;
+    void LoadState(const nes_state* state);
+    // StateHash::Hash of the current state. Only memory pages written since
+    // the previous call are rehashed.
+    uint64_t GetStateHash(void);
+
 private:
-    std::unique_ptr<Mmu> mmu_;
-    std::unique_ptr<Cpu> cpu_;
-    std::unique_ptr<Cartridge> cartridge_;
+    // in construction order: each takes pointers to the ones before it
+    Debugger debugger_;
+    Mmu mmu_;
+    Cpu cpu_;
+    CycleCpu cycle_cpu_;
+    Cartridge cartridge_;
+    Controller controller_;
+    Ppu ppu_;
+    OamDma oam_dma_;
+    // page hash cache, allocated by the first GetStateHash
+    std::unique_ptr<StateHash> state_hash_;
+
+    IFrameSink* frame_sink_;
+    RomDatabase* rom_db_;
+    FlightRecorder* recorder_;
+    cpu_core cpu_core_;
+    cpu_core active_core_;
+
+    uint64_t frame_;
+    bool frame_started_;
+
+    void UpdateCpuCore(void);
+    void StepCpu(void);
 };
 
 
@@ -0,0 +1,195 @@
+#include "NtscFilter.h"
+#include "Palette.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NTSC_SIMD
+#endif
+
+using namespace std;
+
+#define NTSC_SAMPLES        8       // signal samples per PPU pixel
+#define NTSC_PERIOD         12      // samples per colour subcarrier cycle
+#define NTSC_PHASES         3       // pixels start every 8 samples, mod 12
+#define NTSC_KERNEL         10      // outputs one pixel reaches
+#define NTSC_KERNEL_START   4       // ... starting this far left of 2x
+#define NTSC_LUMA_WIDTH     12      // box filter widths in samples
+#define NTSC_CHROMA_WIDTH   24
+#define NTSC_HUE            3.9     // demodulation phase offset in samples
+#define NTSC_ATTENUATION    0.746   // colour emphasis
+
+#define NTSC_KERNEL_FLOATS  (NTSC_KERNEL * 4)
+#define NTSC_ROW_FLOATS     ((NTSC_WIDTH + NTSC_KERNEL) * 4)
+
+// Signal levels in volts, from measurements of the 2C02.
+static const double level_low[4] = { 0.350, 0.518, 0.962, 1.550 };
+static const double level_high[4] = { 1.094, 1.506, 1.962, 1.962 };
+static const double level_black = 0.518;
+static const double level_white = 1.962;
+
+static bool InColorPhase(int color, int phase) {
+    return (color + phase) % NTSC_PERIOD < 6;
+}
+
+// Normalized signal of entry at subcarrier phase 0..11.
+static double Signal(int entry, int phase) {
+    int color = entry & 0x0F;
+    int level = (entry >> 4) & 3;
+    int emphasis = entry >> 6;
+    if (color > 0x0D) {
+        level = 1;
+    }
+
+    double low = level_low[level];
+    double high = level_high[level];
+    if (color == 0x00) {
+        low = high;
+    } else if (color >= 0x0D) {
+        high = low;
+    }
+    double signal = InColorPhase(color, phase) ? high : low;
+
+    if (color < 0x0E && (((emphasis & 1) && InColorPhase(0x0C, phase)) ||
+                         ((emphasis & 2) && InColorPhase(0x04, phase)) ||
+                         ((emphasis & 4) && InColorPhase(0x08, phase)))) {
+        signal *= NTSC_ATTENUATION;
+    }
+    return (signal - level_black) / (level_white - level_black);
+}
+
+NtscFilter::NtscFilter() :
+    kernels_((size_t)NTSC_ENTRIES * NTSC_PHASES * NTSC_KERNEL_FLOATS), simd_(HasSimd())
+{
+    for (int entry = 0; entry < NTSC_ENTRIES; entry++) {
+        for (int p = 0; p < NTSC_PHASES; p++) {
+            float* k = &kernels_[((size_t)entry * NTSC_PHASES + p) * NTSC_KERNEL_FLOATS];
+            int start = p * (NTSC_PERIOD / NTSC_PHASES);
+            for (int j = 0; j < NTSC_KERNEL; j++) {
+                // output centre, in samples from the pixel's first sample
+                int centre = 4 * (j - NTSC_KERNEL_START) + 2;
+                double y = 0, i = 0, q = 0;
+                for (int t = 0; t < NTSC_SAMPLES; t++) {
+                    int d = t - centre;
+                    int phase = (start + t) % NTSC_PERIOD;
+                    double s = Signal(entry, phase);
+                    if (d >= -NTSC_LUMA_WIDTH / 2 && d < NTSC_LUMA_WIDTH / 2) {
+                        y += s / NTSC_LUMA_WIDTH;
+                    }
+                    if (d >= -NTSC_CHROMA_WIDTH / 2 && d < NTSC_CHROMA_WIDTH / 2) {
+                        double angle = M_PI * (phase + NTSC_HUE) / 6;
+                        i += 2 * s * cos(angle) / NTSC_CHROMA_WIDTH;
+                        q += 2 * s * sin(angle) / NTSC_CHROMA_WIDTH;
+                    }
+                }
+                k[j * 4 + 0] = 255 * (y - 1.108545 * i + 1.709007 * q);
+                k[j * 4 + 1] = 255 * (y - 0.274788 * i - 0.635691 * q);
+                k[j * 4 + 2] = 255 * (y + 0.946882 * i + 0.623557 * q);
+                k[j * 4 + 3] = 0;
+            }
+        }
+    }
+}
+
+void NtscFilter::SetSimdEnabled(bool enable) {
+    simd_ = enable && HasSimd();
+}
+
+#ifdef NTSC_SIMD
+__attribute__((target("avx2")))
+static void AddKernelAvx2(float* acc, const float* k) {
+    for (int i = 0; i < NTSC_KERNEL_FLOATS; i += 8) {
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(_mm256_loadu_ps(acc + i), _mm256_loadu_ps(k + i)));
+    }
+}
+
+// four B, G, R, 0 float pixels to packed 0x00RRGGBB with saturation
+__attribute__((target("avx2")))
+static void PackRowAvx2(const float* acc, uint32_t* out) {
+    for (int x = 0; x < NTSC_WIDTH; x += 4) {
+        __m256i a = _mm256_cvtps_epi32(_mm256_loadu_ps(acc + x * 4));
+        __m256i b = _mm256_cvtps_epi32(_mm256_loadu_ps(acc + x * 4 + 8));
+        // lanes end up as [p0 p2 p0 p2 | p1 p3 p1 p3]
+        __m256i bytes = _mm256_packus_epi16(_mm256_packus_epi32(a, b), _mm256_setzero_si256());
+        __m128i px = _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes),
+                                        _mm256_extracti128_si256(bytes, 1));
+        _mm_storeu_si128((__m128i*)(out + x), px);
+    }
+}
+
+bool NtscFilter::HasSimd(void) {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+#else
+bool NtscFilter::HasSimd(void) {
+    return false;
+}
+#endif
+
+static void AddKernel(float* acc, const float* k) {
+    for (int i = 0; i < NTSC_KERNEL_FLOATS; i++) {
+        acc[i] += k[i];
+    }
+}
+
+static uint8_t Clamp(float v) {
+    int c = (int)lrintf(v);
+    return (c < 0) ? 0 : (c > 255) ? 255 : c;
+}
+
+static void PackRow(const float* acc, uint32_t* out) {
+    for (int x = 0; x < NTSC_WIDTH; x++) {
+        const float* p = acc + x * 4;
+        out[x] = (Clamp(p[2]) << 16) | (Clamp(p[1]) << 8) | Clamp(p[0]);
+    }
+}
+
+template<typename T>
+void NtscFilter::FilterFrame(const T* pixels, uint16_t mask, uint16_t emphasis, uint64_t frame,
+                             uint32_t* out) const {
+    // sums for output x are at acc + (x + NTSC_KERNEL_START) * 4
+    float acc[NTSC_ROW_FLOATS];
+
+    for (int y = 0; y < NTSC_HEIGHT; y++) {
+        const T* row = pixels + y * PPU_WIDTH;
+        // 341 dots of 8 samples move each line 4 samples along the
+        // subcarrier, and odd frames start 8 samples later: dot crawl
+        int phase = (4 * y + 8 * (frame & 1)) % NTSC_PERIOD / 4;
+
+        memset(acc, 0, sizeof(acc));
+        for (int x = 0; x < PPU_WIDTH; x++) {
+            int entry = (row[x] & mask) | emphasis;
+            const float* k = &kernels_[((size_t)entry * NTSC_PHASES + phase) * NTSC_KERNEL_FLOATS];
+#ifdef NTSC_SIMD
+            if (simd_) {
+                AddKernelAvx2(acc + x * 8, k);
+            } else
+#endif
+            {
+                AddKernel(acc + x * 8, k);
+            }
+            // the next pixel starts 8 samples on
+            phase = (phase == NTSC_PHASES - 1) ? 1 : (phase == 0) ? 2 : 0;
+        }
+
+#ifdef NTSC_SIMD
+        if (simd_) {
+            PackRowAvx2(acc + NTSC_KERNEL_START * 4, out + y * NTSC_WIDTH);
+            continue;
+        }
+#endif
+        PackRow(acc + NTSC_KERNEL_START * 4, out + y * NTSC_WIDTH);
+    }
+}
+
+void NtscFilter::Filter(const uint16_t* pixels, uint64_t frame, uint32_t* out) const {
+    FilterFrame(pixels, NTSC_ENTRIES - 1, 0, frame, out);
+}
+
+void NtscFilter::Filter(const uint8_t* indices, uint8_t emphasis, uint64_t frame,
+                        uint32_t* out) const {
+    FilterFrame(indices, PALETTE_SIZE - 1, (uint16_t)((emphasis & 7) << 6), frame, out);
+}
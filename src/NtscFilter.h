@@ -0,0 +1,45 @@
+#ifndef _NTSC_FILTER_H
+#define _NTSC_FILTER_H
+
+#include <cstdint>
+#include <vector>
+#include "Ppu.h"
+
+#define NTSC_WIDTH          (PPU_WIDTH * 2)
+#define NTSC_HEIGHT         PPU_HEIGHT
+#define NTSC_ENTRIES        512     // 6-bit palette index | 3 emphasis bits << 6
+
+// Composite NTSC look for the indexed frame buffer: each pixel is turned
+// into the 2C02's square-wave signal (8 samples at 6x the colour burst),
+// decoded back to RGB with YIQ low-pass filters, at two output pixels per
+// PPU pixel. Chroma bleed, artifact colours and dot crawl follow from the
+// signal. Decoding is linear, so every entry's contribution to its
+// neighbouring outputs is precomputed for each of the three subcarrier
+// phases a pixel can start on; filtering a frame only adds kernels and
+// packs the sums, on AVX2 when the CPU has it.
+class NtscFilter {
+public:
+    NtscFilter();
+    ~NtscFilter() = default;
+
+    // NTSC_WIDTH x NTSC_HEIGHT 0x00RRGGBB pixels into out. The frame number
+    // sets the dot crawl phase. Safe to call from several threads.
+    void Filter(const uint16_t* pixels, uint64_t frame, uint32_t* out) const;
+    // Frame buffer indices with the emphasis bits (PPUMASK bits 5-7) of the
+    // whole frame.
+    void Filter(const uint8_t* indices, uint8_t emphasis, uint64_t frame, uint32_t* out) const;
+
+    // For benchmarks and tests: the scalar path instead of AVX2.
+    void SetSimdEnabled(bool enable);
+    static bool HasSimd(void);
+
+private:
+    std::vector<float> kernels_;    // [entry][phase][output][B, G, R, 0]
+    bool simd_;
+
+    template<typename T>
+    void FilterFrame(const T* pixels, uint16_t mask, uint16_t emphasis, uint64_t frame,
+                     uint32_t* out) const;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "OamDma.h"
+#include "Cpu.h"
+#include "Debugger.h"
+#include "Mmu.h"
+#include "Ppu.h"
+
+OamDma::OamDma(Nes* nes, Mmu* mmu, Cpu* cpu, Ppu* ppu, Debugger* debugger) :
+    nes_(nes), mmu_(mmu), cpu_(cpu), ppu_(ppu), debugger_(debugger)
+{
+
+}
+
+uint8_t OamDma::Read8(uint16_t addr) {
+    return 0;   // write-only
+}
+
+void OamDma::Write8(uint16_t addr, uint8_t data) {
+    uint16_t src = data << 8;
+    const uint8_t* page = mmu_->GetPage(src);
+    // watchpoints and CDL data logging hook Mmu::Read8
+    if (debugger_->IsWatched(src, BP_READ)) {
+        page = nullptr;
+    }
+#ifdef NES_CDL
+    if (src >= 0x8000) {
+        page = nullptr;
+    }
+#endif
+
+    if (page != nullptr) {
+        ppu_->WriteOam(page);
+    } else {
+        uint8_t buf[OAM_SIZE];
+        for (int i = 0; i < OAM_SIZE; i++) {
+            buf[i] = mmu_->Read8(src + i);
+        }
+        ppu_->WriteOam(buf);
+    }
+
+    // one extra alignment cycle when the transfer starts on an odd cycle
+    cpu_->Stall(OAM_DMA_CYCLES + (cpu_->GetCycles() & 1));
+}
@@ -0,0 +1,35 @@
+#ifndef _OAM_DMA_H
+#define _OAM_DMA_H
+
+#include <cstdint>
+#include "IMemoryUnit.h"
+
+#define OAM_DMA_CYCLES  513
+
+class Nes;
+class Mmu;
+class Cpu;
+class Ppu;
+class Debugger;
+
+// $4014: copies CPU page $XX00-$XXFF to sprite OAM and stalls the CPU.
+// Pages backed by plain memory are copied in one go; I/O pages fall back
+// to per-byte reads so register side effects still happen, and so do
+// pages under a read watchpoint and, in NES_CDL builds, PRG-ROM.
+class OamDma : public IMemoryUnit {
+public:
+    OamDma(Nes* nes, Mmu* mmu, Cpu* cpu, Ppu* ppu, Debugger* debugger);
+    ~OamDma() = default;
+
+    virtual uint8_t Read8(uint16_t addr);
+    virtual void Write8(uint16_t addr, uint8_t data);
+
+private:
+    Nes* nes_;
+    Mmu* mmu_;
+    Cpu* cpu_;
+    Ppu* ppu_;
+    Debugger* debugger_;
+};
+
+#endif
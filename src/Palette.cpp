@@ -0,0 +1,42 @@
+#include "Palette.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+static const uint32_t palette_2c02[PALETTE_SIZE] = {
+    0x666666, 0x002A88, 0x1412A7, 0x3B00A4, 0x5C007E, 0x6E0040, 0x6C0600, 0x561D00,
+    0x333500, 0x0B4800, 0x005200, 0x004F08, 0x00404D, 0x000000, 0x000000, 0x000000,
+    0xADADAD, 0x155FD9, 0x4240FF, 0x7527FE, 0xA01ACC, 0xB71E7B, 0xB53120, 0x994E00,
+    0x6B6D00, 0x388700, 0x0C9300, 0x008F32, 0x007C8D, 0x000000, 0x000000, 0x000000,
+    0xFFFEFF, 0x64B0FF, 0x9290FF, 0xC676FF, 0xF36AFF, 0xFE6ECC, 0xFE8170, 0xEA9E22,
+    0xBCBE00, 0x88D800, 0x5CE430, 0x45E082, 0x48CDDE, 0x4F4F4F, 0x000000, 0x000000,
+    0xFFFEFF, 0xC0DFFF, 0xD3D2FF, 0xE8C8FF, 0xFBC2FF, 0xFEC4EA, 0xFECCC5, 0xF7D8A5,
+    0xE4E594, 0xCFEF96, 0xBDF4AB, 0xB3F3CC, 0xB5EBF2, 0xB8B8B8, 0x000000, 0x000000
+};
+
+Palette::Palette() {
+    memcpy(rgb_, palette_2c02, sizeof(rgb_));
+}
+
+bool Palette::Load(const char* filename) {
+    uint8_t buf[PALETTE_SIZE * 3];
+
+    ifstream file(filename, ios::in | ios::binary);
+    // files with emphasis variants carry the plain palette first
+    if (!file.read((char*)buf, sizeof(buf))) {
+        cout << "Not a palette file: " << filename << endl;
+        return false;
+    }
+    for (int i = 0; i < PALETTE_SIZE; i++) {
+        rgb_[i] = (buf[i * 3] << 16) | (buf[i * 3 + 1] << 8) | buf[i * 3 + 2];
+    }
+    return true;
+}
+
+void Palette::Convert(const uint8_t* indices, uint32_t* rgb, size_t count) const {
+    for (size_t i = 0; i < count; i++) {
+        rgb[i] = rgb_[indices[i] & (PALETTE_SIZE - 1)];
+    }
+}
@@ -0,0 +1,24 @@
+#ifndef _PALETTE_H
+#define _PALETTE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define PALETTE_SIZE    64
+
+// Maps PPU palette indices to 0x00RRGGBB pixels. Starts with the 2C02
+// colours; Load replaces them from a .pal file (64 RGB triples).
+class Palette {
+public:
+    Palette();
+    ~Palette() = default;
+
+    bool Load(const char* filename);
+    uint32_t GetColor(uint8_t index) const { return rgb_[index & (PALETTE_SIZE - 1)]; }
+    void Convert(const uint8_t* indices, uint32_t* rgb, size_t count) const;
+
+private:
+    uint32_t rgb_[PALETTE_SIZE];
+};
+
+#endif
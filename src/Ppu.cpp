@@ -0,0 +1,73 @@
+#include "Ppu.h"
+#include <cstring>
+
+static const uint8_t backdrop_frame[PPU_WIDTH * PPU_HEIGHT] = {};
+
+Ppu::Ppu(Nes* nes) :
+    nes_(nes)
+{
+    PowerOn();
+}
+
+void Ppu::PowerOn(void) {
+    memset(&state_, 0, sizeof(state_));
+}
+
+const uint8_t* Ppu::GetFrameBuffer(void) const {
+    return backdrop_frame;
+}
+
+uint8_t Ppu::Read8(uint16_t addr) {
+    uint8_t data = 0;
+
+    switch (addr & 7) {
+        case REG_STATUS:
+            data = state_.status;
+            state_.status &= ~STATUS_VBLANK;
+            break;
+        case REG_OAM_DATA:
+            data = state_.oam[state_.oam_addr];
+            break;
+        default:
+            break;
+    }
+    return data;
+}
+
+void Ppu::Write8(uint16_t addr, uint8_t data) {
+    switch (addr & 7) {
+        case REG_CTRL:
+            state_.ctrl = data;
+            break;
+        case REG_MASK:
+            state_.mask = data;
+            break;
+        case REG_OAM_ADDR:
+            state_.oam_addr = data;
+            break;
+        case REG_OAM_DATA:
+            state_.oam[state_.oam_addr++] = data;
+            break;
+        default:
+            break;
+    }
+}
+
+void Ppu::StartVBlank(void) {
+    state_.status |= STATUS_VBLANK;
+}
+
+void Ppu::WriteOam(const uint8_t* data) {
+    // same as 256 OAMDATA writes: wraps around and leaves OAMADDR unchanged
+    size_t first = OAM_SIZE - state_.oam_addr;
+    memcpy(&state_.oam[state_.oam_addr], data, first);
+    memcpy(&state_.oam[0], data + first, OAM_SIZE - first);
+}
+
+void Ppu::SaveState(ppu_state* state) const {
+    *state = state_;
+}
+
+void Ppu::LoadState(const ppu_state* state) {
+    state_ = *state;
+}
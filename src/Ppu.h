@@ -0,0 +1,70 @@
+#ifndef _PPU_H
+#define _PPU_H
+
+#include <cstdint>
+#include "IMemoryUnit.h"
+
+#define OAM_SIZE    0x100
+
+#define PPU_WIDTH   256
+#define PPU_HEIGHT  240
+
+class Nes;
+
+typedef struct {
+    uint8_t ctrl;
+    uint8_t mask;
+    uint8_t status;
+    uint8_t oam_addr;
+    uint8_t oam[OAM_SIZE];
+} ppu_state;
+
+// PPU register file at $2000-$2007 (mirrored up to $3FFF) and sprite OAM.
+// Rendering is not emulated yet.
+class Ppu : public IMemoryUnit {
+public:
+    enum reg {
+        REG_CTRL = 0,
+        REG_MASK,
+        REG_STATUS,
+        REG_OAM_ADDR,
+        REG_OAM_DATA,
+        REG_SCROLL,
+        REG_ADDR,
+        REG_DATA
+    };
+
+    enum status_flag {
+        STATUS_VBLANK = (1 << 7)
+    };
+
+    Ppu(Nes* nes);
+    ~Ppu() = default;
+
+    virtual uint8_t Read8(uint16_t addr);
+    virtual void Write8(uint16_t addr, uint8_t data);
+
+    void PowerOn(void);
+    void StartVBlank(void);
+
+    // OAM DMA: 256 bytes written through OAMDATA, starting at OAMADDR.
+    void WriteOam(const uint8_t* data);
+    const uint8_t* GetOam(void) const { return state_.oam; }
+
+    // PPU_WIDTH x PPU_HEIGHT palette indices, row by row. The buffer lives
+    // as long as the Ppu. Until rendering is emulated it holds the backdrop
+    // (index 0), and every Ppu returns the same read-only frame rather than
+    // carrying 60 KB of its own.
+    const uint8_t* GetFrameBuffer(void) const;
+    // PPUMASK colour emphasis bits (red, green, blue in bits 0-2).
+    uint8_t GetEmphasis(void) const { return state_.mask >> 5; }
+
+    void SaveState(ppu_state* state) const;
+    void LoadState(const ppu_state* state);
+
+private:
+    Nes* nes_;
+    ppu_state state_;
+};
+
+#endif
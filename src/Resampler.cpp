@@ -0,0 +1,205 @@
+#include "Resampler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RESAMPLER_SIMD
+#endif
+
+using namespace std;
+
+#define RESAMPLER_CUTOFF    0.42    // of the output rate
+
+typedef struct {
+    int decimation;
+    int taps;
+    int phases;
+} quality_params;
+
+static const quality_params quality_table[] = {
+    { 32, 24, 32 },
+    { 16, 64, 64 },
+    { 8, 160, 256 }
+};
+
+static int PadTo8(int n) {
+    return (n + 7) & ~7;
+}
+
+// n is a multiple of 8 everywhere below
+
+static float DotScalar(const float* a, const float* b, int n) {
+    float sum[4] = { 0, 0, 0, 0 };
+    for (int i = 0; i < n; i += 4) {
+        sum[0] += a[i] * b[i];
+        sum[1] += a[i + 1] * b[i + 1];
+        sum[2] += a[i + 2] * b[i + 2];
+        sum[3] += a[i + 3] * b[i + 3];
+    }
+    return (sum[0] + sum[1]) + (sum[2] + sum[3]);
+}
+
+#ifdef RESAMPLER_SIMD
+__attribute__((target("sse")))
+static float DotSse(const float* a, const float* b, int n) {
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+static float DotAvx2(const float* a, const float* b, int n) {
+    __m256 sum0 = _mm256_setzero_ps();
+    __m256 sum1 = _mm256_setzero_ps();
+    int i = 0;
+    // two accumulators hide the FMA latency on the longer filters
+    for (; i + 16 <= n; i += 16) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+        sum1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), sum1);
+    }
+    if (i < n) {
+        sum0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), sum0);
+    }
+    __m256 sum8 = _mm256_add_ps(sum0, sum1);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(sum8), _mm256_extractf128_ps(sum8, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+static bool HasAvx2(void) {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return has_avx2;
+}
+#endif
+
+static Resampler::dot_fn SelectDot(bool simd) {
+#ifdef RESAMPLER_SIMD
+    if (simd) {
+        return HasAvx2() ? DotAvx2 : DotSse;
+    }
+#endif
+    return DotScalar;
+}
+
+void Resampler::SetSimdEnabled(bool enable) {
+    dot_ = SelectDot(enable);
+}
+
+bool Resampler::HasSimd(void) {
+#ifdef RESAMPLER_SIMD
+    return true;
+#else
+    return false;
+#endif
+}
+
+Resampler::Resampler(double in_rate, double out_rate, quality q) :
+    in_rate_(in_rate), out_rate_(out_rate), scale_(1.0), dot_(SelectDot(true))
+{
+    const quality_params& params = quality_table[q];
+    decimation_ = params.decimation;
+    taps_ = PadTo8(params.taps);
+    phases_ = params.phases;
+
+    // stage 1: three cascaded boxcars of decimation_ samples, the impulse
+    // response of a third order CIC, with unity gain at DC
+    vector<double> box(decimation_, 1.0 / decimation_);
+    vector<double> cic(1, 1.0);
+    for (int order = 0; order < 3; order++) {
+        vector<double> next(cic.size() + box.size() - 1, 0.0);
+        for (size_t i = 0; i < cic.size(); i++) {
+            for (size_t j = 0; j < box.size(); j++) {
+                next[i + j] += cic[i] * box[j];
+            }
+        }
+        cic.swap(next);
+    }
+    kernel_.assign(PadTo8(cic.size()), 0.0f);
+    copy(cic.begin(), cic.end(), kernel_.begin());
+
+    // stage 2: Blackman-windowed sinc, one filter per fractional phase
+    double inter_rate = in_rate_ / decimation_;
+    double fc = min(RESAMPLER_CUTOFF * out_rate_, 0.45 * inter_rate) / inter_rate;
+    filters_.assign((size_t)phases_ * taps_, 0.0f);
+    for (int p = 0; p < phases_; p++) {
+        float* h = &filters_[(size_t)p * taps_];
+        double frac = (double)p / phases_;
+        double sum = 0;
+        for (int i = 0; i < params.taps; i++) {
+            double d = i - (params.taps / 2 - 1) - frac;
+            double x = 2 * fc * d;
+            double sinc = (x == 0) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+            double w = (d + params.taps / 2.0) / params.taps;
+            double window = 0.42 - 0.5 * cos(2 * M_PI * w) + 0.08 * cos(4 * M_PI * w);
+            h[i] = sinc * window;
+            sum += h[i];
+        }
+        for (int i = 0; i < params.taps; i++) {
+            h[i] /= sum;
+        }
+    }
+
+    Reset();
+}
+
+void Resampler::Reset(void) {
+    // start on silence so the first samples need no special case
+    input_.assign(kernel_.size(), 0.0f);
+    input_pos_ = 0;
+    inter_.assign(taps_, 0.0f);
+    inter_pos_ = 0;
+    backlog_.clear();
+    SetRateScale(scale_);
+}
+
+void Resampler::SetRateScale(double scale) {
+    scale_ = scale;
+    step_ = in_rate_ / decimation_ / (out_rate_ * scale_);
+}
+
+size_t Resampler::GetOutputCount(size_t count) const {
+    return (size_t)(count / (double)decimation_ / step_ + 0.5);
+}
+
+size_t Resampler::Process(const float* in, size_t count, float* out, size_t max_out) {
+    size_t written = min(backlog_.size(), max_out);
+    memcpy(out, backlog_.data(), written * sizeof(float));
+    backlog_.erase(backlog_.begin(), backlog_.begin() + written);
+
+    // stage 1: one decimated sample per decimation_ inputs
+    input_.insert(input_.end(), in, in + count);
+    int len = kernel_.size();
+    while (input_pos_ + len <= input_.size()) {
+        inter_.push_back(dot_(kernel_.data(), &input_[input_pos_], len));
+        input_pos_ += decimation_;
+    }
+    input_.erase(input_.begin(), input_.begin() + input_pos_);
+    input_pos_ = 0;
+
+    // stage 2: fractional steps through the decimated samples
+    size_t base;
+    while ((base = (size_t)inter_pos_) + taps_ <= inter_.size()) {
+        int phase = (int)((inter_pos_ - base) * phases_);
+        float y = dot_(&filters_[(size_t)phase * taps_], &inter_[base], taps_);
+        if (written < max_out) {
+            out[written++] = y;
+        } else {
+            backlog_.push_back(y);
+        }
+        inter_pos_ += step_;
+    }
+    base = (size_t)inter_pos_;
+    inter_.erase(inter_.begin(), inter_.begin() + base);
+    inter_pos_ -= base;
+    return written;
+}
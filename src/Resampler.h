@@ -0,0 +1,66 @@
+#ifndef _RESAMPLER_H
+#define _RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#define APU_SAMPLE_RATE     1789773.0   // NTSC CPU clock
+#define HOST_SAMPLE_RATE    48000.0
+
+// Streaming sample rate converter for audio generated at the CPU clock.
+// Two stages: a third order CIC decimator by an integer factor, run as an
+// FIR, then a polyphase windowed-sinc FIR at the fractional ratio to the
+// host rate. Both run on an AVX2/FMA or SSE dot product when the CPU has
+// one.
+class Resampler {
+public:
+    enum quality {
+        QUALITY_LOW,        // decimation by 32, 24 taps, 32 phases
+        QUALITY_MEDIUM,     // decimation by 16, 64 taps, 64 phases
+        QUALITY_HIGH        // decimation by 8, 160 taps, 256 phases
+    };
+
+    Resampler(double in_rate=APU_SAMPLE_RATE, double out_rate=HOST_SAMPLE_RATE,
+              quality q=QUALITY_MEDIUM);
+    ~Resampler() = default;
+
+    // Consumes all of in and writes up to max_out samples to out; returns
+    // the number written. Output that doesn't fit is kept for the next call.
+    size_t Process(const float* in, size_t count, float* out, size_t max_out);
+    void Reset(void);
+
+    // Dynamic rate control: produce scale times as many samples as the
+    // nominal ratio, e.g. 1.002 while the host buffer runs low.
+    void SetRateScale(double scale);
+    double GetRateScale(void) const { return scale_; }
+
+    // Output samples for count more input samples, +-1.
+    size_t GetOutputCount(size_t count) const;
+
+    // For benchmarks and tests: the scalar dot product instead of SIMD.
+    void SetSimdEnabled(bool enable);
+    static bool HasSimd(void);
+
+    typedef float (*dot_fn)(const float* a, const float* b, int n);
+
+private:
+    double in_rate_;
+    double out_rate_;
+    double scale_;
+    int decimation_;
+    int taps_;              // stage 2 taps per phase, padded to 8
+    int phases_;
+    dot_fn dot_;            // picked once for the CPU
+
+    std::vector<float> kernel_;     // stage 1, padded to a multiple of 8
+    std::vector<float> filters_;    // stage 2, phases_ x taps_
+    std::vector<float> input_;      // stage 1 history and pending input
+    size_t input_pos_;              // next stage 1 window
+    std::vector<float> inter_;      // stage 2 history and pending samples
+    double inter_pos_;              // position of the next output in inter_
+    double step_;                   // intermediate samples per output
+    std::vector<float> backlog_;    // output that didn't fit
+};
+
+#endif
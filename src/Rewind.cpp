@@ -0,0 +1,80 @@
+#include "Rewind.h"
+#include "DeltaCodec.h"
+
+Rewind::Rewind(Nes* nes, size_t arena_size, size_t max_frames) :
+    nes_(nes), arena_(arena_size), entries_(max_frames)
+{
+    Clear();
+}
+
+void Rewind::Clear(void) {
+    first_ = 0;
+    count_ = 0;
+    write_pos_ = 0;
+    used_ = 0;
+    has_head_ = false;
+}
+
+void Rewind::DropOldest(void) {
+    used_ -= entries_[first_].size;
+    first_ = (first_ + 1) % entries_.size();
+    --count_;
+}
+
+void Rewind::Capture(void) {
+    nes_->SaveState(&cur_);
+    if (!has_head_) {
+        head_ = cur_;
+        has_head_ = true;
+        return;
+    }
+
+    const size_t bound = DeltaCodec::Bound(sizeof(nes_state));
+    if (bound > arena_.size() || entries_.empty()) {
+        head_ = cur_;
+        return;
+    }
+    if (write_pos_ + bound > arena_.size()) {
+        write_pos_ = 0;
+    }
+    // evict entries overlapping the region the new delta may occupy; entries
+    // sit in the arena in ring order, so only the oldest ones can collide
+    while (count_ > 0) {
+        const delta_entry& oldest = entries_[first_];
+        if (oldest.offset + oldest.size <= write_pos_ || oldest.offset >= write_pos_ + bound) {
+            if (count_ < entries_.size()) {
+                break;
+            }
+        }
+        DropOldest();
+    }
+
+    delta_entry entry;
+    entry.offset = write_pos_;
+    entry.size = DeltaCodec::Encode((const uint8_t*)&head_, (const uint8_t*)&cur_,
+                                    sizeof(nes_state), &arena_[write_pos_]);
+    entries_[(first_ + count_) % entries_.size()] = entry;
+    ++count_;
+    write_pos_ += entry.size;
+    used_ += entry.size;
+    head_ = cur_;
+}
+
+bool Rewind::StepBack(void) {
+    if (count_ == 0) {
+        return false;
+    }
+
+    size_t last = (first_ + count_ - 1) % entries_.size();
+    const delta_entry& entry = entries_[last];
+    if (!DeltaCodec::Apply((uint8_t*)&head_, sizeof(nes_state), &arena_[entry.offset], entry.size)) {
+        Clear();
+        return false;
+    }
+    nes_->LoadState(&head_);
+
+    write_pos_ = entry.offset;
+    used_ -= entry.size;
+    --count_;
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef _REWIND_H
+#define _REWIND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Nes.h"
+
+#define REWIND_ARENA_SIZE   (16 << 20)
+#define REWIND_MAX_FRAMES   (60 * 60 * 10)  // 10 minutes at 60 fps
+
+// Per-frame rewind history. Only the newest state is kept whole; every older
+// frame is an XOR delta against its successor, coded by DeltaCodec into a
+// fixed ring arena. When the arena or entry ring is full the oldest frames
+// are dropped. Nothing is allocated after construction.
+class Rewind {
+public:
+    Rewind(Nes* nes, size_t arena_size=REWIND_ARENA_SIZE, size_t max_frames=REWIND_MAX_FRAMES);
+    ~Rewind() = default;
+
+    // Called once per frame, after Nes::RunFrame.
+    void Capture(void);
+    // Restores the state of the previous captured frame.
+    bool StepBack(void);
+    void Clear(void);
+
+    size_t GetFrameCount(void) const { return count_; }
+    size_t GetUsedBytes(void) const { return used_; }
+
+private:
+    typedef struct {
+        uint32_t offset;
+        uint32_t size;
+    } delta_entry;
+
+    Nes* nes_;
+    std::vector<uint8_t> arena_;
+    std::vector<delta_entry> entries_;
+    size_t first_;          // oldest entry
+    size_t count_;
+    size_t write_pos_;
+    size_t used_;
+    bool has_head_;
+    nes_state head_;        // newest captured state
+    nes_state cur_;
+
+    void DropOldest(void);
+};
+
+#endif
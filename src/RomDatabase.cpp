@@ -0,0 +1,178 @@
+#include "RomDatabase.h"
+#include "Crc32.h"
+#include "Sha1.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const uint8_t db_magic[4] = { 0x4E, 0x44, 0x42, 0x1A };
+
+RomDatabase::RomDatabase() :
+    map_(nullptr), map_size_(0), records_(nullptr), count_(0)
+{
+
+}
+
+RomDatabase::~RomDatabase() {
+    Close();
+}
+
+bool RomDatabase::Open(const char* filename) {
+    Close();
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(rom_db_hdr)) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    const rom_db_hdr* header = (const rom_db_hdr*)map;
+    if (memcmp(header->magic, db_magic, sizeof(db_magic)) != 0 ||
+        header->version != ROM_DB_VERSION ||
+        sizeof(rom_db_hdr) + (size_t)header->count * sizeof(rom_db_record) > (size_t)st.st_size) {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    map_ = map;
+    map_size_ = st.st_size;
+    records_ = (const rom_db_record*)(header + 1);
+    count_ = header->count;
+    return true;
+}
+
+void RomDatabase::Close(void) {
+    if (map_ != nullptr) {
+        munmap(map_, map_size_);
+    }
+    map_ = nullptr;
+    map_size_ = 0;
+    records_ = nullptr;
+    count_ = 0;
+
+    lock_guard<mutex> lock(cache_mutex_);
+    cache_.clear();
+}
+
+const rom_db_record* RomDatabase::Lookup(uint32_t crc, const uint8_t* sha1) const {
+    const rom_db_record* end = records_ + count_;
+    const rom_db_record* it = lower_bound(records_, end, crc,
+        [](const rom_db_record& r, uint32_t c) { return r.crc < c; });
+
+    // a CRC collision is resolved by SHA-1 when the caller has one
+    for (; it != end && it->crc == crc; ++it) {
+        if (sha1 == nullptr || memcmp(it->sha1, sha1, SHA1_DIGEST_SIZE) == 0) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+bool RomDatabase::Identify(const uint8_t* prg, size_t prg_size, const uint8_t* chr, size_t chr_size,
+                           rom_info* info) const {
+    info->crc = Crc32::Compute(chr, chr_size, Crc32::Compute(prg, prg_size));
+    Sha1 sha1;
+    sha1.Update(prg, prg_size);
+    sha1.Update(chr, chr_size);
+    sha1.Final(info->sha1);
+
+    const rom_db_record* record = Lookup(info->crc, info->sha1);
+    info->in_database = record != nullptr;
+    if (record != nullptr) {
+        info->mapper = record->mapper;
+        info->submapper = record->submapper;
+        info->mirroring = record->mirroring;
+        info->tv_system = record->tv_system;
+        info->battery = record->battery != 0;
+        info->cycle_cpu = (record->flags & ROM_DB_FLAG_CYCLE_CPU) != 0;
+    }
+    return info->in_database;
+}
+
+bool RomDatabase::IdentifyFile(const char* filename, rom_info* info) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    int64_t mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+
+    {
+        lock_guard<mutex> lock(cache_mutex_);
+        auto it = cache_.find(filename);
+        if (it != cache_.end() && it->second.size == (uint64_t)st.st_size &&
+            it->second.mtime_ns == mtime_ns) {
+            close(fd);
+            *info = it->second.info;
+            return it->second.valid;
+        }
+    }
+
+    bool valid = false;
+    memset(info, 0, sizeof(*info));
+    if ((size_t)st.st_size >= sizeof(ines_hdr)) {
+        void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            const uint8_t* data = (const uint8_t*)map;
+            if (Cartridge::ParseHeader(*(const ines_hdr*)data, info)) {
+                size_t offset = sizeof(ines_hdr) + (info->trainer ? 512 : 0);
+                size_t prg_size = info->prg_rom_size;
+                size_t chr_size = info->chr_rom_size;
+                // truncated dumps are hashed as far as they go
+                size_t avail = (size_t)st.st_size > offset ? st.st_size - offset : 0;
+                prg_size = min(prg_size, avail);
+                chr_size = min(chr_size, avail - prg_size);
+                Identify(data + offset, prg_size, data + offset + prg_size, chr_size, info);
+                valid = true;
+            }
+            munmap(map, st.st_size);
+        }
+    }
+    close(fd);
+
+    cache_entry entry;
+    entry.size = st.st_size;
+    entry.mtime_ns = mtime_ns;
+    entry.valid = valid;
+    entry.info = *info;
+    lock_guard<mutex> lock(cache_mutex_);
+    cache_[filename] = entry;
+    return valid;
+}
+
+bool RomDatabase::Write(const char* filename, vector<rom_db_record> records) {
+    sort(records.begin(), records.end(),
+        [](const rom_db_record& a, const rom_db_record& b) { return a.crc < b.crc; });
+
+    ofstream file(filename, ios::out | ios::binary | ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    rom_db_hdr header;
+    memcpy(header.magic, db_magic, sizeof(db_magic));
+    header.version = ROM_DB_VERSION;
+    header.count = records.size();
+    header.reserved = 0;
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)records.data(), records.size() * sizeof(rom_db_record));
+    return (bool)file;
+}
@@ -0,0 +1,81 @@
+#ifndef _ROM_DATABASE_H
+#define _ROM_DATABASE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Cartridge.h"
+
+#define ROM_DB_VERSION  1
+
+#define ROM_DB_FLAG_CYCLE_CPU   (1 << 0)    // needs the per-cycle CPU core
+
+// File layout: rom_db_hdr followed by rom_db_record entries sorted by crc.
+// The file is mapped read-only and searched in place, so opening it costs
+// nothing regardless of its size and lookups can run on many threads.
+
+typedef struct {
+    uint8_t magic[4];       // 0x4E 0x44 0x42 0x1A ("NDB" followed by DOS EOF)
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+} rom_db_hdr;
+
+typedef struct {
+    uint32_t crc;           // CRC-32 of PRG + CHR
+    uint8_t sha1[20];       // SHA-1 of PRG + CHR
+    uint16_t mapper;
+    uint8_t submapper;
+    uint8_t mirroring;      // Cartridge::mirroring
+    uint8_t tv_system;      // Cartridge::tv_system
+    uint8_t battery;
+    uint8_t flags;          // ROM_DB_FLAG_*
+    uint8_t reserved;
+} rom_db_record;
+
+class RomDatabase {
+public:
+    RomDatabase();
+    ~RomDatabase();
+
+    bool Open(const char* filename);
+    void Close(void);
+    size_t GetCount(void) const { return count_; }
+
+    const rom_db_record* Lookup(uint32_t crc, const uint8_t* sha1=nullptr) const;
+
+    // Hashes PRG + CHR into info and applies the database entry, if any.
+    // Returns true when the ROM is known.
+    bool Identify(const uint8_t* prg, size_t prg_size, const uint8_t* chr, size_t chr_size,
+                  rom_info* info) const;
+
+    // Parses, hashes and looks up a ROM file. Results are cached by path,
+    // size and modification time, so rescans only hash changed files.
+    bool IdentifyFile(const char* filename, rom_info* info);
+
+    static bool Write(const char* filename, std::vector<rom_db_record> records);
+
+private:
+    RomDatabase(const RomDatabase&) = delete;
+    RomDatabase& operator=(const RomDatabase&) = delete;
+
+    typedef struct {
+        uint64_t size;
+        int64_t mtime_ns;
+        bool valid;
+        rom_info info;
+    } cache_entry;
+
+    void* map_;
+    size_t map_size_;
+    const rom_db_record* records_;
+    size_t count_;
+
+    std::mutex cache_mutex_;
+    std::unordered_map<std::string, cache_entry> cache_;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "RunAhead.h"
+#include <chrono>
+
+using namespace std;
+
+static inline uint64_t NowNs(void) {
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+RunAhead::RunAhead(Nes* nes, int frames) :
+    nes_(nes)
+{
+    SetFrames(frames);
+    ResetStats();
+}
+
+void RunAhead::SetFrames(int frames) {
+    if (frames < 0) {
+        frames = 0;
+    } else if (frames > RUN_AHEAD_MAX_FRAMES) {
+        frames = RUN_AHEAD_MAX_FRAMES;
+    }
+    frames_ = frames;
+}
+
+void RunAhead::ResetStats(void) {
+    stats_.frames = 0;
+    stats_.emulate_ns = 0;
+    stats_.ahead_ns = 0;
+    stats_.state_ns = 0;
+}
+
+void RunAhead::RunFrame(void) {
+    uint64_t t0 = NowNs();
+    if (frames_ == 0) {
+        nes_->RunFrame();
+        stats_.emulate_ns += NowNs() - t0;
+        ++stats_.frames;
+        return;
+    }
+
+    nes_->RunFrame(false);
+    uint64_t t1 = NowNs();
+    if (nes_->IsPaused()) {
+        // the next call after Debugger::Resume finishes the real frame
+        stats_.emulate_ns += t1 - t0;
+        return;
+    }
+    nes_->SaveState(&state_);
+    uint64_t t2 = NowNs();
+    // speculative frames are rolled back: no trace, recorder, CDL or
+    // breakpoints
+    for (int i = 1; i < frames_; i++) {
+        nes_->RunFrame(false, false, false);
+    }
+    nes_->RunFrame(true, false, false);
+    uint64_t t3 = NowNs();
+    nes_->LoadState(&state_);
+    uint64_t t4 = NowNs();
+
+    stats_.emulate_ns += t1 - t0;
+    stats_.state_ns += (t2 - t1) + (t4 - t3);
+    stats_.ahead_ns += t3 - t2;
+    ++stats_.frames;
+}
+
+double RunAhead::GetOverheadNs(void) const {
+    if (stats_.frames == 0) {
+        return 0.0;
+    }
+    return (double)(stats_.ahead_ns + stats_.state_ns) / stats_.frames;
+}
+
+double RunAhead::GetOverheadRatio(void) const {
+    if (stats_.emulate_ns == 0) {
+        return 0.0;
+    }
+    return (double)(stats_.ahead_ns + stats_.state_ns) / stats_.emulate_ns;
+}
@@ -0,0 +1,47 @@
+#ifndef _RUN_AHEAD_H
+#define _RUN_AHEAD_H
+
+#include <cstdint>
+#include "Nes.h"
+
+#define RUN_AHEAD_MAX_FRAMES    8
+
+typedef struct {
+    uint64_t frames;        // host frames run
+    uint64_t emulate_ns;    // time spent on the real frames
+    uint64_t ahead_ns;      // time spent on speculative frames
+    uint64_t state_ns;      // time spent saving and restoring state
+} run_ahead_stats;
+
+// Run-ahead: each host frame advances the machine one real frame, then
+// speculatively runs N more frames with the same input and shows the last
+// one before restoring the real state. Hides N frames of game input lag at
+// the cost of N extra frames of emulation plus one save/load per frame.
+class RunAhead {
+public:
+    RunAhead(Nes* nes, int frames=1);
+    ~RunAhead() = default;
+
+    // Replaces Nes::RunFrame for every host frame; input must already be set.
+    // Only the real frame is traced and can hit a breakpoint; while paused
+    // nothing is run ahead.
+    void RunFrame(void);
+
+    void SetFrames(int frames);
+    int GetFrames(void) const { return frames_; }
+
+    const run_ahead_stats& GetStats(void) const { return stats_; }
+    void ResetStats(void);
+    // Average extra time per host frame compared to running without
+    // run-ahead, in nanoseconds and as a ratio of the real frame time.
+    double GetOverheadNs(void) const;
+    double GetOverheadRatio(void) const;
+
+private:
+    Nes* nes_;
+    int frames_;
+    run_ahead_stats stats_;
+    nes_state state_;
+};
+
+#endif
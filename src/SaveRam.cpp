@@ -0,0 +1,122 @@
+#include "SaveRam.h"
+#include <chrono>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+SaveRam::SaveRam() :
+    fd_(-1), data_(nullptr), size_(0), flush_interval_ms_(SAVE_RAM_FLUSH_MS), stop_(false)
+{
+
+}
+
+SaveRam::~SaveRam() {
+    Close();
+}
+
+bool SaveRam::Open(const char* filename, size_t size, int flush_interval_ms) {
+    Close();
+
+    int fd = open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    // two writers would share the RAM through the page cache; the lock goes
+    // away with the descriptor
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        close(fd);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 ||
+        ((size_t)st.st_size < size && ftruncate(fd, size) != 0)) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        close(fd);
+        return false;
+    }
+
+    fd_ = fd;
+    data_ = (uint8_t*)data;
+    size_ = size;
+    flush_interval_ms_ = flush_interval_ms;
+    stop_ = false;
+    thread_ = thread(&SaveRam::FlushThread, this);
+    return true;
+}
+
+bool SaveRam::OpenCopy(const char* filename, size_t size) {
+    Close();
+
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    int fd = open(filename, O_RDONLY);
+    if (fd >= 0) {
+        ssize_t n = pread(fd, data, size, 0);
+        close(fd);
+        if (n < 0) {
+            munmap(data, size);
+            return false;
+        }
+    }
+
+    data_ = (uint8_t*)data;
+    size_ = size;
+    return true;
+}
+
+void SaveRam::Close(void) {
+    if (data_ == nullptr) {
+        return;
+    }
+    if (fd_ < 0) {
+        munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+
+    Flush();
+    munmap(data_, size_);
+    close(fd_);
+    fd_ = -1;
+    data_ = nullptr;
+    size_ = 0;
+}
+
+void SaveRam::Flush(void) {
+    if (fd_ >= 0) {
+        // only pages the kernel saw dirtied are written back
+        msync(data_, size_, MS_SYNC);
+    }
+}
+
+void SaveRam::FlushThread(void) {
+    unique_lock<mutex> lock(mutex_);
+    while (!stop_) {
+        cv_.wait_for(lock, chrono::milliseconds(flush_interval_ms_));
+        if (!stop_) {
+            lock.unlock();
+            Flush();
+            lock.lock();
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef _SAVE_RAM_H
+#define _SAVE_RAM_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#define SAVE_RAM_FLUSH_MS   1000
+
+enum save_ram_mode {
+    SAVE_RAM_WRITE_BACK,    // mapped onto the .sav, one writer per file
+    SAVE_RAM_COPY           // private copy of the .sav, never written back
+};
+
+// Battery-backed cartridge RAM mapped straight onto its .sav file. The
+// emulator writes the mapping with plain stores; the kernel tracks which
+// pages are dirty and a background thread msyncs them on a timer and on
+// Close(), so the emulation thread never does file I/O.
+class SaveRam {
+public:
+    SaveRam();
+    ~SaveRam();
+
+    // Fails if the file can't be opened or another SaveRam, in this or any
+    // other process, already writes it back.
+    bool Open(const char* filename, size_t size, int flush_interval_ms=SAVE_RAM_FLUSH_MS);
+    // Reads the file once into private memory, zeroes if it doesn't exist.
+    // For machines whose saves must not reach the file: searches, workers,
+    // or a second instance of the same game.
+    bool OpenCopy(const char* filename, size_t size);
+    void Close(void);
+    void Flush(void);
+
+    uint8_t* GetData(void) { return data_; }
+    size_t GetSize(void) const { return size_; }
+    bool IsOpen(void) const { return data_ != nullptr; }
+    bool IsWriteBack(void) const { return fd_ >= 0; }
+
+private:
+    SaveRam(const SaveRam&) = delete;
+    SaveRam& operator=(const SaveRam&) = delete;
+
+    void FlushThread(void);
+
+    int fd_;
+    uint8_t* data_;
+    size_t size_;
+    int flush_interval_ms_;
+
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stop_;
+};
+
+#endif
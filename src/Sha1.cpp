@@ -0,0 +1,210 @@
+#include "Sha1.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA1_NI
+#endif
+
+static inline uint32_t Rol(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+Sha1::Sha1() :
+    size_(0), block_len_(0), sha_ni_(HasShaNi())
+{
+    h_[0] = 0x67452301;
+    h_[1] = 0xEFCDAB89;
+    h_[2] = 0x98BADCFE;
+    h_[3] = 0x10325476;
+    h_[4] = 0xC3D2E1F0;
+}
+
+static void TransformPortable(uint32_t h[5], const uint8_t* block) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16) |
+               ((uint32_t)block[4 * i + 2] << 8) | block[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = Rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t t = Rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = Rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+#ifdef SHA1_NI
+// Rounds 4g..4g+3. msg holds schedule words 4g..4g+3 and next, prev and
+// prev2 those of groups g+1, g-1 and g-2 (mod 4): group k is built by
+// sha1msg1 in group k-3, the xor in k-2 and sha1msg2 in k-1. e_cur holds
+// this group's E, e_next receives the next one.
+#define SHA1_ROUNDS(g, e_cur, e_next, msg, next, prev, prev2) \
+    do { \
+        e_cur = _mm_sha1nexte_epu32(e_cur, msg); \
+        e_next = abcd; \
+        if ((g) >= 3 && (g) <= 18) next = _mm_sha1msg2_epu32(next, msg); \
+        abcd = _mm_sha1rnds4_epu32(abcd, e_cur, (g) / 5); \
+        if ((g) >= 1 && (g) <= 16) prev = _mm_sha1msg1_epu32(prev, msg); \
+        if ((g) >= 2 && (g) <= 17) prev2 = _mm_xor_si128(prev2, msg); \
+    } while (0)
+
+__attribute__((target("ssse3,sse4.1,sha")))
+static void TransformShaNi(uint32_t h[5], const uint8_t* data, size_t count) {
+    const __m128i swap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)h), 0x1B);
+    __m128i e0 = _mm_set_epi32(h[4], 0, 0, 0);
+    __m128i e1, m0, m1, m2, m3;
+
+    for (; count > 0; count--, data += 64) {
+        __m128i abcd_save = abcd;
+        __m128i e0_save = e0;
+
+        m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), swap);
+        e0 = _mm_add_epi32(e0, m0);
+        e1 = abcd;
+        abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 16)), swap);
+        SHA1_ROUNDS(1, e1, e0, m1, m2, m0, m3);
+        m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 32)), swap);
+        SHA1_ROUNDS(2, e0, e1, m2, m3, m1, m0);
+        m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data + 48)), swap);
+        SHA1_ROUNDS(3, e1, e0, m3, m0, m2, m1);
+        SHA1_ROUNDS(4, e0, e1, m0, m1, m3, m2);
+        SHA1_ROUNDS(5, e1, e0, m1, m2, m0, m3);
+        SHA1_ROUNDS(6, e0, e1, m2, m3, m1, m0);
+        SHA1_ROUNDS(7, e1, e0, m3, m0, m2, m1);
+        SHA1_ROUNDS(8, e0, e1, m0, m1, m3, m2);
+        SHA1_ROUNDS(9, e1, e0, m1, m2, m0, m3);
+        SHA1_ROUNDS(10, e0, e1, m2, m3, m1, m0);
+        SHA1_ROUNDS(11, e1, e0, m3, m0, m2, m1);
+        SHA1_ROUNDS(12, e0, e1, m0, m1, m3, m2);
+        SHA1_ROUNDS(13, e1, e0, m1, m2, m0, m3);
+        SHA1_ROUNDS(14, e0, e1, m2, m3, m1, m0);
+        SHA1_ROUNDS(15, e1, e0, m3, m0, m2, m1);
+        SHA1_ROUNDS(16, e0, e1, m0, m1, m3, m2);
+        SHA1_ROUNDS(17, e1, e0, m1, m2, m0, m3);
+        SHA1_ROUNDS(18, e0, e1, m2, m3, m1, m0);
+        SHA1_ROUNDS(19, e1, e0, m3, m0, m2, m1);
+
+        e0 = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128((__m128i*)h, _mm_shuffle_epi32(abcd, 0x1B));
+    h[4] = _mm_extract_epi32(e0, 3);
+}
+#endif
+
+bool Sha1::HasShaNi(void) {
+#ifdef SHA1_NI
+    static const bool has_sha_ni = []() {
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_SHA)) {
+            return false;
+        }
+        return __builtin_cpu_supports("ssse3") && __builtin_cpu_supports("sse4.1");
+    }();
+    return has_sha_ni;
+#else
+    return false;
+#endif
+}
+
+void Sha1::Transform(const uint8_t* blocks, size_t count) {
+#ifdef SHA1_NI
+    if (sha_ni_) {
+        TransformShaNi(h_, blocks, count);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; i++) {
+        TransformPortable(h_, blocks + 64 * i);
+    }
+}
+
+void Sha1::Update(const uint8_t* data, size_t size) {
+    size_ += size;
+    if (block_len_ > 0) {
+        size_t n = 64 - block_len_;
+        if (n > size) {
+            n = size;
+        }
+        memcpy(block_ + block_len_, data, n);
+        block_len_ += n;
+        data += n;
+        size -= n;
+        if (block_len_ < 64) {
+            return;
+        }
+        Transform(block_, 1);
+        block_len_ = 0;
+    }
+    if (size >= 64) {
+        Transform(data, size / 64);
+        data += size & ~(size_t)63;
+        size &= 63;
+    }
+    memcpy(block_, data, size);
+    block_len_ = size;
+}
+
+void Sha1::Final(uint8_t digest[SHA1_DIGEST_SIZE]) {
+    uint64_t bits = size_ * 8;
+    uint8_t pad[72];
+    size_t pad_len = (block_len_ < 56) ? 56 - block_len_ : 120 - block_len_;
+
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (int i = 0; i < 8; i++) {
+        pad[pad_len + i] = bits >> (56 - 8 * i);
+    }
+    Update(pad, pad_len + 8);
+
+    for (int i = 0; i < 5; i++) {
+        digest[4 * i] = h_[i] >> 24;
+        digest[4 * i + 1] = h_[i] >> 16;
+        digest[4 * i + 2] = h_[i] >> 8;
+        digest[4 * i + 3] = h_[i];
+    }
+}
+
+void Sha1::Compute(const uint8_t* data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE]) {
+    Sha1 sha1;
+    sha1.Update(data, size);
+    sha1.Final(digest);
+}
+
+void Sha1::ComputePortable(const uint8_t* data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE]) {
+    Sha1 sha1;
+    sha1.sha_ni_ = false;
+    sha1.Update(data, size);
+    sha1.Final(digest);
+}
@@ -0,0 +1,35 @@
+#ifndef _SHA1_H
+#define _SHA1_H
+
+#include <cstddef>
+#include <cstdint>
+
+#define SHA1_DIGEST_SIZE    20
+
+// SHA-1 of ROM images for database lookups. Blocks go through the SHA
+// extensions (sha1rnds4/sha1msg1/sha1msg2) when the CPU has them, else a
+// portable implementation.
+class Sha1 {
+public:
+    Sha1();
+    ~Sha1() = default;
+
+    void Update(const uint8_t* data, size_t size);
+    void Final(uint8_t digest[SHA1_DIGEST_SIZE]);
+
+    static void Compute(const uint8_t* data, size_t size, uint8_t digest[SHA1_DIGEST_SIZE]);
+    static void ComputePortable(const uint8_t* data, size_t size,
+                                uint8_t digest[SHA1_DIGEST_SIZE]);
+    static bool HasShaNi(void);
+
+private:
+    uint32_t h_[5];
+    uint64_t size_;
+    uint8_t block_[64];
+    size_t block_len_;
+    bool sha_ni_;
+
+    void Transform(const uint8_t* blocks, size_t count);
+};
+
+#endif
@@ -0,0 +1,178 @@
+#include "StateHash.h"
+#include <cstring>
+
+#define XXH_PRIME1  0x9E3779B185EBCA87ull
+#define XXH_PRIME2  0xC2B2AE3D27D4EB4Full
+#define XXH_PRIME3  0x165667B19E3779F9ull
+#define XXH_PRIME4  0x85EBCA77C2B2AE63ull
+#define XXH_PRIME5  0x27D4EB2F165667C5ull
+
+// frame, registers, cycles, mapper, controller and PPU registers, OAM
+#define STATE_HEAD_SIZE \
+    (8 + 7 + 8 + 8 + 2 * NUM_PORTS + 1 + 4 + OAM_SIZE)
+#define STATE_CANONICAL_SIZE \
+    (STATE_HEAD_SIZE + 8 * (STATE_HASH_RAM_PAGES + STATE_HASH_PRG_RAM_PAGES))
+
+static_assert(STATE_HASH_RAM_PAGES <= 32 && STATE_HASH_PRG_RAM_PAGES <= 32,
+              "dirty masks are 32 bits");
+
+static inline uint64_t Rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t Load64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t Load32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * XXH_PRIME2;
+    return Rotl(acc, 31) * XXH_PRIME1;
+}
+
+static inline uint64_t Merge(uint64_t acc, uint64_t val) {
+    acc ^= Round(0, val);
+    return acc * XXH_PRIME1 + XXH_PRIME4;
+}
+
+uint64_t StateHash::Compute(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*)data;
+    const uint8_t* end = p + size;
+    uint64_t h;
+
+    if (size >= 32) {
+        // four independent lanes over 32-byte stripes
+        uint64_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+        uint64_t v2 = seed + XXH_PRIME2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME1;
+        do {
+            v1 = Round(v1, Load64(p));
+            v2 = Round(v2, Load64(p + 8));
+            v3 = Round(v3, Load64(p + 16));
+            v4 = Round(v4, Load64(p + 24));
+            p += 32;
+        } while (end - p >= 32);
+        h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+        h = Merge(h, v1);
+        h = Merge(h, v2);
+        h = Merge(h, v3);
+        h = Merge(h, v4);
+    } else {
+        h = seed + XXH_PRIME5;
+    }
+    h += size;
+
+    for (; end - p >= 8; p += 8) {
+        h ^= Round(0, Load64(p));
+        h = Rotl(h, 27) * XXH_PRIME1 + XXH_PRIME4;
+    }
+    if (end - p >= 4) {
+        h ^= Load32(p) * XXH_PRIME1;
+        h = Rotl(h, 23) * XXH_PRIME2 + XXH_PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * XXH_PRIME5;
+        h = Rotl(h, 11) * XXH_PRIME1;
+    }
+
+    h ^= h >> 33;
+    h *= XXH_PRIME2;
+    h ^= h >> 29;
+    h *= XXH_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint8_t* Put(uint8_t* p, uint64_t val, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        *p++ = val >> (8 * i);
+    }
+    return p;
+}
+
+static uint8_t* Put(uint8_t* p, const uint8_t* data, size_t size) {
+    memcpy(p, data, size);
+    return p + size;
+}
+
+uint64_t StateHash::Combine(const nes_state& state, const uint64_t* ram_hash,
+                            const uint64_t* prg_ram_hash) {
+    uint8_t buf[STATE_CANONICAL_SIZE];
+    uint8_t* p = buf;
+
+    p = Put(p, state.frame, 8);
+    const registers& reg = state.cpu.reg;
+    p = Put(p, reg.A, 1);
+    p = Put(p, reg.X, 1);
+    p = Put(p, reg.Y, 1);
+    p = Put(p, reg.PC, 2);
+    p = Put(p, reg.SP, 1);
+    p = Put(p, reg.P, 1);
+    p = Put(p, state.cpu.cycles, 8);
+    p = Put(p, state.cartridge.mapper_regs, sizeof(state.cartridge.mapper_regs));
+    p = Put(p, state.controller.buttons, NUM_PORTS);
+    p = Put(p, state.controller.shift, NUM_PORTS);
+    p = Put(p, state.controller.strobe, 1);
+    p = Put(p, state.ppu.ctrl, 1);
+    p = Put(p, state.ppu.mask, 1);
+    p = Put(p, state.ppu.status, 1);
+    p = Put(p, state.ppu.oam_addr, 1);
+    p = Put(p, state.ppu.oam, OAM_SIZE);
+    for (int i = 0; i < STATE_HASH_RAM_PAGES; i++) {
+        p = Put(p, ram_hash[i], 8);
+    }
+    for (int i = 0; i < STATE_HASH_PRG_RAM_PAGES; i++) {
+        p = Put(p, prg_ram_hash[i], 8);
+    }
+    return Compute(buf, p - buf);
+}
+
+StateHash::StateHash() :
+    valid_(false)
+{
+    memset(ram_hash_, 0, sizeof(ram_hash_));
+    memset(prg_ram_hash_, 0, sizeof(prg_ram_hash_));
+}
+
+uint64_t StateHash::Hash(const nes_state& state) {
+    uint64_t ram_hash[STATE_HASH_RAM_PAGES];
+    uint64_t prg_ram_hash[STATE_HASH_PRG_RAM_PAGES];
+
+    for (int i = 0; i < STATE_HASH_RAM_PAGES; i++) {
+        ram_hash[i] = Compute(&state.mmu.ram[i * STATE_HASH_PAGE_SIZE], STATE_HASH_PAGE_SIZE);
+    }
+    for (int i = 0; i < STATE_HASH_PRG_RAM_PAGES; i++) {
+        prg_ram_hash[i] = Compute(&state.cartridge.prg_ram[i * STATE_HASH_PAGE_SIZE],
+                                  STATE_HASH_PAGE_SIZE);
+    }
+    return Combine(state, ram_hash, prg_ram_hash);
+}
+
+uint64_t StateHash::Update(const nes_state& state, const uint8_t* ram, uint32_t ram_dirty,
+                           const uint8_t* prg_ram, uint32_t prg_ram_dirty) {
+    if (!valid_) {
+        ram_dirty = ~0u;
+        prg_ram_dirty = ~0u;
+        valid_ = true;
+    }
+    for (int i = 0; i < STATE_HASH_RAM_PAGES; i++) {
+        if (ram_dirty & (1u << i)) {
+            ram_hash_[i] = Compute(&ram[i * STATE_HASH_PAGE_SIZE], STATE_HASH_PAGE_SIZE);
+        }
+    }
+    for (int i = 0; i < STATE_HASH_PRG_RAM_PAGES; i++) {
+        if (prg_ram_dirty & (1u << i)) {
+            prg_ram_hash_[i] = Compute(&prg_ram[i * STATE_HASH_PAGE_SIZE], STATE_HASH_PAGE_SIZE);
+        }
+    }
+    return Combine(state, ram_hash_, prg_ram_hash_);
+}
@@ -0,0 +1,46 @@
+#ifndef _STATE_HASH_H
+#define _STATE_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Nes.h"
+
+#define STATE_HASH_PAGE_SIZE        0x100
+#define STATE_HASH_RAM_PAGES        (RAM_SIZE / STATE_HASH_PAGE_SIZE)
+#define STATE_HASH_PRG_RAM_PAGES    (PRG_RAM_SIZE / STATE_HASH_PAGE_SIZE)
+
+// 64-bit fingerprint of a whole machine, for deduplicating states in input
+// searches and comparing runs. The hash covers a canonical layout of
+// nes_state, independent of struct padding: the frame, registers and
+// cycles, mapper, controller and PPU registers, then the XXH64 of every
+// 256-byte page of RAM and PRG RAM. Page hashes are cached, so an Update
+// after a frame only rehashes the pages written since the last one (see
+// Mmu::TakeDirtyPages).
+class StateHash {
+public:
+    StateHash();
+    ~StateHash() = default;
+
+    // XXH64. Bytes are read little-endian.
+    static uint64_t Compute(const void* data, size_t size, uint64_t seed=0);
+    // Hash of a saved state.
+    static uint64_t Hash(const nes_state& state);
+
+    // Hash(state) of a machine whose RAM and PRG RAM are ram and prg_ram
+    // rather than the arrays in state, which are ignored. Only pages set in
+    // the dirty masks (bit n: page n) and pages never seen are rehashed.
+    uint64_t Update(const nes_state& state, const uint8_t* ram, uint32_t ram_dirty,
+                    const uint8_t* prg_ram, uint32_t prg_ram_dirty);
+    // Rehash every page on the next Update.
+    void Invalidate(void) { valid_ = false; }
+
+private:
+    bool valid_;
+    uint64_t ram_hash_[STATE_HASH_RAM_PAGES];
+    uint64_t prg_ram_hash_[STATE_HASH_PRG_RAM_PAGES];
+
+    static uint64_t Combine(const nes_state& state, const uint64_t* ram_hash,
+                            const uint64_t* prg_ram_hash);
+};
+
+#endif
@@ -0,0 +1,400 @@
+#include "TraceArchive.h"
+#include "LzCodec.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+static const uint8_t trace_magic[4] = { 0x4E, 0x54, 0x52, 0x1A };
+static const uint8_t index_magic[4] = { 0x4E, 0x54, 0x49, 0x1A };
+
+// record flags: registers that differ from the previous record
+#define TRACE_A     (1 << 0)
+#define TRACE_X     (1 << 1)
+#define TRACE_Y     (1 << 2)
+#define TRACE_P     (1 << 3)
+#define TRACE_SP    (1 << 4)
+#define TRACE_PC    (1 << 5)    // PC is not the previous PC + instruction size
+#define TRACE_ALL   0x3F
+
+// opcode, 2 operand bytes, 5 registers, PC, 10 byte varint
+#define TRACE_RECORD_MAX    (1 + 1 + 2 + 5 + 2 + 10)
+
+static inline int OpcodeSize(uint8_t opcode) {
+    return Cpu::GetOpcode(opcode).size;
+}
+
+TraceWriter::TraceWriter() :
+    chunk_instructions_(TRACE_CHUNK_INSTRUCTIONS), instructions_(0), count_(0), first_cycles_(0)
+{
+    memset(&prev_, 0, sizeof(prev_));
+}
+
+TraceWriter::~TraceWriter() {
+    Close();
+}
+
+bool TraceWriter::Open(const char* filename, uint32_t chunk_instructions) {
+    Close();
+
+    if (chunk_instructions == 0) {
+        return false;
+    }
+    file_.open(filename, ios::out | ios::binary | ios::trunc);
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    trace_hdr header;
+    memcpy(header.magic, trace_magic, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.chunk_instructions = chunk_instructions;
+    header.reserved = 0;
+    file_.write((const char*)&header, sizeof(header));
+
+    chunk_instructions_ = chunk_instructions;
+    instructions_ = 0;
+    count_ = 0;
+    raw_.clear();
+    raw_.reserve((size_t)chunk_instructions * TRACE_RECORD_MAX);
+    index_.clear();
+    return true;
+}
+
+bool TraceWriter::Close(void) {
+    if (!file_.is_open()) {
+        return true;
+    }
+    WriteChunk();
+
+    trace_footer footer;
+    footer.index_offset = file_.tellp();
+    footer.chunk_count = index_.size();
+    footer.reserved = 0;
+    memcpy(footer.magic, index_magic, sizeof(footer.magic));
+    file_.write((const char*)index_.data(), index_.size() * sizeof(trace_index_entry));
+    file_.write((const char*)&footer, sizeof(footer));
+
+    bool ok = file_.good();
+    file_.close();
+    index_.clear();
+    return ok;
+}
+
+void TraceWriter::OnInstruction(const registers& reg, uint8_t opcode, uint16_t operand,
+                                uint64_t cycles) {
+    if (!file_.is_open()) {
+        return;
+    }
+
+    // deltas only go forward
+    if (count_ != 0 && cycles < prev_.cycles) {
+        WriteChunk();
+    }
+
+    uint8_t flags = TRACE_ALL;
+    uint64_t delta = 0;
+    if (count_ == 0) {
+        first_cycles_ = cycles;
+    } else {
+        flags = (reg.A != prev_.reg.A ? TRACE_A : 0) |
+                (reg.X != prev_.reg.X ? TRACE_X : 0) |
+                (reg.Y != prev_.reg.Y ? TRACE_Y : 0) |
+                (reg.P != prev_.reg.P ? TRACE_P : 0) |
+                (reg.SP != prev_.reg.SP ? TRACE_SP : 0) |
+                (reg.PC != (uint16_t)(prev_.reg.PC + OpcodeSize(prev_.opcode)) ? TRACE_PC : 0);
+        delta = cycles - prev_.cycles;
+    }
+
+    size_t pos = raw_.size();
+    raw_.resize(pos + TRACE_RECORD_MAX);
+    uint8_t* p = &raw_[pos];
+    *p++ = flags;
+    *p++ = opcode;
+    int size = OpcodeSize(opcode);
+    if (size > 1) {
+        *p++ = operand & 0xFF;
+    }
+    if (size > 2) {
+        *p++ = operand >> 8;
+    }
+    if (flags & TRACE_A) *p++ = reg.A;
+    if (flags & TRACE_X) *p++ = reg.X;
+    if (flags & TRACE_Y) *p++ = reg.Y;
+    if (flags & TRACE_P) *p++ = reg.P;
+    if (flags & TRACE_SP) *p++ = reg.SP;
+    if (flags & TRACE_PC) {
+        *p++ = reg.PC & 0xFF;
+        *p++ = reg.PC >> 8;
+    }
+    for (; delta >= 0x80; delta >>= 7) {
+        *p++ = (delta & 0x7F) | 0x80;
+    }
+    *p++ = delta;
+    raw_.resize(p - raw_.data());
+
+    prev_.reg = reg;
+    prev_.opcode = opcode;
+    prev_.cycles = cycles;
+    if (++count_ == chunk_instructions_) {
+        WriteChunk();
+    }
+}
+
+void TraceWriter::WriteChunk(void) {
+    if (count_ == 0) {
+        return;
+    }
+
+    compressed_.resize(LzCodec::Bound(raw_.size()));
+    size_t size = LzCodec::Compress(raw_.data(), raw_.size(), compressed_.data());
+
+    trace_index_entry entry;
+    entry.offset = file_.tellp();
+    entry.first_cycles = first_cycles_;
+    entry.last_cycles = prev_.cycles;
+    entry.instruction = instructions_;
+    entry.count = count_;
+    entry.reserved = 0;
+    index_.push_back(entry);
+
+    trace_chunk_hdr header;
+    header.first_cycles = entry.first_cycles;
+    header.last_cycles = entry.last_cycles;
+    header.instruction = entry.instruction;
+    header.count = count_;
+    header.raw_size = raw_.size();
+    header.size = size;
+    header.reserved = 0;
+    file_.write((const char*)&header, sizeof(header));
+    file_.write((const char*)compressed_.data(), size);
+
+    instructions_ += count_;
+    count_ = 0;
+    raw_.clear();
+}
+
+TraceReader::TraceReader() :
+    recovered_(false), monotonic_(true), first_cycles_(0), last_cycles_(0)
+{
+
+}
+
+bool TraceReader::Open(const char* filename) {
+    Close();
+
+    file_.open(filename, ios::in | ios::binary);
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    trace_hdr header;
+    file_.read((char*)&header, sizeof(header));
+    if (!file_ ||
+        memcmp(header.magic, trace_magic, sizeof(header.magic)) != 0 ||
+        header.version != TRACE_VERSION) {
+        file_.close();
+        return false;
+    }
+
+    if (!ReadIndex()) {
+        ScanChunks();
+        recovered_ = true;
+    }
+    UpdateRange();
+    return true;
+}
+
+void TraceReader::Close(void) {
+    if (file_.is_open()) {
+        file_.close();
+    }
+    index_.clear();
+    recovered_ = false;
+    UpdateRange();
+}
+
+bool TraceReader::ReadIndex(void) {
+    trace_footer footer;
+    file_.seekg(0, ios::end);
+    uint64_t end = file_.tellg();
+    if (end < sizeof(trace_hdr) + sizeof(footer)) {
+        return false;
+    }
+    file_.seekg(end - sizeof(footer));
+    file_.read((char*)&footer, sizeof(footer));
+    if (!file_ || memcmp(footer.magic, index_magic, sizeof(footer.magic)) != 0) {
+        file_.clear();
+        return false;
+    }
+    // a damaged footer must not size the index beyond what the file holds
+    end -= sizeof(footer);
+    if (footer.index_offset < sizeof(trace_hdr) || footer.index_offset > end ||
+        footer.chunk_count > (end - footer.index_offset) / sizeof(trace_index_entry)) {
+        return false;
+    }
+
+    index_.resize(footer.chunk_count);
+    file_.seekg(footer.index_offset);
+    file_.read((char*)index_.data(), index_.size() * sizeof(trace_index_entry));
+    if (!file_) {
+        file_.clear();
+        index_.clear();
+        return false;
+    }
+    return true;
+}
+
+void TraceReader::ScanChunks(void) {
+    file_.seekg(0, ios::end);
+    uint64_t end = file_.tellg();
+    uint64_t offset = sizeof(trace_hdr);
+
+    index_.clear();
+    while (offset + sizeof(trace_chunk_hdr) <= end) {
+        trace_chunk_hdr header;
+        file_.seekg(offset);
+        if (!file_.read((char*)&header, sizeof(header)) ||
+            header.count == 0 ||
+            offset + sizeof(header) + header.size > end) {
+            break;
+        }
+        trace_index_entry entry;
+        entry.offset = offset;
+        entry.first_cycles = header.first_cycles;
+        entry.last_cycles = header.last_cycles;
+        entry.instruction = header.instruction;
+        entry.count = header.count;
+        entry.reserved = 0;
+        index_.push_back(entry);
+        offset += sizeof(header) + header.size;
+    }
+    file_.clear();
+}
+
+void TraceReader::UpdateRange(void) {
+    monotonic_ = true;
+    first_cycles_ = index_.empty() ? 0 : index_.front().first_cycles;
+    last_cycles_ = index_.empty() ? 0 : index_.back().last_cycles;
+    for (size_t i = 1; i < index_.size(); i++) {
+        if (index_[i].first_cycles < index_[i - 1].last_cycles) {
+            monotonic_ = false;
+        }
+        first_cycles_ = min(first_cycles_, index_[i].first_cycles);
+        last_cycles_ = max(last_cycles_, index_[i].last_cycles);
+    }
+}
+
+uint64_t TraceReader::GetInstructionCount(void) const {
+    if (index_.empty()) {
+        return 0;
+    }
+    return index_.back().instruction + index_.back().count;
+}
+
+bool TraceReader::Read(uint64_t from_cycles, uint64_t to_cycles,
+                       vector<trace_record>* records) {
+    if (!monotonic_) {
+        // the index is one entry per chunk, so a scan is still cheap
+        for (const trace_index_entry& entry : index_) {
+            if (entry.last_cycles >= from_cycles && entry.first_cycles < to_cycles &&
+                !ReadChunk(entry, from_cycles, to_cycles, records)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // first chunk that ends at or after from_cycles
+    auto it = lower_bound(index_.begin(), index_.end(), from_cycles,
+        [](const trace_index_entry& entry, uint64_t cycles) {
+            return entry.last_cycles < cycles;
+        });
+    for (; it != index_.end() && it->first_cycles < to_cycles; ++it) {
+        if (!ReadChunk(*it, from_cycles, to_cycles, records)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TraceReader::ReadChunk(const trace_index_entry& entry, uint64_t from_cycles,
+                            uint64_t to_cycles, vector<trace_record>* records) {
+    trace_chunk_hdr header;
+    file_.seekg(entry.offset);
+    file_.read((char*)&header, sizeof(header));
+    if (!file_ || header.count != entry.count) {
+        file_.clear();
+        return false;
+    }
+    compressed_.resize(header.size);
+    raw_.resize(header.raw_size);
+    file_.read((char*)compressed_.data(), header.size);
+    if (!file_ ||
+        !LzCodec::Decompress(compressed_.data(), header.size, raw_.data(), header.raw_size)) {
+        file_.clear();
+        return false;
+    }
+
+    const uint8_t* p = raw_.data();
+    const uint8_t* end = p + raw_.size();
+    trace_record rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.cycles = header.first_cycles;
+    for (uint32_t i = 0; i < header.count; i++) {
+        // a record is at least flags, opcode and one varint byte
+        if (end - p < 3) {
+            return false;
+        }
+        uint8_t flags = *p++;
+        if (i == 0 && flags != TRACE_ALL) {
+            return false;
+        }
+        uint16_t next_pc = rec.reg.PC + OpcodeSize(rec.opcode);
+        rec.opcode = *p++;
+        int size = OpcodeSize(rec.opcode);
+        int bytes = (size > 1 ? size - 1 : 0) + __builtin_popcount(flags & 0x1F) +
+                    (flags & TRACE_PC ? 2 : 0);
+        if (end - p < bytes + 1) {
+            return false;
+        }
+        rec.operand = 0;
+        if (size > 1) {
+            rec.operand = *p++;
+        }
+        if (size > 2) {
+            rec.operand |= *p++ << 8;
+        }
+        if (flags & TRACE_A) rec.reg.A = *p++;
+        if (flags & TRACE_X) rec.reg.X = *p++;
+        if (flags & TRACE_Y) rec.reg.Y = *p++;
+        if (flags & TRACE_P) rec.reg.P = *p++;
+        if (flags & TRACE_SP) rec.reg.SP = *p++;
+        if (flags & TRACE_PC) {
+            rec.reg.PC = p[0] | (p[1] << 8);
+            p += 2;
+        } else {
+            rec.reg.PC = next_pc;
+        }
+        uint64_t delta = 0;
+        for (int shift = 0; ; shift += 7) {
+            if (p == end || shift > 63) {
+                return false;
+            }
+            uint8_t b = *p++;
+            delta |= (uint64_t)(b & 0x7F) << shift;
+            if (!(b & 0x80)) {
+                break;
+            }
+        }
+        rec.cycles += delta;
+
+        if (rec.cycles >= to_cycles) {
+            break;
+        }
+        if (rec.cycles >= from_cycles) {
+            records->push_back(rec);
+        }
+    }
+    return true;
+}
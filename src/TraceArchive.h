@@ -0,0 +1,139 @@
+#ifndef _TRACE_ARCHIVE_H
+#define _TRACE_ARCHIVE_H
+
+#include <cstdint>
+#include <fstream>
+#include <vector>
+#include "ITraceSink.h"
+
+#define TRACE_VERSION               1
+#define TRACE_CHUNK_INSTRUCTIONS    65536
+
+// File layout:
+//   trace_hdr
+//   chunk 0: trace_chunk_hdr, LzCodec-compressed records
+//   chunk 1: ...               (chunk_instructions records per chunk)
+//   trace_index_entry index[chunk_count]
+//   trace_footer
+// Records are deltas against the previous record of the same chunk: a flag
+// byte for the registers that changed and for a PC other than the
+// fall-through, the opcode, its operand bytes, the changed registers, and
+// the cycle delta as a varint. The first record of a chunk is complete, so
+// any chunk decodes on its own and a window of a multi-billion cycle run
+// costs one index lookup and the chunks it overlaps. Cycles only go up
+// within a chunk: when they go back, e.g. after Nes::LoadState, the writer
+// starts a new chunk.
+
+typedef struct {
+    uint8_t magic[4];           // 0x4E 0x54 0x52 0x1A ("NTR" followed by DOS EOF)
+    uint32_t version;
+    uint32_t chunk_instructions;
+    uint32_t reserved;
+} trace_hdr;
+
+typedef struct {
+    uint64_t first_cycles;      // cycles of the first and last record
+    uint64_t last_cycles;
+    uint64_t instruction;       // records before this chunk
+    uint32_t count;             // records in this chunk
+    uint32_t raw_size;          // decompressed size
+    uint32_t size;              // compressed size that follows
+    uint32_t reserved;
+} trace_chunk_hdr;
+
+typedef struct {
+    uint64_t offset;            // file offset of the trace_chunk_hdr
+    uint64_t first_cycles;
+    uint64_t last_cycles;
+    uint64_t instruction;
+    uint32_t count;
+    uint32_t reserved;
+} trace_index_entry;
+
+typedef struct {
+    uint64_t index_offset;
+    uint64_t chunk_count;
+    uint32_t reserved;
+    uint8_t magic[4];           // 0x4E 0x54 0x49 0x1A ("NTI" followed by DOS EOF)
+} trace_footer;
+
+typedef struct {
+    registers reg;
+    uint8_t opcode;
+    uint16_t operand;
+    uint64_t cycles;
+} trace_record;
+
+// Records the CPU trace (Nes::SetTraceSink) to an archive.
+class TraceWriter : public ITraceSink {
+public:
+    TraceWriter();
+    ~TraceWriter();
+
+    bool Open(const char* filename, uint32_t chunk_instructions=TRACE_CHUNK_INSTRUCTIONS);
+    // Writes the last chunk and the index. Returns false if any write failed.
+    bool Close(void);
+    bool IsOpen(void) const { return file_.is_open(); }
+    uint64_t GetInstructionCount(void) const { return instructions_ + count_; }
+
+    void OnInstruction(const registers& reg, uint8_t opcode, uint16_t operand,
+                       uint64_t cycles) override;
+
+private:
+    std::ofstream file_;
+    uint32_t chunk_instructions_;
+    uint64_t instructions_;     // records in written chunks
+    uint32_t count_;            // records in raw_
+    std::vector<uint8_t> raw_;
+    std::vector<uint8_t> compressed_;
+    std::vector<trace_index_entry> index_;
+    trace_record prev_;
+    uint64_t first_cycles_;
+
+    void WriteChunk(void);
+};
+
+// Random access to an archive. An archive without its index, e.g. from a
+// run that was killed, is indexed by walking the chunk headers instead and
+// reads up to the last complete chunk.
+class TraceReader {
+public:
+    TraceReader();
+    ~TraceReader() = default;
+
+    bool Open(const char* filename);
+    void Close(void);
+
+    // Appends the records of instructions starting in [from_cycles,
+    // to_cycles) to records. A window the run went through more than once
+    // (it loaded an earlier state) yields every pass in recording order.
+    // Returns false on a damaged chunk.
+    bool Read(uint64_t from_cycles, uint64_t to_cycles, std::vector<trace_record>* records);
+
+    uint64_t GetInstructionCount(void) const;
+    // lowest and highest cycle count recorded
+    uint64_t GetFirstCycles(void) const { return first_cycles_; }
+    uint64_t GetLastCycles(void) const { return last_cycles_; }
+    size_t GetChunkCount(void) const { return index_.size(); }
+    // True if the index was rebuilt from the chunks.
+    bool IsRecovered(void) const { return recovered_; }
+
+private:
+    std::ifstream file_;
+    std::vector<trace_index_entry> index_;
+    std::vector<uint8_t> raw_;
+    std::vector<uint8_t> compressed_;
+    bool recovered_;
+    // every chunk starts at or after the end of the one before
+    bool monotonic_;
+    uint64_t first_cycles_;
+    uint64_t last_cycles_;
+
+    bool ReadIndex(void);
+    void UpdateRange(void);
+    void ScanChunks(void);
+    bool ReadChunk(const trace_index_entry& entry, uint64_t from_cycles, uint64_t to_cycles,
+                   std::vector<trace_record>* records);
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef _TRIPLE_BUFFER_H
+#define _TRIPLE_BUFFER_H
+
+#include <atomic>
+
+// Lock-free handoff of the newest value from one producer thread to one
+// consumer thread. The producer fills the back buffer and publishes it; the
+// consumer takes the most recently published one. Neither side ever waits
+// for the other, so a slow consumer makes the producer overwrite frames
+// instead of stalling it.
+template<typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : back_(0), middle_(1), front_(2) {}
+    ~TripleBuffer() = default;
+
+    // producer side
+    T* GetBack(void) { return &buf_[back_]; }
+    // Returns true when the previous value was never taken.
+    bool Publish(void) {
+        unsigned old = middle_.exchange(back_ | FRESH, std::memory_order_acq_rel);
+        back_ = old & INDEX;
+        return (old & FRESH) != 0;
+    }
+
+    // consumer side
+    // Moves the newest published value to the front; false if there is none
+    // since the last call.
+    bool Acquire(void) {
+        if ((middle_.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+    const T* GetFront(void) const { return &buf_[front_]; }
+
+private:
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    static const unsigned INDEX = 3;
+    static const unsigned FRESH = 4;
+
+    unsigned back_;                 // producer only
+    std::atomic<unsigned> middle_;  // index of the published buffer, FRESH
+    T buf_[3];
+    unsigned front_;                // consumer only
+};
+
+#endif
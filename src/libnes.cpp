@@ -0,0 +1,83 @@
+#include "libnes.h"
+#include "Nes.h"
+
+static_assert(NES_PORTS == NUM_PORTS, "libnes.h out of date");
+static_assert(NES_RAM_SIZE == RAM_SIZE, "libnes.h out of date");
+static_assert(NES_FRAME_WIDTH == PPU_WIDTH && NES_FRAME_HEIGHT == PPU_HEIGHT,
+              "libnes.h out of date");
+
+// The handle is the Nes itself; the struct only gives it a C name (and
+// inherits its aligned operator new).
+struct nes_instance : public Nes {};
+
+static void Step(Nes* nes, const uint8_t* input, uint32_t frames) {
+    for (int port = 0; port < NUM_PORTS; port++) {
+        nes->SetInput(port, input[port]);
+    }
+    for (uint32_t i = 0; i < frames; i++) {
+        // input is set directly, not queued; keep the latch from replacing it
+        nes->RunFrame(true, false);
+    }
+}
+
+int nes_api_version(void) {
+    return NES_API_VERSION;
+}
+
+nes_instance* nes_create(void) {
+    nes_instance* inst = new nes_instance;
+    inst->PowerOn();
+    return inst;
+}
+
+void nes_destroy(nes_instance* nes) {
+    delete nes;
+}
+
+int nes_load_rom(nes_instance* nes, const char* filename) {
+    nes->PowerOn();
+    if (!nes->LoadRom(filename, SAVE_RAM_COPY)) {
+        return -1;
+    }
+    nes->Reset();
+    return 0;
+}
+
+void nes_reset(nes_instance* nes) {
+    nes->Reset();
+}
+
+void nes_step(nes_instance* nes, const uint8_t* input, uint32_t frames) {
+    Step(nes, input, frames);
+}
+
+void nes_step_many(nes_instance* const* instances, uint32_t count,
+                   const uint8_t* input, uint32_t frames) {
+    for (uint32_t i = 0; i < count; i++) {
+        Step(instances[i], input + i * NUM_PORTS, frames);
+    }
+}
+
+uint64_t nes_get_frame(const nes_instance* nes) {
+    return nes->GetFrame();
+}
+
+const uint8_t* nes_get_ram(const nes_instance* nes) {
+    return nes->GetRam();
+}
+
+const uint8_t* nes_get_frame_buffer(const nes_instance* nes) {
+    return nes->GetFrameBuffer();
+}
+
+size_t nes_state_size(void) {
+    return sizeof(nes_state);
+}
+
+void nes_save_state(const nes_instance* nes, void* state) {
+    nes->SaveState((nes_state*)state);
+}
+
+void nes_load_state(nes_instance* nes, const void* state) {
+    nes->LoadState((const nes_state*)state);
+}
@@ -0,0 +1,67 @@
+#ifndef _LIBNES_H
+#define _LIBNES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// C ABI of the shared library (libnes.so), for FFI callers such as ctypes
+// or cffi. Instances are opaque; every call takes the instance it works
+// on, and different instances may be used from different threads.
+//
+// Buffers returned by nes_get_ram and nes_get_frame_buffer are the live
+// emulator memory, not copies: they stay valid, at the same address, until
+// nes_destroy, and reflect each step as soon as it returns. Until the PPU
+// renders, every instance returns the same read-only blank frame.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+#define NES_API __declspec(dllexport)
+#else
+#define NES_API __attribute__((visibility("default")))
+#endif
+
+// Bumped on incompatible changes to this header.
+#define NES_API_VERSION     1
+
+#define NES_PORTS           2       // input bytes per frame
+#define NES_RAM_SIZE        0x800
+#define NES_FRAME_WIDTH     256
+#define NES_FRAME_HEIGHT    240     // one palette index per pixel
+
+typedef struct nes_instance nes_instance;
+
+NES_API int nes_api_version(void);
+
+NES_API nes_instance* nes_create(void);
+NES_API void nes_destroy(nes_instance* nes);
+
+// Loads, powers on and resets. Returns 0, or -1 if the file isn't a ROM.
+// Battery RAM starts from the .sav file but is never written back.
+NES_API int nes_load_rom(nes_instance* nes, const char* filename);
+NES_API void nes_reset(nes_instance* nes);
+
+// Runs frames with input (NES_PORTS controller bytes) held throughout.
+NES_API void nes_step(nes_instance* nes, const uint8_t* input, uint32_t frames);
+// nes_step for count instances in one call; input holds NES_PORTS bytes
+// per instance.
+NES_API void nes_step_many(nes_instance* const* instances, uint32_t count,
+                           const uint8_t* input, uint32_t frames);
+
+NES_API uint64_t nes_get_frame(const nes_instance* nes);
+NES_API const uint8_t* nes_get_ram(const nes_instance* nes);
+NES_API const uint8_t* nes_get_frame_buffer(const nes_instance* nes);
+
+// Save states are opaque blobs of nes_state_size() bytes, valid for the
+// same library build.
+NES_API size_t nes_state_size(void);
+NES_API void nes_save_state(const nes_instance* nes, void* state);
+NES_API void nes_load_state(nes_instance* nes, const void* state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,5 +1,441 @@
 #ifndef OPCODE_H
 #define OPCODE_H
 
+#include <cstdint>
+#include "Cpu.h"
+
+// Decode tables shared by Cpu and CycleCpu, generated at compile time from
+// opcode_descs. Cpu::Step only touches hot_opcodes (4 bytes per opcode, 1 KB
+// in all); mnemonics live in the cold opcode_names table, read by tracing
+// and the analysis tools. CycleCpu also reads opcode_kinds to pick a bus
+// cycle sequence.
+
+#define OPC_CYCLES_MASK     0x0F
+#define OPC_PENALTY_SHIFT   4
+
+typedef struct {
+    uint8_t code;
+    Cpu::opcode op;
+    Cpu::addr_mode mode;
+    uint8_t cycles;
+    uint8_t pagecrossed_cycles;
+} opcode_desc;
+
+typedef struct {
+    uint8_t op;         // Cpu::opcode
+    uint8_t mode;       // Cpu::addr_mode
+    uint8_t size;       // 0 for invalid opcodes
+    uint8_t cycles;     // base cycles, page-cross penalty above OPC_PENALTY_SHIFT
+} opcode_hot;
+
+typedef struct {
+    opcode_hot entries[256];
+} opcode_hot_table;
+
+#define OPC(code, op, mode, cycles, penalty) \
+    { code, Cpu::OP_##op, Cpu::MODE_##mode, cycles, penalty }
+
+constexpr opcode_desc opcode_descs[256] = {
+    OPC(0x00, BRK,     IMPLIED,             7, 0),
+    OPC(0x01, ORA,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0x02, INVALID, INVALID,             0, 0),
+    OPC(0x03, SLO,     X_INDEXED_INDIRECT,  8, 0),
+    OPC(0x04, NOP,     ZEROPAGE,            3, 0),
+    OPC(0x05, ORA,     ZEROPAGE,            3, 0),
+    OPC(0x06, ASL,     ZEROPAGE,            5, 0),
+    OPC(0x07, SLO,     ZEROPAGE,            5, 0),
+    OPC(0x08, PHP,     IMPLIED,             3, 0),
+    OPC(0x09, ORA,     IMMEDIATE,           2, 0),
+    OPC(0x0A, ASL,     ACCUMULATOR,         2, 0),
+    OPC(0x0B, INVALID, INVALID,             0, 0),
+    OPC(0x0C, NOP,     ABSOLUTE,            4, 0),
+    OPC(0x0D, ORA,     ABSOLUTE,            4, 0),
+    OPC(0x0E, ASL,     ABSOLUTE,            6, 0),
+    OPC(0x0F, SLO,     ABSOLUTE,            6, 0),
+
+    OPC(0x10, BPL,     RELATIVE,            2, 1),
+    OPC(0x11, ORA,     INDIRECT_Y_INDEXED,  5, 1),
+    OPC(0x12, INVALID, INVALID,             0, 0),
+    OPC(0x13, SLO,     INDIRECT_Y_INDEXED,  8, 0),
+    OPC(0x14, NOP,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x15, ORA,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x16, ASL,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0x17, SLO,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0x18, CLC,     IMPLIED,             2, 0),
+    OPC(0x19, ORA,     ABSOLUTE_Y_INDEXED,  4, 1),
+    OPC(0x1A, NOP,     IMPLIED,             2, 0),
+    OPC(0x1B, SLO,     ABSOLUTE_Y_INDEXED,  7, 0),
+    OPC(0x1C, NOP,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0x1D, ORA,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0x1E, ASL,     ABSOLUTE_X_INDEXED,  7, 0),
+    OPC(0x1F, SLO,     ABSOLUTE_X_INDEXED,  7, 0),
+
+    OPC(0x20, JSR,     ABSOLUTE,            6, 0),
+    OPC(0x21, AND,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0x22, INVALID, INVALID,             0, 0),
+    OPC(0x23, RLA,     X_INDEXED_INDIRECT,  8, 0),
+    OPC(0x24, BIT,     ZEROPAGE,            3, 0),
+    OPC(0x25, AND,     ZEROPAGE,            3, 0),
+    OPC(0x26, ROL,     ZEROPAGE,            5, 0),
+    OPC(0x27, RLA,     ZEROPAGE,            5, 0),
+    OPC(0x28, PLP,     IMPLIED,             4, 0),
+    OPC(0x29, AND,     IMMEDIATE,           2, 0),
+    OPC(0x2A, ROL,     ACCUMULATOR,         2, 0),
+    OPC(0x2B, INVALID, INVALID,             0, 0),
+    OPC(0x2C, BIT,     ABSOLUTE,            4, 0),
+    OPC(0x2D, AND,     ABSOLUTE,            4, 0),
+    OPC(0x2E, ROL,     ABSOLUTE,            6, 0),
+    OPC(0x2F, RLA,     ABSOLUTE,            6, 0),
+
+    OPC(0x30, BMI,     RELATIVE,            2, 1),
+    OPC(0x31, AND,     INDIRECT_Y_INDEXED,  5, 1),
+    OPC(0x32, INVALID, INVALID,             0, 0),
+    OPC(0x33, RLA,     INDIRECT_Y_INDEXED,  8, 0),
+    OPC(0x34, NOP,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x35, AND,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x36, ROL,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0x37, RLA,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0x38, SEC,     IMPLIED,             2, 0),
+    OPC(0x39, AND,     ABSOLUTE_Y_INDEXED,  4, 1),
+    OPC(0x3A, NOP,     IMPLIED,             2, 0),
+    OPC(0x3B, RLA,     ABSOLUTE_Y_INDEXED,  7, 0),
+    OPC(0x3C, NOP,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0x3D, AND,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0x3E, ROL,     ABSOLUTE_X_INDEXED,  7, 0),
+    OPC(0x3F, RLA,     ABSOLUTE_X_INDEXED,  7, 0),
+
+    OPC(0x40, RTI,     IMPLIED,             6, 0),
+    OPC(0x41, EOR,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0x42, INVALID, INVALID,             0, 0),
+    OPC(0x43, SRE,     X_INDEXED_INDIRECT,  8, 0),
+    OPC(0x44, NOP,     ZEROPAGE,            3, 0),
+    OPC(0x45, EOR,     ZEROPAGE,            3, 0),
+    OPC(0x46, LSR,     ZEROPAGE,            5, 0),
+    OPC(0x47, SRE,     ZEROPAGE,            5, 0),
+    OPC(0x48, PHA,     IMPLIED,             3, 0),
+    OPC(0x49, EOR,     IMMEDIATE,           2, 0),
+    OPC(0x4A, LSR,     ACCUMULATOR,         2, 0),
+    OPC(0x4B, INVALID, INVALID,             0, 0),
+    OPC(0x4C, JMP,     ABSOLUTE,            3, 0),
+    OPC(0x4D, EOR,     ABSOLUTE,            4, 0),
+    OPC(0x4E, LSR,     ABSOLUTE,            6, 0),
+    OPC(0x4F, SRE,     ABSOLUTE,            6, 0),
+
+    OPC(0x50, BVC,     RELATIVE,            2, 1),
+    OPC(0x51, EOR,     INDIRECT_Y_INDEXED,  5, 1),
+    OPC(0x52, INVALID, INVALID,             0, 0),
+    OPC(0x53, SRE,     INDIRECT_Y_INDEXED,  8, 0),
+    OPC(0x54, NOP,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x55, EOR,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x56, LSR,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0x57, SRE,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0x58, CLI,     IMPLIED,             2, 0),
+    OPC(0x59, EOR,     ABSOLUTE_Y_INDEXED,  4, 1),
+    OPC(0x5A, NOP,     IMPLIED,             2, 0),
+    OPC(0x5B, SRE,     ABSOLUTE_Y_INDEXED,  7, 0),
+    OPC(0x5C, NOP,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0x5D, EOR,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0x5E, LSR,     ABSOLUTE_X_INDEXED,  7, 0),
+    OPC(0x5F, SRE,     ABSOLUTE_X_INDEXED,  7, 0),
+
+    OPC(0x60, RTS,     IMPLIED,             6, 0),
+    OPC(0x61, ADC,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0x62, INVALID, INVALID,             0, 0),
+    OPC(0x63, RRA,     X_INDEXED_INDIRECT,  8, 0),
+    OPC(0x64, NOP,     ZEROPAGE,            3, 0),
+    OPC(0x65, ADC,     ZEROPAGE,            3, 0),
+    OPC(0x66, ROR,     ZEROPAGE,            5, 0),
+    OPC(0x67, RRA,     ZEROPAGE,            5, 0),
+    OPC(0x68, PLA,     IMPLIED,             4, 0),
+    OPC(0x69, ADC,     IMMEDIATE,           2, 0),
+    OPC(0x6A, ROR,     ACCUMULATOR,         2, 0),
+    OPC(0x6B, INVALID, INVALID,             0, 0),
+    OPC(0x6C, JMP,     INDIRECT,            5, 0),
+    OPC(0x6D, ADC,     ABSOLUTE,            4, 0),
+    OPC(0x6E, ROR,     ABSOLUTE,            6, 0),
+    OPC(0x6F, RRA,     ABSOLUTE,            6, 0),
+
+    OPC(0x70, BVS,     RELATIVE,            2, 1),
+    OPC(0x71, ADC,     INDIRECT_Y_INDEXED,  5, 1),
+    OPC(0x72, INVALID, INVALID,             0, 0),
+    OPC(0x73, RRA,     INDIRECT_Y_INDEXED,  8, 0),
+    OPC(0x74, NOP,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x75, ADC,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x76, ROR,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0x77, RRA,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0x78, SEI,     IMPLIED,             2, 0),
+    OPC(0x79, ADC,     ABSOLUTE_Y_INDEXED,  4, 1),
+    OPC(0x7A, NOP,     IMPLIED,             2, 0),
+    OPC(0x7B, RRA,     ABSOLUTE_Y_INDEXED,  7, 0),
+    OPC(0x7C, NOP,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0x7D, ADC,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0x7E, ROR,     ABSOLUTE_X_INDEXED,  7, 0),
+    OPC(0x7F, RRA,     ABSOLUTE_X_INDEXED,  7, 0),
+
+    OPC(0x80, NOP,     IMMEDIATE,           2, 0),
+    OPC(0x81, STA,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0x82, NOP,     IMMEDIATE,           2, 0),
+    OPC(0x83, SAX,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0x84, STY,     ZEROPAGE,            3, 0),
+    OPC(0x85, STA,     ZEROPAGE,            3, 0),
+    OPC(0x86, STX,     ZEROPAGE,            3, 0),
+    OPC(0x87, SAX,     ZEROPAGE,            3, 0),
+    OPC(0x88, DEY,     IMPLIED,             2, 0),
+    OPC(0x89, NOP,     IMMEDIATE,           2, 0),
+    OPC(0x8A, TXA,     IMPLIED,             2, 0),
+    OPC(0x8B, INVALID, INVALID,             0, 0),
+    OPC(0x8C, STY,     ABSOLUTE,            4, 0),
+    OPC(0x8D, STA,     ABSOLUTE,            4, 0),
+    OPC(0x8E, STX,     ABSOLUTE,            4, 0),
+    OPC(0x8F, SAX,     ABSOLUTE,            4, 0),
+
+    OPC(0x90, BCC,     RELATIVE,            2, 1),
+    OPC(0x91, STA,     INDIRECT_Y_INDEXED,  6, 0),
+    OPC(0x92, INVALID, INVALID,             0, 0),
+    OPC(0x93, INVALID, INVALID,             0, 0),
+    OPC(0x94, STY,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x95, STA,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0x96, STX,     ZEROPAGE_Y_INDEXED,  4, 0),
+    OPC(0x97, SAX,     ZEROPAGE_Y_INDEXED,  4, 0),
+    OPC(0x98, TYA,     IMPLIED,             2, 0),
+    OPC(0x99, STA,     ABSOLUTE_Y_INDEXED,  5, 0),
+    OPC(0x9A, TXS,     IMPLIED,             2, 0),
+    OPC(0x9B, INVALID, INVALID,             0, 0),
+    OPC(0x9C, INVALID, INVALID,             0, 0),
+    OPC(0x9D, STA,     ABSOLUTE_X_INDEXED,  5, 0),
+    OPC(0x9E, INVALID, INVALID,             0, 0),
+    OPC(0x9F, INVALID, INVALID,             0, 0),
+
+    OPC(0xA0, LDY,     IMMEDIATE,           2, 0),
+    OPC(0xA1, LDA,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0xA2, LDX,     IMMEDIATE,           2, 0),
+    OPC(0xA3, LAX,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0xA4, LDY,     ZEROPAGE,            3, 0),
+    OPC(0xA5, LDA,     ZEROPAGE,            3, 0),
+    OPC(0xA6, LDX,     ZEROPAGE,            3, 0),
+    OPC(0xA7, LAX,     ZEROPAGE,            3, 0),
+    OPC(0xA8, TAY,     IMPLIED,             2, 0),
+    OPC(0xA9, LDA,     IMMEDIATE,           2, 0),
+    OPC(0xAA, TAX,     IMPLIED,             2, 0),
+    OPC(0xAB, INVALID, INVALID,             0, 0),
+    OPC(0xAC, LDY,     ABSOLUTE,            4, 0),
+    OPC(0xAD, LDA,     ABSOLUTE,            4, 0),
+    OPC(0xAE, LDX,     ABSOLUTE,            4, 0),
+    OPC(0xAF, LAX,     ABSOLUTE,            4, 0),
+
+    OPC(0xB0, BCS,     RELATIVE,            2, 1),
+    OPC(0xB1, LDA,     INDIRECT_Y_INDEXED,  5, 1),
+    OPC(0xB2, INVALID, INVALID,             0, 0),
+    OPC(0xB3, LAX,     INDIRECT_Y_INDEXED,  5, 1),
+    OPC(0xB4, LDY,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0xB5, LDA,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0xB6, LDX,     ZEROPAGE_Y_INDEXED,  4, 0),
+    OPC(0xB7, LAX,     ZEROPAGE_Y_INDEXED,  4, 0),
+    OPC(0xB8, CLV,     IMPLIED,             2, 0),
+    OPC(0xB9, LDA,     ABSOLUTE_Y_INDEXED,  4, 1),
+    OPC(0xBA, TSX,     IMPLIED,             2, 0),
+    OPC(0xBB, INVALID, INVALID,             0, 0),
+    OPC(0xBC, LDY,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0xBD, LDA,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0xBE, LDX,     ABSOLUTE_Y_INDEXED,  4, 1),
+    OPC(0xBF, LAX,     ABSOLUTE_Y_INDEXED,  4, 1),
+
+    OPC(0xC0, CPY,     IMMEDIATE,           2, 0),
+    OPC(0xC1, CMP,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0xC2, NOP,     IMMEDIATE,           2, 0),
+    OPC(0xC3, DCP,     X_INDEXED_INDIRECT,  8, 0),
+    OPC(0xC4, CPY,     ZEROPAGE,            3, 0),
+    OPC(0xC5, CMP,     ZEROPAGE,            3, 0),
+    OPC(0xC6, DEC,     ZEROPAGE,            5, 0),
+    OPC(0xC7, DCP,     ZEROPAGE,            5, 0),
+    OPC(0xC8, INY,     IMPLIED,             2, 0),
+    OPC(0xC9, CMP,     IMMEDIATE,           2, 0),
+    OPC(0xCA, DEX,     IMPLIED,             2, 0),
+    OPC(0xCB, INVALID, INVALID,             0, 0),
+    OPC(0xCC, CPY,     ABSOLUTE,            4, 0),
+    OPC(0xCD, CMP,     ABSOLUTE,            4, 0),
+    OPC(0xCE, DEC,     ABSOLUTE,            6, 0),
+    OPC(0xCF, DCP,     ABSOLUTE,            6, 0),
+
+    OPC(0xD0, BNE,     RELATIVE,            2, 1),
+    OPC(0xD1, CMP,     INDIRECT_Y_INDEXED,  5, 1),
+    OPC(0xD2, INVALID, INVALID,             0, 0),
+    OPC(0xD3, DCP,     INDIRECT_Y_INDEXED,  8, 0),
+    OPC(0xD4, NOP,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0xD5, CMP,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0xD6, DEC,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0xD7, DCP,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0xD8, CLD,     IMPLIED,             2, 0),
+    OPC(0xD9, CMP,     ABSOLUTE_Y_INDEXED,  4, 1),
+    OPC(0xDA, NOP,     IMPLIED,             2, 0),
+    OPC(0xDB, DCP,     ABSOLUTE_Y_INDEXED,  7, 0),
+    OPC(0xDC, NOP,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0xDD, CMP,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0xDE, DEC,     ABSOLUTE_X_INDEXED,  7, 0),
+    OPC(0xDF, DCP,     ABSOLUTE_X_INDEXED,  7, 0),
+
+    OPC(0xE0, CPX,     IMMEDIATE,           2, 0),
+    OPC(0xE1, SBC,     X_INDEXED_INDIRECT,  6, 0),
+    OPC(0xE2, NOP,     IMMEDIATE,           2, 0),
+    OPC(0xE3, ISB,     X_INDEXED_INDIRECT,  8, 0),
+    OPC(0xE4, CPX,     ZEROPAGE,            3, 0),
+    OPC(0xE5, SBC,     ZEROPAGE,            3, 0),
+    OPC(0xE6, INC,     ZEROPAGE,            5, 0),
+    OPC(0xE7, ISB,     ZEROPAGE,            5, 0),
+    OPC(0xE8, INX,     IMPLIED,             2, 0),
+    OPC(0xE9, SBC,     IMMEDIATE,           2, 0),
+    OPC(0xEA, NOP,     IMPLIED,             2, 0),
+    OPC(0xEB, SBC,     IMMEDIATE,           2, 0),
+    OPC(0xEC, CPX,     ABSOLUTE,            4, 0),
+    OPC(0xED, SBC,     ABSOLUTE,            4, 0),
+    OPC(0xEE, INC,     ABSOLUTE,            6, 0),
+    OPC(0xEF, ISB,     ABSOLUTE,            6, 0),
+
+    OPC(0xF0, BEQ,     RELATIVE,            2, 1),
+    OPC(0xF1, SBC,     INDIRECT_Y_INDEXED,  5, 1),
+    OPC(0xF2, INVALID, INVALID,             0, 0),
+    OPC(0xF3, ISB,     INDIRECT_Y_INDEXED,  8, 0),
+    OPC(0xF4, NOP,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0xF5, SBC,     ZEROPAGE_X_INDEXED,  4, 0),
+    OPC(0xF6, INC,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0xF7, ISB,     ZEROPAGE_X_INDEXED,  6, 0),
+    OPC(0xF8, SED,     IMPLIED,             2, 0),
+    OPC(0xF9, SBC,     ABSOLUTE_Y_INDEXED,  4, 1),
+    OPC(0xFA, NOP,     IMPLIED,             2, 0),
+    OPC(0xFB, ISB,     ABSOLUTE_Y_INDEXED,  7, 0),
+    OPC(0xFC, NOP,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0xFD, SBC,     ABSOLUTE_X_INDEXED,  4, 1),
+    OPC(0xFE, INC,     ABSOLUTE_X_INDEXED,  7, 0),
+    OPC(0xFF, ISB,     ABSOLUTE_X_INDEXED,  7, 0)
+};
+
+#undef OPC
+
+// Indexed by Cpu::opcode.
+constexpr const char* opcode_names[] = {
+    "INVALID OPCODE", "ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BIT", "BMI",
+    "BNE", "BPL", "BRK", "BVC", "BVS", "CLC", "CLD", "CLI", "CLV", "CMP", "CPX",
+    "CPY", "DCP", "DEC", "DEX", "DEY", "EOR", "INC", "INX", "INY", "ISB", "JMP",
+    "JSR", "LAX", "LDA", "LDX", "LDY", "LSR", "NOP", "ORA", "PHA", "PHP", "PLA",
+    "PLP", "RLA", "ROL", "ROR", "RRA", "RTI", "RTS", "SAX", "SBC", "SEC", "SED",
+    "SEI", "SLO", "SRE", "STA", "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS",
+    "TYA"
+};
+
+// Bus cycle pattern of an instruction, beyond what its addressing mode
+// gives.
+enum opcode_kind {
+    KIND_READ,          // also implied/accumulator instructions
+    KIND_WRITE,
+    KIND_RMW,
+    KIND_BRANCH,
+    KIND_JMP,
+    KIND_JSR,
+    KIND_RTS,
+    KIND_RTI,
+    KIND_BRK,
+    KIND_PUSH,
+    KIND_PULL,
+    KIND_JAM
+};
+
+// Indexed by Cpu::opcode.
+constexpr uint8_t opcode_kinds[] = {
+    KIND_JAM,
+    KIND_READ, KIND_READ, KIND_RMW,                                         // ADC AND ASL
+    KIND_BRANCH, KIND_BRANCH, KIND_BRANCH, KIND_READ, KIND_BRANCH,          // BCC BCS BEQ BIT BMI
+    KIND_BRANCH, KIND_BRANCH, KIND_BRK, KIND_BRANCH, KIND_BRANCH,           // BNE BPL BRK BVC BVS
+    KIND_READ, KIND_READ, KIND_READ, KIND_READ, KIND_READ, KIND_READ,       // CLC CLD CLI CLV CMP CPX
+    KIND_READ,                                                              // CPY
+    KIND_RMW, KIND_RMW, KIND_READ, KIND_READ,                               // DCP DEC DEX DEY
+    KIND_READ, KIND_RMW, KIND_READ, KIND_READ, KIND_RMW,                    // EOR INC INX INY ISB
+    KIND_JMP, KIND_JSR,                                                     // JMP JSR
+    KIND_READ, KIND_READ, KIND_READ, KIND_READ, KIND_RMW,                   // LAX LDA LDX LDY LSR
+    KIND_READ,                                                              // NOP
+    KIND_READ,                                                              // ORA
+    KIND_PUSH, KIND_PUSH, KIND_PULL, KIND_PULL,                             // PHA PHP PLA PLP
+    KIND_RMW, KIND_RMW, KIND_RMW, KIND_RMW, KIND_RTI, KIND_RTS,             // RLA ROL ROR RRA RTI RTS
+    KIND_WRITE, KIND_READ, KIND_READ, KIND_READ, KIND_READ, KIND_RMW,       // SAX SBC SEC SED SEI SLO
+    KIND_RMW, KIND_WRITE, KIND_WRITE, KIND_WRITE,                           // SRE STA STX STY
+    KIND_READ, KIND_READ, KIND_READ, KIND_READ, KIND_READ, KIND_READ        // TAX TAY TSX TXA TXS TYA
+};
+
+constexpr uint8_t OpcodeSize(Cpu::addr_mode mode) {
+    switch (mode) {
+        case Cpu::MODE_INVALID:
+            return 0;
+        case Cpu::MODE_ACCUMULATOR:
+        case Cpu::MODE_IMPLIED:
+            return 1;
+        case Cpu::MODE_ABSOLUTE:
+        case Cpu::MODE_ABSOLUTE_X_INDEXED:
+        case Cpu::MODE_ABSOLUTE_Y_INDEXED:
+        case Cpu::MODE_INDIRECT:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+// Only indexed reads and branches pay for a page crossing.
+constexpr bool HasPenalty(Cpu::addr_mode mode) {
+    return mode == Cpu::MODE_ABSOLUTE_X_INDEXED || mode == Cpu::MODE_ABSOLUTE_Y_INDEXED ||
+           mode == Cpu::MODE_INDIRECT_Y_INDEXED || mode == Cpu::MODE_RELATIVE;
+}
+
+constexpr bool CheckOpcodeDescs(void) {
+    for (int i = 0; i < 256; i++) {
+        const opcode_desc& d = opcode_descs[i];
+        if (d.code != i) {
+            return false;
+        }
+        if ((d.op == Cpu::OP_INVALID) != (d.mode == Cpu::MODE_INVALID)) {
+            return false;
+        }
+        if (d.op != Cpu::OP_INVALID && (d.cycles < 2 || d.cycles > 8)) {
+            return false;
+        }
+        if (d.pagecrossed_cycles > 1 || (d.pagecrossed_cycles && !HasPenalty(d.mode))) {
+            return false;
+        }
+        // CycleCpu skips the fixup cycle for exactly these: indexed reads
+        if (HasPenalty(d.mode) && d.mode != Cpu::MODE_RELATIVE &&
+            (d.pagecrossed_cycles != 0) != (opcode_kinds[d.op] == KIND_READ)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr opcode_hot_table MakeOpcodeHotTable(void) {
+    opcode_hot_table table = {};
+    for (int i = 0; i < 256; i++) {
+        const opcode_desc& d = opcode_descs[i];
+        opcode_hot& hot = table.entries[i];
+        hot.op = d.op;
+        hot.mode = d.mode;
+        hot.size = OpcodeSize(d.mode);
+        hot.cycles = d.cycles | (d.pagecrossed_cycles << OPC_PENALTY_SHIFT);
+    }
+    return table;
+}
+
+constexpr opcode_hot_table hot_opcodes = MakeOpcodeHotTable();
+
+static_assert(sizeof(opcode_hot) == 4, "hot decode entries must stay 4 bytes");
+static_assert(sizeof(opcode_names) / sizeof(opcode_names[0]) == Cpu::OP_TYA + 1,
+              "one name per Cpu::opcode");
+static_assert(sizeof(opcode_kinds) == Cpu::OP_TYA + 1, "one kind per Cpu::opcode");
+static_assert(opcode_kinds[Cpu::OP_SAX] == KIND_WRITE && opcode_kinds[Cpu::OP_STY] == KIND_WRITE &&
+              opcode_kinds[Cpu::OP_SRE] == KIND_RMW && opcode_kinds[Cpu::OP_TYA] == KIND_READ,
+              "opcode_kinds out of step with Cpu::opcode");
+static_assert(Cpu::OP_TYA <= 0xFF && Cpu::MODE_ZEROPAGE_Y_INDEXED <= 0xFF,
+              "opcode and mode must fit in a byte");
+static_assert(CheckOpcodeDescs(), "opcode_descs out of order or inconsistent");
+static_assert(hot_opcodes.entries[0x4C].op == Cpu::OP_JMP && hot_opcodes.entries[0x4C].size == 3,
+              "JMP abs");
+static_assert(hot_opcodes.entries[0xB1].cycles == (5 | (1 << OPC_PENALTY_SHIFT)),
+              "LDA (zp),Y");
+static_assert(hot_opcodes.entries[0x02].size == 0, "invalid opcodes don't advance PC");
 
 #endif
@@ -0,0 +1,436 @@
+#include "CpuFuzzer.h"
+#include "Disassembler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+using namespace std;
+
+FuzzMemory::FuzzMemory() :
+    seed_(0), count_(0), writes_(0)
+{
+
+}
+
+uint8_t FuzzMemory::Hash(uint64_t seed, uint16_t addr) {
+    uint64_t z = seed + (addr + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return (z ^ (z >> 31)) & 0xFF;
+}
+
+void FuzzMemory::Reset(uint64_t seed) {
+    seed_ = seed;
+    count_ = 0;
+    writes_ = 0;
+}
+
+void FuzzMemory::Poke(uint16_t addr, uint8_t data) {
+    for (int i = 0; i < count_; i++) {
+        if (overrides_[i].addr == addr) {
+            overrides_[i].data = data;
+            return;
+        }
+    }
+    if (count_ < FUZZ_MAX_BYTES + FUZZ_MAX_WRITES) {
+        overrides_[count_].addr = addr;
+        overrides_[count_].data = data;
+        count_++;
+    }
+}
+
+uint8_t FuzzMemory::Read8(uint16_t addr) {
+    for (int i = 0; i < count_; i++) {
+        if (overrides_[i].addr == addr) {
+            return overrides_[i].data;
+        }
+    }
+    return Hash(seed_, addr);
+}
+
+void FuzzMemory::Write8(uint16_t addr, uint8_t data) {
+    if (writes_ < FUZZ_MAX_WRITES) {
+        written_[writes_++] = addr;
+    }
+    Poke(addr, data);
+}
+
+CpuFuzzer::CpuFuzzer(uint64_t seed, bool cycle_core) :
+    debugger_(nullptr), mmu_(nullptr, &debugger_), cpu_(nullptr, &mmu_, &debugger_),
+    cycle_cpu_(&cpu_, &mmu_, &debugger_), cycle_core_(cycle_core), ref_(&ref_memory_), rng_(seed), batch_seed_(0), batch_count_(0), ram_seed_(0),
+    instructions_(0)
+{
+    mmu_.AddMemoryMap(&cpu_memory_, 0x2000, 0xFFFF);
+    cpu_.SetTraceEnabled(false);
+    memset(coverage_, 0, sizeof(coverage_));
+    memset(ram_, 0, sizeof(ram_));
+}
+
+const vector<uint8_t>& CpuFuzzer::GetOpcodes(void) {
+    static const vector<uint8_t> opcodes = [] {
+        vector<uint8_t> v;
+        for (int op = 0; op < 256; op++) {
+            if (RefCpu::IsSupported(op)) {
+                v.push_back(op);
+            }
+        }
+        return v;
+    }();
+    return opcodes;
+}
+
+uint64_t CpuFuzzer::Next(void) {
+    // splitmix64
+    uint64_t z = (rng_ += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+void CpuFuzzer::Generate(fuzz_case* c) {
+    const vector<uint8_t>& opcodes = GetOpcodes();
+    if (batch_count_++ % FUZZ_BATCH == 0) {
+        batch_seed_ = Next();
+    }
+    c->seed = batch_seed_;
+
+    uint64_t r = Next();
+    c->reg.A = r;
+    c->reg.X = r >> 8;
+    c->reg.Y = r >> 16;
+    c->reg.SP = r >> 24;
+    c->reg.P = ((r >> 32) | 0x20) & ~0x10;
+    c->reg.PC = r >> 40;
+
+    int insns = 1 + Next() % FUZZ_MAX_INSNS;
+    c->size = 0;
+    for (int i = 0; i < insns; i++) {
+        r = Next();
+        uint8_t opcode = opcodes[r % opcodes.size()];
+        int size = RefCpu::Size(opcode);
+        c->program[c->size] = opcode;
+        c->program[c->size + 1] = r >> 16;
+        c->program[c->size + 2] = r >> 24;
+        if (size == 3 && (r & (1ull << 32))) {
+            c->program[c->size + 2] &= 0x07;    // hit internal RAM half the time
+        }
+        c->size += size;
+    }
+    c->steps = insns;
+}
+
+void CpuFuzzer::Setup(const fuzz_case& c) {
+    if (c.seed != ram_seed_) {
+        for (int i = 0; i < RAM_SIZE; i++) {
+            ram_[i] = FuzzMemory::Hash(~c.seed, i);
+        }
+        ram_seed_ = c.seed;
+    }
+
+    mmu_state ram;
+    memcpy(ram.ram, ram_, sizeof(ram.ram));
+    cpu_memory_.Reset(c.seed);
+    ref_memory_.Reset(c.seed);
+    for (int i = 0; i < c.size; i++) {
+        uint16_t addr = c.reg.PC + i;
+        if (addr < 0x2000) {
+            ram.ram[addr & (RAM_SIZE - 1)] = c.program[i];
+        } else {
+            cpu_memory_.Poke(addr, c.program[i]);
+            ref_memory_.Poke(addr, c.program[i]);
+        }
+    }
+
+    cpu_state state;
+    state.reg = c.reg;
+    state.cycles = 0;
+    mmu_.LoadState(&ram);
+    cpu_.LoadState(&state);
+    cycle_cpu_.Reset();
+    ref_.Load(c.reg, ram.ram);
+}
+
+bool CpuFuzzer::Compare(bool memory, string* diff) {
+    const registers& a = ref_.GetRegisters();
+    cpu_state state;
+    cpu_.SaveState(&state);
+    const registers& b = state.reg;
+
+    bool same = a.A == b.A && a.X == b.X && a.Y == b.Y && a.SP == b.SP &&
+                a.P == b.P && a.PC == b.PC && ref_.GetCycles() == state.cycles;
+    if (!same && diff != nullptr) {
+        stringstream ss;
+        ss << hex << uppercase << setfill('0');
+        ss << "  expected A:" << setw(2) << (int)a.A << " X:" << setw(2) << (int)a.X
+           << " Y:" << setw(2) << (int)a.Y << " P:" << setw(2) << (int)a.P
+           << " SP:" << setw(2) << (int)a.SP << " PC:" << setw(4) << a.PC
+           << " CYC:" << dec << ref_.GetCycles() << "\n" << hex;
+        ss << "  actual   A:" << setw(2) << (int)b.A << " X:" << setw(2) << (int)b.X
+           << " Y:" << setw(2) << (int)b.Y << " P:" << setw(2) << (int)b.P
+           << " SP:" << setw(2) << (int)b.SP << " PC:" << setw(4) << b.PC
+           << " CYC:" << dec << state.cycles << "\n";
+        *diff += ss.str();
+    }
+    if (!same || !memory) {
+        return same;
+    }
+
+    mmu_state ram;
+    mmu_.SaveState(&ram);
+    const uint8_t* ref_ram = ref_.GetRam();
+    if (memcmp(ram.ram, ref_ram, RAM_SIZE) != 0) {
+        same = false;
+        for (int i = 0; i < RAM_SIZE && diff != nullptr; i++) {
+            if (ram.ram[i] != ref_ram[i]) {
+                stringstream ss;
+                ss << hex << uppercase << setfill('0') << "  $" << setw(4) << i
+                   << " expected " << setw(2) << (int)ref_ram[i]
+                   << " actual " << setw(2) << (int)ram.ram[i] << "\n";
+                *diff += ss.str();
+            }
+        }
+    }
+
+    for (FuzzMemory* written : { &cpu_memory_, &ref_memory_ }) {
+        for (int i = 0; i < written->GetWriteCount(); i++) {
+            uint16_t addr = written->GetWrite(i);
+            uint8_t expected = ref_memory_.Read8(addr);
+            uint8_t actual = cpu_memory_.Read8(addr);
+            if (expected != actual) {
+                same = false;
+                if (diff != nullptr) {
+                    stringstream ss;
+                    ss << hex << uppercase << setfill('0') << "  $" << setw(4) << addr
+                       << " expected " << setw(2) << (int)expected
+                       << " actual " << setw(2) << (int)actual << "\n";
+                    *diff += ss.str();
+                }
+            }
+        }
+    }
+    return same;
+}
+
+bool CpuFuzzer::Execute(const fuzz_case& c, bool memory_each_step, int* step, string* diff) {
+    static const vector<bool> fuzzable = [] {
+        vector<bool> v(256, false);
+        for (uint8_t op : GetOpcodes()) {
+            v[op] = true;
+        }
+        return v;
+    }();
+
+    Setup(c);
+    for (int s = 0; s < c.steps; s++) {
+        uint16_t pc = ref_.GetRegisters().PC;
+        uint8_t opcode = ref_.Peek(pc);
+        if (!fuzzable[opcode]) {
+            break;      // ran off the program into an opcode we don't compare
+        }
+        if (diff != nullptr) {
+            uint8_t bytes[3] = { opcode, ref_.Peek(pc + 1), ref_.Peek(pc + 2) };
+            char text[32];
+            Disassembler::Format(pc, bytes, text, sizeof(text));
+            stringstream ss;
+            ss << "step " << s << ": " << hex << uppercase << setfill('0')
+               << setw(4) << pc << "  " << text << "\n";
+            *diff = ss.str();
+        }
+        coverage_[opcode]++;
+        instructions_++;
+        if (cycle_core_) {
+            cycle_cpu_.Step();
+        } else {
+            cpu_.Step();
+        }
+        ref_.Step();
+        if (!Compare(memory_each_step, diff)) {
+            *step = s;
+            return false;
+        }
+    }
+    if (!Compare(true, diff)) {
+        *step = -1;
+        return false;
+    }
+    return true;
+}
+
+bool CpuFuzzer::Run(const fuzz_case& c, int* step) {
+    int s;
+    if (Execute(c, false, &s, nullptr)) {
+        return true;
+    }
+    if (s < 0) {
+        // memory differs: find the instruction that wrote it
+        Execute(c, true, &s, nullptr);
+    }
+    if (step != nullptr) {
+        *step = s;
+    }
+    return false;
+}
+
+vector<int> CpuFuzzer::Boundaries(const fuzz_case& c) {
+    vector<int> starts;
+    for (int i = 0; i < c.size; i += RefCpu::Size(c.program[i])) {
+        starts.push_back(i);
+    }
+    return starts;
+}
+
+fuzz_case CpuFuzzer::Minimize(const fuzz_case& c) {
+    fuzz_case best = c;
+    int step;
+    if (Run(best, &step)) {
+        return best;
+    }
+    if (step >= 0) {
+        best.steps = step + 1;
+    }
+
+    // drop instructions, last first so earlier boundaries stay valid
+    vector<int> starts = Boundaries(best);
+    for (int i = (int)starts.size() - 1; i >= 0; i--) {
+        vector<int> cur = Boundaries(best);
+        if (cur.size() < 2 || i >= (int)cur.size()) {
+            continue;
+        }
+        int begin = cur[i];
+        int end = (i + 1 < (int)cur.size()) ? cur[i + 1] : best.size;
+        fuzz_case candidate = best;
+        memmove(&candidate.program[begin], &best.program[end], best.size - end);
+        candidate.size -= end - begin;
+        candidate.steps = min<int>(best.steps, cur.size() - 1);
+        if (!Run(candidate, &step)) {
+            best = candidate;
+            if (step >= 0) {
+                best.steps = step + 1;
+            }
+        }
+    }
+
+    // zero operand bytes
+    vector<int> cur = Boundaries(best);
+    for (int i = 0; i < best.size; i++) {
+        if (find(cur.begin(), cur.end(), i) != cur.end() || best.program[i] == 0) {
+            continue;
+        }
+        fuzz_case candidate = best;
+        candidate.program[i] = 0;
+        if (!Run(candidate)) {
+            best = candidate;
+        }
+    }
+
+    // plain registers
+    const registers plain = { 0, 0, 0, best.reg.PC, 0xFD, 0x24 };
+    uint8_t registers::* fields[] = { &registers::A, &registers::X, &registers::Y,
+                                      &registers::SP, &registers::P };
+    for (auto field : fields) {
+        fuzz_case candidate = best;
+        candidate.reg.*field = plain.*field;
+        if (!Run(candidate)) {
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+string CpuFuzzer::Describe(const fuzz_case& c) {
+    stringstream ss;
+    ss << hex << uppercase << setfill('0');
+    ss << "seed " << setw(16) << c.seed
+       << " A:" << setw(2) << (int)c.reg.A << " X:" << setw(2) << (int)c.reg.X
+       << " Y:" << setw(2) << (int)c.reg.Y << " P:" << setw(2) << (int)c.reg.P
+       << " SP:" << setw(2) << (int)c.reg.SP << "\n";
+
+    for (int i : Boundaries(c)) {
+        uint8_t bytes[3] = { c.program[i], 0, 0 };
+        for (int j = 1; j < 3 && i + j < c.size; j++) {
+            bytes[j] = c.program[i + j];
+        }
+        char text[32];
+        Disassembler::Format(c.reg.PC + i, bytes, text, sizeof(text));
+        ss << setw(4) << (uint16_t)(c.reg.PC + i) << "  " << text << "\n";
+    }
+
+    int step;
+    string diff;
+    if (Execute(c, true, &step, &diff)) {
+        ss << "no divergence\n";
+    } else {
+        ss << "diverged at " << diff;
+    }
+    return ss.str();
+}
+
+void CpuFuzzer::RunParallel(int threads, uint64_t cases, double seconds, uint64_t seed,
+                            fuzz_summary* summary, bool cycle_core) {
+    atomic<uint64_t> next_batch(0);
+    atomic<bool> stop(false);
+    mutex lock;
+    auto start = chrono::steady_clock::now();
+    auto deadline = start + chrono::duration_cast<chrono::steady_clock::duration>(
+        chrono::duration<double>(seconds));
+
+    summary->cases = 0;
+    summary->instructions = 0;
+    summary->failed = false;
+    summary->report.clear();
+    memset(summary->coverage, 0, sizeof(summary->coverage));
+
+    auto worker = [&](int id) {
+        unique_ptr<CpuFuzzer> fuzzer(new CpuFuzzer(seed + id * 0x632BE59BD9B4E019ull, cycle_core));
+        uint64_t done = 0;
+        fuzz_case c;
+        while (!stop.load(memory_order_relaxed)) {
+            // claim cases in batches so a case limit is exact across threads
+            uint64_t batch = next_batch.fetch_add(FUZZ_BATCH);
+            if (cases != 0 && batch >= cases) {
+                break;
+            }
+            uint64_t n = (cases != 0) ? min<uint64_t>(FUZZ_BATCH, cases - batch) : FUZZ_BATCH;
+            for (uint64_t i = 0; i < n; i++) {
+                fuzzer->Generate(&c);
+                if (!fuzzer->Run(c)) {
+                    fuzz_case minimized = fuzzer->Minimize(c);
+                    lock_guard<mutex> guard(lock);
+                    if (!summary->failed) {
+                        summary->failed = true;
+                        summary->failure = minimized;
+                        summary->report = fuzzer->Describe(minimized);
+                    }
+                    stop = true;
+                    break;
+                }
+                done++;
+            }
+            if (seconds > 0 && chrono::steady_clock::now() >= deadline) {
+                stop = true;
+            }
+        }
+
+        lock_guard<mutex> guard(lock);
+        summary->cases += done;
+        summary->instructions += fuzzer->instructions_;
+        for (int op = 0; op < 256; op++) {
+            summary->coverage[op] += fuzzer->coverage_[op];
+        }
+    };
+
+    vector<thread> pool;
+    for (int i = 0; i < threads; i++) {
+        pool.emplace_back(worker, i);
+    }
+    for (thread& t : pool) {
+        t.join();
+    }
+    summary->seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,118 @@
+#ifndef _CPU_FUZZER_H
+#define _CPU_FUZZER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Cpu.h"
+#include "CycleCpu.h"
+#include "Mmu.h"
+#include "Debugger.h"
+#include "IMemoryUnit.h"
+#include "RefCpu.h"
+
+#define FUZZ_MAX_INSNS      8
+#define FUZZ_MAX_BYTES      (FUZZ_MAX_INSNS * 3)
+#define FUZZ_MAX_WRITES     32      // writes above $1FFF per case
+#define FUZZ_BATCH          256     // cases sharing one RAM image
+
+// $2000-$FFFF for fuzzing: every byte is a hash of the case seed, so no
+// 64 KB image has to be built per case. Program bytes and writes are kept
+// as a short list of overrides.
+class FuzzMemory : public IMemoryUnit {
+public:
+    FuzzMemory();
+    ~FuzzMemory() = default;
+
+    void Reset(uint64_t seed);
+    void Poke(uint16_t addr, uint8_t data);
+    virtual uint8_t Read8(uint16_t addr);
+    virtual void Write8(uint16_t addr, uint8_t data);
+
+    int GetWriteCount(void) const { return writes_; }
+    uint16_t GetWrite(int i) const { return written_[i]; }
+
+    static uint8_t Hash(uint64_t seed, uint16_t addr);
+
+private:
+    typedef struct {
+        uint16_t addr;
+        uint8_t data;
+    } override_t;
+
+    uint64_t seed_;
+    override_t overrides_[FUZZ_MAX_BYTES + FUZZ_MAX_WRITES];
+    int count_;
+    uint16_t written_[FUZZ_MAX_WRITES];
+    int writes_;
+};
+
+typedef struct {
+    uint64_t seed;                  // RAM image and memory above $1FFF
+    registers reg;
+    uint8_t size;                   // program bytes placed at reg.PC
+    uint8_t program[FUZZ_MAX_BYTES];
+    uint8_t steps;                  // instructions to execute
+} fuzz_case;
+
+typedef struct {
+    uint64_t cases;
+    uint64_t instructions;
+    double seconds;
+    uint64_t coverage[256];         // executions per opcode
+    bool failed;
+    fuzz_case failure;              // minimized
+    std::string report;
+} fuzz_summary;
+
+// Differential fuzzer: random instruction streams and initial states run on
+// Cpu and RefCpu, comparing registers and cycles after every instruction
+// and memory at the end. With cycle_core the Cpu runs on CycleCpu instead
+// of Cpu::Step. Not thread-safe; RunParallel gives each thread its own
+// instance.
+class CpuFuzzer {
+public:
+    CpuFuzzer(uint64_t seed, bool cycle_core=false);
+    ~CpuFuzzer() = default;
+
+    void Generate(fuzz_case* c);
+    // Returns false on divergence; step gets the first diverging instruction.
+    bool Run(const fuzz_case& c, int* step=nullptr);
+    // Shortest, simplest case that still diverges.
+    fuzz_case Minimize(const fuzz_case& c);
+    std::string Describe(const fuzz_case& c);
+
+    const uint64_t* GetCoverage(void) const { return coverage_; }
+    // Opcodes modelled by RefCpu.
+    static const std::vector<uint8_t>& GetOpcodes(void);
+
+    // Stops after cases (0: no limit) or seconds, or at the first divergence.
+    static void RunParallel(int threads, uint64_t cases, double seconds, uint64_t seed,
+                            fuzz_summary* summary, bool cycle_core=false);
+
+private:
+    Debugger debugger_;
+    Mmu mmu_;
+    Cpu cpu_;
+    CycleCpu cycle_cpu_;
+    bool cycle_core_;
+    FuzzMemory cpu_memory_;
+    FuzzMemory ref_memory_;
+    RefCpu ref_;
+
+    uint64_t rng_;
+    uint64_t batch_seed_;
+    uint64_t batch_count_;
+    uint64_t ram_seed_;
+    uint8_t ram_[RAM_SIZE];
+    uint64_t coverage_[256];
+    uint64_t instructions_;
+
+    uint64_t Next(void);
+    void Setup(const fuzz_case& c);
+    bool Compare(bool memory, std::string* diff);
+    bool Execute(const fuzz_case& c, bool memory_each_step, int* step, std::string* diff);
+    static std::vector<int> Boundaries(const fuzz_case& c);
+};
+
+#endif
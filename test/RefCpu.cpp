@@ -0,0 +1,405 @@
+#include "RefCpu.h"
+#include "CpuFuzzer.h"
+#include <cstring>
+
+#define C_FLAG  0x01
+#define Z_FLAG  0x02
+#define I_FLAG  0x04
+#define B_FLAG  0x10
+#define U_FLAG  0x20
+#define V_FLAG  0x40
+#define N_FLAG  0x80
+
+RefCpu::RefCpu(FuzzMemory* memory) :
+    memory_(memory), cycles_(0)
+{
+    memset(&reg_, 0, sizeof(reg_));
+    memset(ram_, 0, sizeof(ram_));
+}
+
+bool RefCpu::IsSupported(uint8_t opcode) {
+    return Decode(opcode).op != JAM;
+}
+
+int RefCpu::Size(uint8_t opcode) {
+    switch (Decode(opcode).mode) {
+        case IMP: case ACC:
+            return 1;
+        case ABS: case ABX: case ABY: case IND:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+void RefCpu::Load(const registers& reg, const uint8_t* ram) {
+    reg_ = reg;
+    cycles_ = 0;
+    memcpy(ram_, ram, sizeof(ram_));
+}
+
+RefCpu::decoded RefCpu::Decode(uint8_t opcode) {
+    static const addr_mode group_modes[8] = { IZX, ZP, IMM, ABS, IZY, ZPX, ABY, ABX };
+    int a = opcode >> 5;
+    int b = (opcode >> 2) & 7;
+    int c = opcode & 3;
+
+    if (c == 1) {
+        static const mnemonic ops[8] = { ORA, AND, EOR, ADC, STA, LDA, CMP, SBC };
+        if (opcode == 0x89) {
+            return { NOP, IMM };
+        }
+        return { ops[a], group_modes[b] };
+    }
+
+    if (c == 3) {
+        static const mnemonic ops[8] = { SLO, RLA, SRE, RRA, SAX, LAX, DCP, ISB };
+        if (b == 2) {
+            // only SBC # is stable; ANC, ALR, ARR, XAA, LAX #, AXS aren't modelled
+            return (opcode == 0xEB) ? decoded{ SBC, IMM } : decoded{ JAM, BAD };
+        }
+        if ((a == 4 && (b == 4 || b == 6 || b == 7)) || (a == 5 && b == 6)) {
+            return { JAM, BAD };    // AHX, TAS, LAS
+        }
+        addr_mode m = group_modes[b];
+        if ((a == 4 || a == 5) && b == 5) {
+            m = ZPY;
+        } else if (a == 5 && b == 7) {
+            m = ABY;
+        }
+        return { ops[a], m };
+    }
+
+    if (c == 2) {
+        static const mnemonic ops[8] = { ASL, ROL, LSR, ROR, STX, LDX, DEC, INC };
+        static const mnemonic implied[4] = { TXA, TAX, DEX, NOP };
+        switch (b) {
+            case 0:
+                if (a == 5) {
+                    return { LDX, IMM };
+                }
+                return (a >= 4) ? decoded{ NOP, IMM } : decoded{ JAM, BAD };
+            case 1:
+                return { ops[a], ZP };
+            case 2:
+                return (a < 4) ? decoded{ ops[a], ACC } : decoded{ implied[a - 4], IMP };
+            case 3:
+                return { ops[a], ABS };
+            case 5:
+                return { ops[a], (a == 4 || a == 5) ? ZPY : ZPX };
+            case 6:
+                return { (a == 4) ? TXS : (a == 5) ? TSX : NOP, IMP };
+            case 7:
+                if (a == 4) {
+                    return { JAM, BAD };    // SHX
+                }
+                return { ops[a], (a == 5) ? ABY : ABX };
+            default:
+                return { JAM, BAD };
+        }
+    }
+
+    switch (b) {
+        case 0: {
+            static const decoded ops[8] = {
+                { BRK, IMP }, { JSR, ABS }, { RTI, IMP }, { RTS, IMP },
+                { NOP, IMM }, { LDY, IMM }, { CPY, IMM }, { CPX, IMM }
+            };
+            return ops[a];
+        }
+        case 1: {
+            static const mnemonic ops[8] = { NOP, BIT, NOP, NOP, STY, LDY, CPY, CPX };
+            return { ops[a], ZP };
+        }
+        case 2: {
+            static const mnemonic ops[8] = { PHP, PLP, PHA, PLA, DEY, TAY, INY, INX };
+            return { ops[a], IMP };
+        }
+        case 3: {
+            static const mnemonic ops[8] = { NOP, BIT, JMP, JMP, STY, LDY, CPY, CPX };
+            return { ops[a], (a == 3) ? IND : ABS };
+        }
+        case 4:
+            return { BRANCH, REL };
+        case 5:
+            return { (a == 4) ? STY : (a == 5) ? LDY : NOP, ZPX };
+        case 6: {
+            static const mnemonic ops[8] = { CLC, SEC, CLI, SEI, TYA, CLV, CLD, SED };
+            return { ops[a], IMP };
+        }
+        default:
+            if (a == 4) {
+                return { JAM, BAD };        // SHY
+            }
+            return { (a == 5) ? LDY : NOP, ABX };
+    }
+}
+
+RefCpu::kind RefCpu::KindOf(mnemonic op) {
+    switch (op) {
+        case ORA: case AND: case EOR: case ADC: case LDA: case CMP: case SBC:
+        case LDX: case LDY: case LAX: case BIT: case CPX: case CPY: case NOP:
+            return KIND_READ;
+        case STA: case STX: case STY: case SAX:
+            return KIND_WRITE;
+        case ASL: case ROL: case LSR: case ROR: case DEC: case INC:
+        case SLO: case RLA: case SRE: case RRA: case DCP: case ISB:
+            return KIND_RMW;
+        default:
+            return KIND_OTHER;
+    }
+}
+
+int RefCpu::Cycles(addr_mode m, kind k) {
+    if (k == KIND_OTHER) {
+        return 2;   // jumps and stack operations add their extra cycles
+    }
+    switch (m) {
+        case ZP:  return (k == KIND_RMW) ? 5 : 3;
+        case ZPX:
+        case ZPY: return (k == KIND_RMW) ? 6 : 4;
+        case ABS: return (k == KIND_RMW) ? 6 : 4;
+        case ABX:
+        case ABY: return (k == KIND_RMW) ? 7 : (k == KIND_WRITE) ? 5 : 4;
+        case IZX: return (k == KIND_RMW) ? 8 : 6;
+        case IZY: return (k == KIND_RMW) ? 8 : (k == KIND_WRITE) ? 6 : 5;
+        default:  return 2;
+    }
+}
+
+uint8_t RefCpu::Read(uint16_t addr) {
+    return (addr < 0x2000) ? ram_[addr & (RAM_SIZE - 1)] : memory_->Read8(addr);
+}
+
+void RefCpu::Write(uint16_t addr, uint8_t data) {
+    if (addr < 0x2000) {
+        ram_[addr & (RAM_SIZE - 1)] = data;
+    } else {
+        memory_->Write8(addr, data);
+    }
+}
+
+uint16_t RefCpu::ReadZp16(uint8_t addr) {
+    return Read(addr) | (Read((uint8_t)(addr + 1)) << 8);
+}
+
+void RefCpu::Push(uint8_t data) {
+    Write(0x100 | reg_.SP, data);
+    reg_.SP--;
+}
+
+uint8_t RefCpu::Pull(void) {
+    reg_.SP++;
+    return Read(0x100 | reg_.SP);
+}
+
+void RefCpu::SetFlag(uint8_t flag, bool on) {
+    reg_.P = on ? (reg_.P | flag) : (reg_.P & ~flag);
+}
+
+void RefCpu::NZ(uint8_t val) {
+    SetFlag(Z_FLAG, val == 0);
+    SetFlag(N_FLAG, val & 0x80);
+}
+
+void RefCpu::Add(uint8_t val) {
+    unsigned sum = reg_.A + val + (reg_.P & C_FLAG);
+    SetFlag(V_FLAG, ~(reg_.A ^ val) & (reg_.A ^ sum) & 0x80);
+    SetFlag(C_FLAG, sum > 0xFF);
+    reg_.A = sum;
+    NZ(reg_.A);
+}
+
+void RefCpu::Compare(uint8_t reg, uint8_t val) {
+    SetFlag(C_FLAG, reg >= val);
+    NZ(reg - val);
+}
+
+void RefCpu::Step(void) {
+    uint16_t pc = reg_.PC;
+    uint8_t opcode = Read(pc);
+    decoded d = Decode(opcode);
+    kind k = KindOf(d.op);
+
+    int size = Size(opcode);
+    uint8_t lo = (size > 1) ? Read(pc + 1) : 0;
+    uint8_t hi = (size > 2) ? Read(pc + 2) : 0;
+    uint16_t abs = lo | (hi << 8);
+    reg_.PC = pc + size;
+
+    uint16_t ea = 0;
+    bool crossed = false;
+    switch (d.mode) {
+        case IMM: ea = pc + 1; break;
+        case ZP:  ea = lo; break;
+        case ZPX: ea = (uint8_t)(lo + reg_.X); break;
+        case ZPY: ea = (uint8_t)(lo + reg_.Y); break;
+        case ABS: ea = abs; break;
+        case ABX: ea = abs + reg_.X; crossed = (ea ^ abs) & 0xFF00; break;
+        case ABY: ea = abs + reg_.Y; crossed = (ea ^ abs) & 0xFF00; break;
+        case IZX: ea = ReadZp16(lo + reg_.X); break;
+        case IZY: {
+            uint16_t base = ReadZp16(lo);
+            ea = base + reg_.Y;
+            crossed = (ea ^ base) & 0xFF00;
+            break;
+        }
+        case IND:
+            // the pointer's high byte doesn't carry into the next page
+            ea = Read(abs) | (Read((abs & 0xFF00) | ((abs + 1) & 0xFF)) << 8);
+            break;
+        default:
+            break;
+    }
+
+    cycles_ += Cycles(d.mode, k);
+    if (crossed && k == KIND_READ) {
+        cycles_ += 1;
+    }
+
+    uint8_t m = 0;
+    if (k == KIND_READ || k == KIND_RMW) {
+        m = (d.mode == ACC) ? reg_.A : Read(ea);
+    }
+
+    switch (d.op) {
+        case ORA: reg_.A |= m; NZ(reg_.A); break;
+        case AND: reg_.A &= m; NZ(reg_.A); break;
+        case EOR: reg_.A ^= m; NZ(reg_.A); break;
+        case ADC: Add(m); break;
+        case SBC: Add(m ^ 0xFF); break;
+        case LDA: reg_.A = m; NZ(m); break;
+        case LDX: reg_.X = m; NZ(m); break;
+        case LDY: reg_.Y = m; NZ(m); break;
+        case LAX: reg_.A = reg_.X = m; NZ(m); break;
+        case CMP: Compare(reg_.A, m); break;
+        case CPX: Compare(reg_.X, m); break;
+        case CPY: Compare(reg_.Y, m); break;
+        case BIT:
+            SetFlag(Z_FLAG, (reg_.A & m) == 0);
+            SetFlag(N_FLAG, m & 0x80);
+            SetFlag(V_FLAG, m & 0x40);
+            break;
+        case NOP: break;
+
+        case STA: Write(ea, reg_.A); break;
+        case STX: Write(ea, reg_.X); break;
+        case STY: Write(ea, reg_.Y); break;
+        case SAX: Write(ea, reg_.A & reg_.X); break;
+
+        case ASL: case SLO:
+            SetFlag(C_FLAG, m & 0x80);
+            m <<= 1;
+            break;
+        case LSR: case SRE:
+            SetFlag(C_FLAG, m & 0x01);
+            m >>= 1;
+            break;
+        case ROL: case RLA: {
+            uint8_t carry = reg_.P & C_FLAG;
+            SetFlag(C_FLAG, m & 0x80);
+            m = (m << 1) | carry;
+            break;
+        }
+        case ROR: case RRA: {
+            uint8_t carry = reg_.P & C_FLAG;
+            SetFlag(C_FLAG, m & 0x01);
+            m = (m >> 1) | (carry << 7);
+            break;
+        }
+        case DEC: case DCP: m--; break;
+        case INC: case ISB: m++; break;
+
+        case JMP:
+            reg_.PC = (d.mode == IND) ? ea : abs;
+            cycles_ += (d.mode == IND) ? 3 : 1;
+            break;
+        case JSR:
+            Push((reg_.PC - 1) >> 8);
+            Push(reg_.PC - 1);
+            // the high byte is fetched after the pushes, which can overwrite it
+            reg_.PC = (abs & 0xFF) | (Read(reg_.PC - 1) << 8);
+            cycles_ += 4;
+            break;
+        case RTS: {
+            uint16_t ret = Pull();
+            ret |= Pull() << 8;
+            reg_.PC = ret + 1;
+            cycles_ += 4;
+            break;
+        }
+        case RTI: {
+            reg_.P = (Pull() & ~B_FLAG) | U_FLAG;
+            uint16_t ret = Pull();
+            ret |= Pull() << 8;
+            reg_.PC = ret;
+            cycles_ += 4;
+            break;
+        }
+        case BRK:
+            // BRK skips a padding byte
+            Push((pc + 2) >> 8);
+            Push(pc + 2);
+            Push(reg_.P | B_FLAG | U_FLAG);
+            SetFlag(I_FLAG, true);
+            reg_.PC = Read(0xFFFE) | (Read(0xFFFF) << 8);
+            cycles_ += 5;
+            break;
+
+        case PHP: Push(reg_.P | B_FLAG | U_FLAG); cycles_ += 1; break;
+        case PHA: Push(reg_.A); cycles_ += 1; break;
+        case PLP: reg_.P = (Pull() & ~B_FLAG) | U_FLAG; cycles_ += 2; break;
+        case PLA: reg_.A = Pull(); NZ(reg_.A); cycles_ += 2; break;
+
+        case DEX: reg_.X--; NZ(reg_.X); break;
+        case DEY: reg_.Y--; NZ(reg_.Y); break;
+        case INX: reg_.X++; NZ(reg_.X); break;
+        case INY: reg_.Y++; NZ(reg_.Y); break;
+        case TAX: reg_.X = reg_.A; NZ(reg_.X); break;
+        case TAY: reg_.Y = reg_.A; NZ(reg_.Y); break;
+        case TXA: reg_.A = reg_.X; NZ(reg_.A); break;
+        case TYA: reg_.A = reg_.Y; NZ(reg_.A); break;
+        case TSX: reg_.X = reg_.SP; NZ(reg_.X); break;
+        case TXS: reg_.SP = reg_.X; break;
+
+        case CLC: SetFlag(C_FLAG, false); break;
+        case SEC: SetFlag(C_FLAG, true); break;
+        case CLI: SetFlag(I_FLAG, false); break;
+        case SEI: SetFlag(I_FLAG, true); break;
+        case CLV: SetFlag(V_FLAG, false); break;
+        case CLD: SetFlag(0x08, false); break;
+        case SED: SetFlag(0x08, true); break;
+
+        case BRANCH: {
+            // bits 7-6 pick N, V, C or Z, bit 5 the value to branch on
+            static const uint8_t flags[4] = { N_FLAG, V_FLAG, C_FLAG, Z_FLAG };
+            bool set = (reg_.P & flags[opcode >> 6]) != 0;
+            if (set == ((opcode >> 5) & 1)) {
+                uint16_t target = reg_.PC + (int8_t)lo;
+                cycles_ += ((target ^ reg_.PC) & 0xFF00) ? 2 : 1;
+                reg_.PC = target;
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    if (k == KIND_RMW) {
+        if (d.mode == ACC) {
+            reg_.A = m;
+        } else {
+            Write(ea, m);
+        }
+        switch (d.op) {
+            case SLO: reg_.A |= m; NZ(reg_.A); break;
+            case RLA: reg_.A &= m; NZ(reg_.A); break;
+            case SRE: reg_.A ^= m; NZ(reg_.A); break;
+            case RRA: Add(m); break;
+            case DCP: Compare(reg_.A, m); break;
+            case ISB: Add(m ^ 0xFF); break;
+            default:  NZ(m); break;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef _REF_CPU_H
+#define _REF_CPU_H
+
+#include <cstdint>
+#include "Cpu.h"
+#include "Mmu.h"
+
+class FuzzMemory;
+
+// Reference 6502 for differential testing, written from the documented
+// behaviour rather than from Cpu. Opcodes are decoded from their aaabbbcc
+// bit fields instead of a 256-entry table so a typo can't be shared with
+// Cpu's tables (opcode.h). Covers the official opcodes and the unofficial ones
+// nestest exercises (LAX, SAX, DCP, ISB, SLO, RLA, SRE, RRA, SBC #, NOPs).
+// No decimal mode, like the 2A03.
+class RefCpu {
+public:
+    RefCpu(FuzzMemory* memory);
+    ~RefCpu() = default;
+
+    static bool IsSupported(uint8_t opcode);
+    static int Size(uint8_t opcode);
+
+    // ram is the 2 KB internal RAM, mirrored through $1FFF.
+    void Load(const registers& reg, const uint8_t* ram);
+    void Step(void);
+    uint8_t Peek(uint16_t addr) { return Read(addr); }
+
+    const registers& GetRegisters(void) const { return reg_; }
+    uint64_t GetCycles(void) const { return cycles_; }
+    const uint8_t* GetRam(void) const { return ram_; }
+
+private:
+    enum addr_mode {
+        IMP, ACC, IMM, ZP, ZPX, ZPY, ABS, ABX, ABY, IND, IZX, IZY, REL, BAD
+    };
+    enum kind {
+        KIND_READ,      // page crossing costs a cycle
+        KIND_WRITE,
+        KIND_RMW,
+        KIND_OTHER
+    };
+    enum mnemonic {
+        ORA, AND, EOR, ADC, STA, LDA, CMP, SBC,
+        ASL, ROL, LSR, ROR, STX, LDX, DEC, INC,
+        SLO, RLA, SRE, RRA, SAX, LAX, DCP, ISB,
+        BIT, STY, LDY, CPY, CPX, JMP, JSR, BRK, RTI, RTS,
+        PHP, PLP, PHA, PLA, DEY, TAY, INY, INX,
+        TXA, TAX, DEX, TXS, TSX,
+        CLC, SEC, CLI, SEI, TYA, CLV, CLD, SED,
+        BRANCH, NOP, JAM
+    };
+    typedef struct {
+        mnemonic op;
+        addr_mode mode;
+    } decoded;
+
+    FuzzMemory* memory_;
+    registers reg_;
+    uint64_t cycles_;
+    uint8_t ram_[RAM_SIZE];
+
+    static decoded Decode(uint8_t opcode);
+    static kind KindOf(mnemonic op);
+    static int Cycles(addr_mode m, kind k);
+
+    uint8_t Read(uint16_t addr);
+    void Write(uint16_t addr, uint8_t data);
+    uint16_t ReadZp16(uint8_t addr);
+    void Push(uint8_t data);
+    uint8_t Pull(void);
+    void NZ(uint8_t val);
+    void SetFlag(uint8_t flag, bool on);
+    void Add(uint8_t val);
+    void Compare(uint8_t reg, uint8_t val);
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "CpuFuzzer.h"
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+// cpu_fuzz [-c] [-j threads] [-t seconds] [-n cases] [-s seed]
+// -c fuzzes the per-cycle core (CycleCpu). Runs until the time or case limit, or the first divergence, which is
+// minimized and printed. Exits with 1 on divergence.
+int main(int argc, char* argv[]) {
+    int threads = thread::hardware_concurrency();
+    double seconds = 10;
+    uint64_t cases = 0;
+    uint64_t seed = chrono::steady_clock::now().time_since_epoch().count();
+    bool cycle_core = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "cj:t:n:s:")) != -1) {
+        switch (opt) {
+            case 'c': cycle_core = true; break;
+            case 'j': threads = atoi(optarg); break;
+            case 't': seconds = atof(optarg); break;
+            case 'n': cases = strtoull(optarg, nullptr, 0); break;
+            case 's': seed = strtoull(optarg, nullptr, 0); break;
+            default:
+                cout << "usage: " << argv[0] << " [-c] [-j threads] [-t seconds] [-n cases] [-s seed]" << endl;
+                return 2;
+        }
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    cout << "seed " << seed << ", " << threads << " threads, "
+         << CpuFuzzer::GetOpcodes().size() << " opcodes" << endl;
+    fuzz_summary summary;
+    CpuFuzzer::RunParallel(threads, cases, cases ? 0 : seconds, seed, &summary, cycle_core);
+
+    uint64_t least = UINT64_MAX;
+    int least_op = 0;
+    for (uint8_t op : CpuFuzzer::GetOpcodes()) {
+        if (summary.coverage[op] < least) {
+            least = summary.coverage[op];
+            least_op = op;
+        }
+    }
+    cout << summary.cases << " cases, " << summary.instructions << " instructions in "
+         << summary.seconds << " s (" << (uint64_t)(summary.cases / summary.seconds)
+         << " cases/s)" << endl;
+    cout << "least covered opcode $" << hex << least_op << dec << ": " << least << " runs" << endl;
+
+    if (summary.failed) {
+        cout << summary.report;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include "libnes.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+#define ROM "../../roms/nestest.nes"
+
+TEST(CApiTest, LiveBuffers) {
+    EXPECT_EQ(nes_api_version(), NES_API_VERSION);
+
+    nes_instance* nes = nes_create();
+    ASSERT_NE(nes, nullptr);
+    EXPECT_EQ(nes_load_rom(nes, "missing.nes"), -1);
+    ASSERT_EQ(nes_load_rom(nes, ROM), 0);
+
+    const uint8_t* ram = nes_get_ram(nes);
+    const uint8_t* frame_buffer = nes_get_frame_buffer(nes);
+    vector<uint8_t> before(ram, ram + NES_RAM_SIZE);
+
+    uint8_t input[NES_PORTS] = { 0x10, 0 };
+    nes_step(nes, input, 4);
+    EXPECT_EQ(nes_get_frame(nes), 4u);
+    EXPECT_EQ(nes_get_ram(nes), ram);
+    EXPECT_EQ(nes_get_frame_buffer(nes), frame_buffer);
+    // read through the pointer taken before the step
+    EXPECT_NE(memcmp(before.data(), ram, NES_RAM_SIZE), 0);
+
+    vector<uint8_t> state(nes_state_size());
+    nes_save_state(nes, state.data());
+    nes_step(nes, input, 2);
+    nes_load_state(nes, state.data());
+    EXPECT_EQ(nes_get_frame(nes), 4u);
+    EXPECT_EQ(nes_get_ram(nes), ram);
+
+    nes_destroy(nes);
+}
+
+TEST(CApiTest, StepMany) {
+    const uint32_t count = 4;
+    const uint32_t frames = 3;
+    vector<nes_instance*> batch, single;
+    vector<uint8_t> input(count * NES_PORTS);
+    for (uint32_t i = 0; i < count; i++) {
+        batch.push_back(nes_create());
+        single.push_back(nes_create());
+        ASSERT_EQ(nes_load_rom(batch[i], ROM), 0);
+        ASSERT_EQ(nes_load_rom(single[i], ROM), 0);
+        input[i * NES_PORTS] = 1 << i;
+    }
+
+    nes_step_many(batch.data(), count, input.data(), frames);
+    for (uint32_t i = 0; i < count; i++) {
+        nes_step(single[i], &input[i * NES_PORTS], frames);
+        EXPECT_EQ(nes_get_frame(batch[i]), frames);
+        EXPECT_EQ(memcmp(nes_get_ram(batch[i]), nes_get_ram(single[i]), NES_RAM_SIZE), 0);
+        nes_destroy(batch[i]);
+        nes_destroy(single[i]);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,25 +1,46 @@
 #include "Nes.h"
-#include "Logging.h"
+#include "Cartridge.h"
+#include "CycleCpu.h"
+#include "ITraceSink.h"
 #include <gtest/gtest.h>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <vector>
 
 using namespace std;
 
-TEST(CpuTest, nestest) {
+// Collects the trace in the same format as the CPU log, independent of the
+// compiled log level.
+class TraceLines : public ITraceSink {
+public:
+    void OnInstruction(const registers& reg, uint8_t opcode, uint16_t operand,
+                       uint64_t cycles) override {
+        lines.push_back(Cpu::FormatTrace(reg, opcode, operand, cycles));
+    }
+    vector<string> lines;
+};
+
+static void CompareTrace(Nes::cpu_core core) {
     string ref, uut, word;
     ifstream ref_log("../../test/nestest-bus-cycles.log");
-    ifstream uut_log("test_nestest.log");
-
-    LOG_INIT("test_nestest.log");
+    ASSERT_TRUE(ref_log.is_open());
 
     Nes nes;
+    TraceLines trace;
+    nes.SetCpuCore(core);
+    nes.SetTraceSink(&trace);
     nes.PowerOn();
     nes.Run("../../roms/nestest.nes", Nes::EMU_MODE_AUTOMATED);
+    nes.SetTraceSink(nullptr);
+    ASSERT_FALSE(trace.lines.empty());
 
+    size_t line = 0;
     while (getline(ref_log, ref)) {
         istringstream iss(ref);
         iss >> word;
-        if (word != "READ" && word != "WRITE" && getline(uut_log, uut)) {
+        if (word != "READ" && word != "WRITE" && line < trace.lines.size()) {
+            uut = trace.lines[line++];
             int ref_CPUC = stoi(ref.substr(79), nullptr);
 
             string ref_PC = ref.substr(0, 4);
@@ -56,6 +77,86 @@ TEST(CpuTest, nestest) {
     }
 }
 
+TEST(CpuTest, nestest) {
+    CompareTrace(Nes::CPU_CORE_FAST);
+}
+
+TEST(CpuTest, nestestCycleCore) {
+    CompareTrace(Nes::CPU_CORE_CYCLE);
+}
+
+// Records every bus access in the syntax of nestest-bus-cycles.log.
+class BusRecorder : public Mmu {
+public:
+    BusRecorder(Debugger* debugger) : Mmu(nullptr, debugger) {}
+
+    virtual uint8_t Read8(uint16_t addr) {
+        Record("READ", addr);
+        return Mmu::Read8(addr);
+    }
+    virtual void Write8(uint16_t addr, uint8_t data) {
+        Record("WRITE", addr);
+        Mmu::Write8(addr, data);
+    }
+
+    vector<string> accesses;
+
+private:
+    void Record(const char* type, uint16_t addr) {
+        char line[16];
+        snprintf(line, sizeof(line), "%s $%04X", type, addr);
+        accesses.push_back(line);
+    }
+};
+
+TEST(CpuTest, nestestBusCycles) {
+    ifstream ref_log("../../test/nestest-bus-cycles.log");
+    ASSERT_TRUE(ref_log.is_open());
+
+    Debugger debugger(nullptr);
+    BusRecorder bus(&debugger);
+    Cpu cpu(nullptr, &bus, &debugger);
+    CycleCpu cycle_cpu(&cpu, &bus, &debugger);
+    Cartridge cartridge(nullptr, &bus);
+    bus.AddMemoryMap(&bus, 0x0000, 0x1FFF);
+    bus.AddMemoryMap(&cartridge, 0x4020, 0xFFFF);
+    cartridge.LoadRom("../../roms/nestest.nes");
+    cpu.SetTraceEnabled(false);
+    cpu.PowerOn();
+    cpu.SetPC(0xC000);
+
+    // one instruction line followed by its READ/WRITE lines, one per cycle
+    string line, insn, word, addr;
+    vector<string> expected;
+    int instructions = 0;
+    auto check = [&]() {
+        if (insn.empty()) {
+            return;
+        }
+        bus.accesses.clear();
+        cycle_cpu.Step();
+        instructions++;
+        ASSERT_EQ(bus.accesses, expected) << insn;
+    };
+    while (getline(ref_log, line)) {
+        istringstream iss(line);
+        iss >> word;
+        if (word == "READ" || word == "WRITE") {
+            iss >> addr;
+            expected.push_back(word + " " + addr);
+            continue;
+        }
+        check();
+        if (HasFatalFailure()) {
+            return;
+        }
+        insn = line;
+        expected.clear();
+    }
+    check();
+    EXPECT_GT(instructions, 8000);
+}
+
 int main(int argc, char* argv[]) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
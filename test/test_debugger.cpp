@@ -0,0 +1,95 @@
+#include "Nes.h"
+#include "Debugger.h"
+#include <gtest/gtest.h>
+
+using namespace std;
+
+static void Boot(Nes& nes) {
+    nes.PowerOn();
+    nes.LoadRom("../../roms/nestest.nes");
+    nes.Reset(Nes::EMU_MODE_AUTOMATED);
+}
+
+TEST(DebuggerTest, ExecBreakpointPausesBeforeInstruction) {
+    Nes nes;
+    Boot(nes);
+    Debugger* dbg = nes.GetDebugger();
+    int id = dbg->AddBreakpoint(BP_EXEC, 0xC5F7);
+
+    nes.RunFrame(false);
+    ASSERT_TRUE(nes.IsPaused());
+    EXPECT_EQ(nes.GetFrame(), 0u);
+    EXPECT_EQ(dbg->GetHit().id, id);
+    EXPECT_EQ(dbg->GetHit().reg.PC, 0xC5F7);
+    EXPECT_EQ(dbg->GetHit().cycles, 5u);
+
+    // resuming steps over the breakpoint and finishes the frame
+    dbg->Resume();
+    nes.RunFrame(false);
+    EXPECT_FALSE(nes.IsPaused());
+    EXPECT_EQ(nes.GetFrame(), 1u);
+}
+
+TEST(DebuggerTest, WriteWatchpoint) {
+    Nes nes;
+    Boot(nes);
+    Debugger* dbg = nes.GetDebugger();
+    dbg->AddBreakpoint(BP_WRITE, 0x0010, 0x0011);
+
+    nes.RunFrame(false);
+    ASSERT_TRUE(nes.IsPaused());
+    EXPECT_EQ(dbg->GetHit().type, BP_WRITE);
+    EXPECT_EQ(dbg->GetHit().addr, 0x0010);
+    EXPECT_EQ(dbg->GetHit().reg.PC, 0xC5F9);   // STX $10
+
+    dbg->Resume();
+    nes.RunFrame(false);
+    ASSERT_TRUE(nes.IsPaused());
+    EXPECT_EQ(dbg->GetHit().addr, 0x0011);
+    EXPECT_EQ(dbg->GetHit().reg.PC, 0xC5FB);   // STX $11
+}
+
+TEST(DebuggerTest, RamMirrorWatchpoint) {
+    Nes nes;
+    Boot(nes);
+    Debugger* dbg = nes.GetDebugger();
+    // $0810 and $1810 are mirrors of $0010
+    dbg->AddBreakpoint(BP_WRITE, 0x0810);
+
+    // the pages the CPU, the bus and OAM DMA check are all watched
+    for (uint16_t addr = 0x0010; addr < 0x2000; addr += RAM_SIZE) {
+        EXPECT_TRUE(dbg->IsWatched(addr, BP_WRITE));
+    }
+    EXPECT_FALSE(dbg->IsWatched(0x2010, BP_WRITE));
+
+    nes.RunFrame(false);
+    ASSERT_TRUE(nes.IsPaused());
+    EXPECT_EQ(dbg->GetHit().addr, 0x0010);
+    EXPECT_EQ(dbg->GetHit().reg.PC, 0xC5F9);   // STX $10
+
+    dbg->ClearBreakpoints();
+    dbg->AddBreakpoint(BP_READ, 0x1A00, 0x1AFF);
+    EXPECT_TRUE(dbg->IsWatched(0x0200, BP_READ));
+    EXPECT_FALSE(dbg->IsWatched(0x0300, BP_READ));
+}
+
+TEST(DebuggerTest, ConditionalBreakpoint) {
+    Nes nes;
+    Boot(nes);
+    Debugger* dbg = nes.GetDebugger();
+    bp_condition never = { BP_REG_SP, BP_CMP_EQ, 0x00 };
+    bp_condition inside_jsr = { BP_REG_SP, BP_CMP_EQ, 0xFB };
+    int miss = dbg->AddBreakpoint(BP_EXEC, 0xC72E, &never);
+    int hit = dbg->AddBreakpoint(BP_EXEC, 0xC72E, &inside_jsr);
+
+    nes.RunFrame(false);
+    ASSERT_TRUE(nes.IsPaused());
+    EXPECT_EQ(dbg->GetHit().id, hit);
+
+    EXPECT_TRUE(dbg->RemoveBreakpoint(hit));
+    EXPECT_TRUE(dbg->RemoveBreakpoint(miss));
+    EXPECT_FALSE(dbg->RemoveBreakpoint(miss));
+    dbg->Resume();
+    nes.RunFrame(false);
+    EXPECT_FALSE(nes.IsPaused());
+}
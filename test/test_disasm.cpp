@@ -0,0 +1,127 @@
+#include "Cartridge.h"
+#include "CodeDataLogger.h"
+#include "Nes.h"
+#include "Disassembler.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+static void Put(vector<uint8_t>& prg, uint16_t addr, const vector<uint8_t>& bytes) {
+    for (size_t i = 0; i < bytes.size(); i++) {
+        prg[(addr + i) & (prg.size() - 1)] = bytes[i];
+    }
+}
+
+TEST(DisassemblerTest, Format) {
+    char buf[32];
+    const uint8_t lda[] = { 0xBD, 0x78, 0xFF };
+    const uint8_t bpl[] = { 0x10, 0xFB };
+    const uint8_t jam[] = { 0x02 };
+    EXPECT_EQ(Disassembler::Format(0xC049, lda, buf, sizeof(buf)), 3);
+    EXPECT_STREQ(buf, "LDA $FF78,X");
+    EXPECT_EQ(Disassembler::Format(0xC00C, bpl, buf, sizeof(buf)), 2);
+    EXPECT_STREQ(buf, "BPL $C009");
+    EXPECT_EQ(Disassembler::Format(0xC000, jam, buf, sizeof(buf)), 1);
+    EXPECT_STREQ(buf, ".byte $02");
+}
+
+TEST(DisassemblerTest, FollowsJumpTables) {
+    vector<uint8_t> prg(0x4000, 0);
+    // RTS trick through split lo/hi tables at $C00C/$C00E
+    Put(prg, 0xC000, { 0xA2, 0x01,              // LDX #$01
+                       0xBD, 0x0E, 0xC0,        // LDA $C00E,X
+                       0x48,                    // PHA
+                       0xBD, 0x0C, 0xC0,        // LDA $C00C,X
+                       0x48,                    // PHA
+                       0x60 });                 // RTS
+    Put(prg, 0xC00C, { 0x1F, 0x2F, 0xC0, 0xC0 });
+    Put(prg, 0xC020, { 0xE8, 0x60 });           // INX, RTS
+    // JMP ($0000) through an interleaved word table at $C050
+    Put(prg, 0xC030, { 0xBD, 0x50, 0xC0,        // LDA $C050,X
+                       0x85, 0x00,              // STA $00
+                       0xBD, 0x51, 0xC0,        // LDA $C051,X
+                       0x85, 0x01,              // STA $01
+                       0x6C, 0x00, 0x00 });     // JMP ($0000)
+    Put(prg, 0xC050, { 0x60, 0xC0, 0x70, 0xC0 });
+    Put(prg, 0xC060, { 0x40 });                 // RTI
+    Put(prg, 0xC070, { 0x40 });
+    Put(prg, 0xFFFA, { 0x60, 0xC0, 0x00, 0xC0, 0x60, 0xC0 });
+
+    Disassembler disasm(prg.data(), prg.size());
+    disasm.Analyze();
+    const vector<uint8_t>& map = disasm.GetMap();
+
+    EXPECT_EQ(disasm.GetJumpTables(), 2u);
+    for (uint16_t addr : { 0xC000, 0xC020, 0xC030, 0xC03A, 0xC060, 0xC070 }) {
+        EXPECT_TRUE(disasm.IsInstruction(addr & 0x3FFF)) << hex << addr;
+    }
+    for (uint16_t addr = 0xC00C; addr < 0xC010; addr++) {
+        EXPECT_EQ(map[addr & 0x3FFF], CDL_DATA) << hex << addr;
+    }
+    for (uint16_t addr = 0xC050; addr < 0xC054; addr++) {
+        EXPECT_EQ(map[addr & 0x3FFF], CDL_DATA) << hex << addr;
+    }
+    EXPECT_EQ(map[0xC054 & 0x3FFF], 0);
+    EXPECT_TRUE(map[0xC070 & 0x3FFF] & CDL_INDIRECT_CODE);
+}
+
+TEST(DisassemblerTest, Nestest) {
+    Cartridge cartridge(nullptr, nullptr);
+    cartridge.LoadRom("../../roms/nestest.nes");
+    const vector<uint8_t>& prg = cartridge.GetPrgRom();
+    ASSERT_EQ(prg.size(), 0x4000u);
+
+    Disassembler disasm(prg.data(), prg.size());
+    disasm.AddEntryPoint(0xC000);
+    disasm.Analyze();
+    EXPECT_TRUE(disasm.IsInstruction(0xC5F5 & 0x3FFF));
+    EXPECT_TRUE(disasm.IsInstruction(0xC72D & 0x3FFF));
+    EXPECT_GT(disasm.GetCodeBytes(), prg.size() / 2);
+}
+
+TEST(CodeDataLoggerTest, MergesRuns) {
+    CodeDataLogger a, b;
+    a.Reset(0x4000, 0x2000);
+    b.Reset(0x4000, 0x2000);
+    a.BeginFetch(0xC000);
+    a.LogCode(0xC000, 3);
+    b.LogData(0xC100);
+    b.LogData(0x8100);      // mirror of $C100
+
+    ASSERT_TRUE(a.Save("test_a.cdl"));
+    ASSERT_TRUE(b.Save("test_b.cdl"));
+    CodeDataLogger merged;
+    merged.Reset(0x4000, 0x2000);
+    ASSERT_TRUE(merged.Merge("test_a.cdl"));
+    ASSERT_TRUE(merged.Merge("test_b.cdl"));
+    EXPECT_EQ(merged.GetCodeBytes(), 3u);
+    EXPECT_EQ(merged.GetDataBytes(), 1u);
+    EXPECT_EQ(merged.GetPrgMap()[0x0100], CDL_DATA | (2 << CDL_BANK_SHIFT));
+
+    CodeDataLogger other;
+    other.Reset(0x8000, 0);
+    EXPECT_FALSE(other.Load("test_a.cdl"));
+    remove("test_a.cdl");
+    remove("test_b.cdl");
+}
+
+TEST(CodeDataLoggerTest, RecordsExecution) {
+#ifndef NES_CDL
+    GTEST_SKIP() << "built without NES_CDL";
+#endif
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom("../../roms/nestest.nes");
+    nes.Reset(Nes::EMU_MODE_AUTOMATED);
+    nes.RunFrame(false);
+
+    const vector<uint8_t>& map = nes.GetCodeDataLogger()->GetPrgMap();
+    // JMP $C5F5: opcode and operands are code, not data
+    for (uint16_t addr = 0xC000; addr < 0xC003; addr++) {
+        EXPECT_EQ(map[addr & 0x3FFF] & (CDL_CODE | CDL_DATA), CDL_CODE);
+    }
+    EXPECT_TRUE(map[0xC5F5 & 0x3FFF] & CDL_CODE);
+    EXPECT_FALSE(map[0xC003 & 0x3FFF] & CDL_CODE);
+}
@@ -0,0 +1,269 @@
+#include "Nes.h"
+#include "FlightRecorder.h"
+#include "ITraceSink.h"
+#include <gtest/gtest.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+
+class RecordSink : public ITraceSink {
+public:
+    void OnInstruction(const registers& reg, uint8_t opcode, uint16_t operand,
+                       uint64_t cycles) override {
+        lines.push_back(Cpu::FormatTrace(reg, opcode, operand, cycles));
+    }
+
+    vector<string> lines;
+};
+
+static void RunNestest(Nes* nes, FlightRecorder* recorder, ITraceSink* sink,
+                       Nes::cpu_core core) {
+    nes->SetCpuCore(core);
+    nes->PowerOn();
+    nes->LoadRom("../../roms/nestest.nes");
+    // automated mode runs past the end of the tests into illegal opcodes
+    nes->Reset(Nes::EMU_MODE_AUTOMATED);
+    nes->SetFlightRecorder(recorder);
+    nes->SetTraceSink(sink);
+    for (int i = 0; i < 5 && !recorder->HasDumpedIllegal(); i++) {
+        nes->RunFrame();
+    }
+    nes->SetFlightRecorder(nullptr);
+    nes->SetTraceSink(nullptr);
+}
+
+static void CheckIllegalDump(Nes::cpu_core core) {
+    const char* filename = "test_flight_illegal.bin";
+    FlightRecorder recorder(256);
+    recorder.SetDumpFile(filename);
+    RecordSink sink;
+    Nes nes;
+    RunNestest(&nes, &recorder, &sink, core);
+    ASSERT_TRUE(recorder.HasDumpedIllegal());
+
+    flight_hdr header;
+    vector<flight_record> records;
+    vector<uint64_t> cycles;
+    ASSERT_TRUE(FlightRecorder::Load(filename, &header, &records, &cycles));
+    EXPECT_EQ(header.reason, (uint32_t)FLIGHT_REASON_ILLEGAL);
+    EXPECT_EQ(records.size(), 256u);
+    EXPECT_GT(header.total, 256u);
+
+    // the instructions in the dump are the tail of the trace, up to the jam
+    vector<string> traced;
+    int writes = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (records[i].type == FLIGHT_WRITE) {
+            writes++;
+            EXPECT_EQ(cycles[i], cycles[i - 1]);
+        } else {
+            ASSERT_EQ(records[i].type, FLIGHT_INSTRUCTION);
+            traced.push_back(FlightRecorder::Format(records[i], cycles[i]));
+        }
+    }
+    EXPECT_GT(writes, 0);
+    EXPECT_EQ(Cpu::GetOpcode(records.back().data).op, Cpu::OP_INVALID);
+
+    // the trace continued past the dump while the CPU stayed jammed
+    size_t end = 0;
+    while (end < sink.lines.size() && sink.lines[end] != traced.back()) {
+        end++;
+    }
+    ASSERT_LT(end, sink.lines.size());
+    ASSERT_GE(end + 1, traced.size());
+    for (size_t i = 0; i < traced.size(); i++) {
+        EXPECT_EQ(traced[i], sink.lines[end + 1 - traced.size() + i]);
+    }
+    remove(filename);
+}
+
+TEST(FlightTest, IllegalOpcode) {
+    CheckIllegalDump(Nes::CPU_CORE_FAST);
+}
+
+TEST(FlightTest, IllegalOpcodeCycleCore) {
+    CheckIllegalDump(Nes::CPU_CORE_CYCLE);
+}
+
+TEST(FlightTest, CycleWrap) {
+    const char* filename = "test_flight_wrap.bin";
+    FlightRecorder recorder(4);
+    registers reg = {};
+    const uint64_t counts[] = { 0xFFFFFFF0ull, 0x100000004ull, 0x1FFFFFFFFull, 0x200000003ull,
+                                0x300000001ull };
+    for (uint64_t count : counts) {
+        reg.PC++;
+        recorder.RecordInstruction(reg, 0xEA, 0, count);
+    }
+    recorder.RecordWrite(0x0200, 0x55);
+    ASSERT_TRUE(recorder.Dump(filename));
+
+    flight_hdr header;
+    vector<flight_record> records;
+    vector<uint64_t> cycles;
+    ASSERT_TRUE(FlightRecorder::Load(filename, &header, &records, &cycles));
+    EXPECT_EQ(header.reason, (uint32_t)FLIGHT_REASON_REQUEST);
+    EXPECT_EQ(header.total, 6u);
+    ASSERT_EQ(records.size(), 4u);
+    EXPECT_EQ(cycles[0], counts[2]);
+    EXPECT_EQ(cycles[1], counts[3]);
+    EXPECT_EQ(cycles[2], counts[4]);
+    EXPECT_EQ(cycles[3], counts[4]);
+    EXPECT_EQ(records[3].type, FLIGHT_WRITE);
+    EXPECT_EQ(FlightRecorder::Format(records[3], cycles[3]), "      $0200 <- 55  CPUC:12884901889");
+    remove(filename);
+}
+
+TEST(FlightTest, StateLoadMarker) {
+    const char* filename = "test_flight_load.bin";
+    FlightRecorder recorder(8);
+    registers reg = {};
+    recorder.RecordInstruction(reg, 0xEA, 0, 0x100000010ull);
+    recorder.RecordInstruction(reg, 0xEA, 0, 0x100000020ull);
+    recorder.OnStateLoad(0x100000030ull);    // forward: no marker
+    EXPECT_EQ(recorder.GetTotal(), 2u);
+    recorder.OnStateLoad(0x10);
+    recorder.RecordInstruction(reg, 0xEA, 0, 0x10);
+    recorder.RecordWrite(0x0300, 0x01);
+    ASSERT_TRUE(recorder.Dump(filename));
+
+    flight_hdr header;
+    vector<flight_record> records;
+    vector<uint64_t> cycles;
+    ASSERT_TRUE(FlightRecorder::Load(filename, &header, &records, &cycles));
+    ASSERT_EQ(records.size(), 5u);
+    EXPECT_EQ(records[2].type, FLIGHT_STATE_LOAD);
+    const uint64_t expected[] = { 0x100000010ull, 0x100000020ull, 0x100000020ull, 0x10, 0x10 };
+    for (size_t i = 0; i < records.size(); i++) {
+        EXPECT_EQ(cycles[i], expected[i]) << "record " << i;
+    }
+    remove(filename);
+}
+
+// Records at the opcode fetch, so JSR's pushes follow the JSR, and the
+// instructions match the instruction-at-a-time core's. Writes may not: the
+// cycle core also does the dummy writes of read-modify-write instructions.
+TEST(FlightTest, CycleCoreMatchesFastCore) {
+    const char* filenames[2] = { "test_flight_fast.bin", "test_flight_cycle.bin" };
+    const Nes::cpu_core cores[2] = { Nes::CPU_CORE_FAST, Nes::CPU_CORE_CYCLE };
+    vector<flight_record> records[2];
+    vector<uint64_t> cycles[2];
+    for (int c = 0; c < 2; c++) {
+        FlightRecorder recorder(FLIGHT_RECORDS * 4);   // the whole run
+        Nes nes;
+        nes.SetCpuCore(cores[c]);
+        nes.PowerOn();
+        nes.LoadRom("../../roms/nestest.nes");
+        nes.Reset(Nes::EMU_MODE_AUTOMATED);
+        nes.SetFlightRecorder(&recorder);
+        nes.RunCycles(20000);
+        ASSERT_TRUE(recorder.Dump(filenames[c]));
+        flight_hdr header;
+        ASSERT_TRUE(FlightRecorder::Load(filenames[c], &header, &records[c], &cycles[c]));
+        ASSERT_EQ(header.total, records[c].size());
+        remove(filenames[c]);
+    }
+
+    vector<string> lines[2];
+    for (int c = 0; c < 2; c++) {
+        for (size_t i = 0; i < records[c].size(); i++) {
+            if (records[c][i].type == FLIGHT_INSTRUCTION) {
+                lines[c].push_back(FlightRecorder::Format(records[c][i], cycles[c][i]));
+            } else {
+                // a write has the cycles of the instruction doing it
+                ASSERT_GT(i, 0u);
+                EXPECT_EQ(cycles[c][i], cycles[c][i - 1]);
+            }
+        }
+    }
+    EXPECT_EQ(lines[1], lines[0]);
+
+    int jsr = 0;
+    const vector<flight_record>& rec = records[1];
+    for (size_t i = 0; i + 2 < rec.size(); i++) {
+        if (rec[i].type == FLIGHT_INSTRUCTION && rec[i].data == 0x20) {
+            jsr++;
+            EXPECT_EQ(rec[i + 1].type, FLIGHT_WRITE);
+            EXPECT_EQ(rec[i + 1].addr >> 8, 0x01);
+            EXPECT_EQ(rec[i + 2].type, FLIGHT_WRITE);
+            EXPECT_EQ(cycles[1][i + 2], cycles[1][i]);
+        }
+    }
+    EXPECT_GT(jsr, 0);
+}
+
+TEST(FlightTest, FatalSignal) {
+    const char* filename = "test_flight_signal.bin";
+    remove(filename);
+    EXPECT_DEATH({
+        FlightRecorder recorder(16);
+        recorder.SetDumpFile(filename);
+        FlightRecorder::InstallSignalHandlers(&recorder);
+        registers reg = {};
+        recorder.RecordInstruction(reg, 0x02, 0, 1234);
+        raise(SIGSEGV);
+    }, "");
+
+    flight_hdr header;
+    vector<flight_record> records;
+    vector<uint64_t> cycles;
+    ASSERT_TRUE(FlightRecorder::Load(filename, &header, &records, &cycles));
+    EXPECT_EQ(header.reason, (uint32_t)FLIGHT_REASON_SIGNAL);
+    EXPECT_EQ(header.signal, (uint32_t)SIGSEGV);
+    ASSERT_EQ(records.size(), 1u);
+    EXPECT_EQ(cycles[0], 1234u);
+    remove(filename);
+}
+
+TEST(FlightTest, SignalKeepsErrno) {
+    const char* filename = "test_flight_usr1.bin";
+    remove(filename);
+    // SIGUSR1 returns to the interrupted code, which may be reading errno
+    EXPECT_EXIT({
+        FlightRecorder recorder(16);
+        recorder.SetDumpFile(filename);
+        FlightRecorder::InstallSignalHandlers(&recorder);
+        errno = ERANGE;
+        raise(SIGUSR1);
+        exit(errno == ERANGE ? 0 : 1);
+    }, testing::ExitedWithCode(0), "");
+
+    flight_hdr header;
+    vector<flight_record> records;
+    vector<uint64_t> cycles;
+    ASSERT_TRUE(FlightRecorder::Load(filename, &header, &records, &cycles));
+    EXPECT_EQ(header.signal, (uint32_t)SIGUSR1);
+    remove(filename);
+}
+
+TEST(FlightTest, DamagedCount) {
+    const char* filename = "test_flight_damaged.bin";
+    FlightRecorder recorder(4);
+    registers reg = {};
+    for (int i = 0; i < 4; i++) {
+        recorder.RecordInstruction(reg, 0xEA, 0, i * 2);
+    }
+    ASSERT_TRUE(recorder.Dump(filename));
+
+    flight_hdr header;
+    vector<flight_record> records;
+    vector<uint64_t> cycles;
+    const uint32_t counts[] = { 5, 0xFFFFFFFF };
+    for (uint32_t count : counts) {
+        fstream file(filename, ios::in | ios::out | ios::binary);
+        file.seekp(offsetof(flight_hdr, count));
+        file.write((const char*)&count, sizeof(count));
+        file.close();
+        EXPECT_FALSE(FlightRecorder::Load(filename, &header, &records, &cycles)) << count;
+    }
+    remove(filename);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
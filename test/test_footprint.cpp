@@ -0,0 +1,79 @@
+#include "Nes.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <memory>
+
+using namespace std;
+
+// Reads back its id; remembers the last write.
+class TagUnit : public IMemoryUnit {
+public:
+    TagUnit(uint8_t id) : id(id), last_addr(0), last_data(0) { memset(page, 0, sizeof(page)); }
+
+    virtual uint8_t Read8(uint16_t addr) { return id; }
+    virtual void Write8(uint16_t addr, uint8_t data) { last_addr = addr; last_data = data; }
+    virtual const uint8_t* GetPage(uint16_t addr) { return page; }
+
+    uint8_t id;
+    uint16_t last_addr;
+    uint8_t last_data;
+    uint8_t page[0x100];
+};
+
+TEST(FootprintTest, Instance) {
+    // one block of a few tens of KB, on a cache line when on the heap
+    EXPECT_LT(sizeof(Nes), 32768u);
+    unique_ptr<Nes> nes(new Nes);
+    EXPECT_EQ((uintptr_t)nes.get() % NES_ALIGNMENT, 0u);
+}
+
+TEST(FootprintTest, SharedRomImage) {
+    unique_ptr<Cartridge> a(new Cartridge(nullptr, nullptr));
+    unique_ptr<Cartridge> b(new Cartridge(nullptr, nullptr));
+    ASSERT_TRUE(a->LoadRom("../../roms/nestest.nes"));
+    ASSERT_TRUE(b->LoadRom("../../roms/nestest.nes"));
+    EXPECT_EQ(a->GetRomImage(), b->GetRomImage());
+    EXPECT_EQ(a->Read8(0xC000), 0x4C);
+
+    // the image outlives the cartridge that loaded it first
+    a = nullptr;
+    EXPECT_EQ(b->Read8(0xC000), 0x4C);
+    EXPECT_EQ(b->GetPrgRom().size(), 0x4000u);
+}
+
+TEST(FootprintTest, MixedPages) {
+    TagUnit low(1), dma(2), pad(3), cart(4);
+    Debugger debugger(nullptr);
+    Mmu mmu(nullptr, &debugger);
+    mmu.AddMemoryMap(&mmu, 0x0000, 0x1FFF);
+    mmu.AddMemoryMap(&low, 0x2000, 0x3FFF);
+    mmu.AddMemoryMap(&dma, 0x4014, 0x4014);
+    mmu.AddMemoryMap(&pad, 0x4016, 0x4017);
+    mmu.AddMemoryMap(&cart, 0x4020, 0xFFFF);
+
+    EXPECT_EQ(mmu.Read8(0x3FFF), 1);
+    EXPECT_EQ(mmu.Read8(0x4000), 0);
+    EXPECT_EQ(mmu.Read8(0x4014), 2);
+    EXPECT_EQ(mmu.Read8(0x4015), 0);
+    EXPECT_EQ(mmu.Read8(0x4016), 3);
+    EXPECT_EQ(mmu.Read8(0x4017), 3);
+    EXPECT_EQ(mmu.Read8(0x401F), 0);
+    EXPECT_EQ(mmu.Read8(0x4020), 4);
+    EXPECT_EQ(mmu.Read8(0xFFFF), 4);
+
+    mmu.Write8(0x4016, 0x01);
+    EXPECT_EQ(pad.last_addr, 0x4016);
+    EXPECT_EQ(pad.last_data, 0x01);
+    mmu.Write8(0x40FF, 0x22);
+    EXPECT_EQ(cart.last_addr, 0x40FF);
+
+    // only pages owned by one unit are handed out whole
+    EXPECT_EQ(mmu.GetPage(0x4000), nullptr);
+    EXPECT_EQ(mmu.GetPage(0x2100), low.page);
+    EXPECT_EQ(mmu.GetPage(0x4100), cart.page);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,35 @@
+#include "CpuFuzzer.h"
+#include <gtest/gtest.h>
+
+using namespace std;
+
+TEST(CpuFuzzTest, RefCpuCoverage) {
+    // 151 official opcodes plus the 80 stable unofficial ones
+    int official = 0;
+    for (int op = 0; op < 256; op++) {
+        official += RefCpu::IsSupported(op);
+    }
+    EXPECT_EQ(official, 151 + 80);
+    EXPECT_EQ(CpuFuzzer::GetOpcodes().size(), (size_t)official);
+    // Cpu implements every opcode the reference does
+    for (uint8_t op : CpuFuzzer::GetOpcodes()) {
+        EXPECT_NE(Cpu::GetOpcode(op).op, Cpu::OP_INVALID) << "opcode " << hex << (int)op;
+    }
+}
+
+TEST(CpuFuzzTest, Smoke) {
+    fuzz_summary summary;
+    CpuFuzzer::RunParallel(2, 200000, 0, 0x6502, &summary);
+    ASSERT_FALSE(summary.failed) << summary.report;
+    EXPECT_EQ(summary.cases, 200000u);
+    for (uint8_t op : CpuFuzzer::GetOpcodes()) {
+        EXPECT_GT(summary.coverage[op], 0u) << "opcode " << hex << (int)op;
+    }
+}
+
+TEST(CpuFuzzTest, CycleCore) {
+    fuzz_summary summary;
+    CpuFuzzer::RunParallel(2, 100000, 0, 0x2A03, &summary, true);
+    ASSERT_FALSE(summary.failed) << summary.report;
+    EXPECT_EQ(summary.cases, 100000u);
+}
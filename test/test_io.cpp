@@ -0,0 +1,193 @@
+#include "Controller.h"
+#include "Cpu.h"
+#include "Debugger.h"
+#include "Mmu.h"
+#include "Ppu.h"
+#include "OamDma.h"
+#include "SaveRam.h"
+#include "MpscQueue.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+TEST(ControllerTest, ShiftRegister) {
+    Controller pads(nullptr);
+    pads.SetButtons(0, Controller::BUTTON_A | Controller::BUTTON_START | Controller::BUTTON_RIGHT);
+    pads.SetButtons(1, Controller::BUTTON_B);
+
+    pads.Write8(0x4016, 1);
+    EXPECT_EQ(pads.Read8(0x4016) & 1, 1);   // strobe high keeps returning A
+    EXPECT_EQ(pads.Read8(0x4016) & 1, 1);
+    pads.Write8(0x4016, 0);
+
+    const int expected0[8] = { 1, 0, 0, 1, 0, 0, 0, 1 };
+    const int expected1[8] = { 0, 1, 0, 0, 0, 0, 0, 0 };
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ(pads.Read8(0x4016) & 1, expected0[i]) << "bit " << i;
+        EXPECT_EQ(pads.Read8(0x4017) & 1, expected1[i]) << "bit " << i;
+    }
+    EXPECT_EQ(pads.Read8(0x4016) & 1, 1);
+    EXPECT_EQ(pads.Read8(0x4017) & 1, 1);
+}
+
+TEST(ControllerTest, QueueLatchesOneFramePerCall) {
+    Controller pads(nullptr);
+    input_frame input;
+    for (int i = 1; i <= 3; i++) {
+        input.buttons[0] = i;
+        input.buttons[1] = i << 4;
+        ASSERT_TRUE(pads.Submit(input));
+    }
+    for (int i = 1; i <= 3; i++) {
+        pads.Latch();
+        EXPECT_EQ(pads.GetButtons(0), i);
+        EXPECT_EQ(pads.GetButtons(1), i << 4);
+    }
+    pads.Latch();   // empty queue keeps the last input
+    EXPECT_EQ(pads.GetButtons(0), 3);
+}
+
+TEST(ControllerTest, QueueMultipleProducers) {
+    const int producers = 4;
+    const uint32_t count = 20000;
+    MpscQueue<uint32_t, 64> queue;
+    vector<thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&queue, p, count]() {
+            for (uint32_t i = 0; i < count; i++) {
+                while (!queue.Push((p << 24) | i)) {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // each producer's items arrive once and in order
+    vector<uint32_t> next(producers, 0);
+    uint32_t val;
+    for (uint32_t received = 0; received < producers * count; ) {
+        if (!queue.Pop(&val)) {
+            this_thread::yield();
+            continue;
+        }
+        // keep draining on a mismatch so the producers can finish
+        int p = (val >> 24) % producers;
+        EXPECT_EQ(val & 0xFFFFFF, next[p]);
+        next[p] = (val & 0xFFFFFF) + 1;
+        ++received;
+    }
+    for (thread& t : threads) {
+        t.join();
+    }
+    EXPECT_TRUE(queue.Empty());
+    EXPECT_FALSE(queue.Pop(&val));
+}
+
+TEST(OamDmaTest, CopiesPageAndStallsCpu) {
+    Debugger debugger(nullptr);
+    Mmu mmu(nullptr, &debugger);
+    Cpu cpu(nullptr, &mmu, &debugger);
+    Ppu ppu(nullptr);
+    OamDma dma(nullptr, &mmu, &cpu, &ppu, &debugger);
+    mmu.AddMemoryMap(&ppu, 0x2000, 0x3FFF);
+    mmu.AddMemoryMap(&dma, 0x4014, 0x4014);
+
+    for (int i = 0; i < 256; i++) {
+        mmu.Write8(0x0200 + i, i ^ 0x5A);
+    }
+    mmu.Write8(0x2003, 0x10);   // OAMADDR
+    mmu.Write8(0x4014, 0x02);
+
+    const uint8_t* oam = ppu.GetOam();
+    for (int i = 0; i < 256; i++) {
+        ASSERT_EQ(oam[(0x10 + i) & 0xFF], i ^ 0x5A) << "byte " << i;
+    }
+    EXPECT_EQ(cpu.GetCycles(), 513u);
+    mmu.Write8(0x4014, 0x02);   // starts on an odd cycle
+    EXPECT_EQ(cpu.GetCycles(), 513u + 514u);
+}
+
+TEST(OamDmaTest, ReadWatchpointFires) {
+    Debugger debugger(nullptr);
+    Mmu mmu(nullptr, &debugger);
+    Cpu cpu(nullptr, &mmu, &debugger);
+    Ppu ppu(nullptr);
+    OamDma dma(nullptr, &mmu, &cpu, &ppu, &debugger);
+    debugger.SetCpu(&cpu);
+    mmu.AddMemoryMap(&ppu, 0x2000, 0x3FFF);
+    mmu.AddMemoryMap(&dma, 0x4014, 0x4014);
+
+    for (int i = 0; i < 256; i++) {
+        mmu.Write8(0x0300 + i, i);
+    }
+    debugger.AddBreakpoint(BP_READ, 0x0380);
+    mmu.Write8(0x4014, 0x03);
+
+    ASSERT_TRUE(debugger.IsPaused());
+    EXPECT_EQ(debugger.GetHit().addr, 0x0380);
+    EXPECT_EQ(debugger.GetHit().data, 0x80);
+    // the transfer itself still completes
+    EXPECT_EQ(ppu.GetOam()[0xFF], 0xFF);
+}
+
+TEST(SaveRamTest, WritesReachFile) {
+    const char* sav = "test_io.sav";
+    remove(sav);
+    {
+        SaveRam ram;
+        ASSERT_TRUE(ram.Open(sav, 0x2000, 10));
+        for (int i = 0; i < 0x2000; i++) {
+            ram.GetData()[i] = i * 3;
+        }
+    }
+
+    ifstream file(sav, ios::in | ios::binary);
+    char buf[0x2000];
+    file.read(buf, sizeof(buf));
+    ASSERT_EQ(file.gcount(), (streamsize)sizeof(buf));
+    for (int i = 0; i < 0x2000; i++) {
+        ASSERT_EQ((uint8_t)buf[i], (uint8_t)(i * 3)) << "byte " << i;
+    }
+
+    SaveRam ram;
+    ASSERT_TRUE(ram.Open(sav, 0x2000));
+    EXPECT_EQ(ram.GetData()[5], 15);
+}
+
+TEST(SaveRamTest, OneWriterPerFile) {
+    const char* sav = "test_io_lock.sav";
+    remove(sav);
+    SaveRam writer;
+    ASSERT_TRUE(writer.Open(sav, 0x2000, 10));
+    EXPECT_TRUE(writer.IsWriteBack());
+    writer.GetData()[0] = 0x42;
+
+    SaveRam second;
+    EXPECT_FALSE(second.Open(sav, 0x2000));
+
+    // a copy starts from the file and keeps its writes to itself
+    ASSERT_TRUE(second.OpenCopy(sav, 0x2000));
+    EXPECT_FALSE(second.IsWriteBack());
+    EXPECT_EQ(second.GetData()[0], 0x42);
+    second.GetData()[0] = 0x17;
+    second.Close();
+    EXPECT_EQ(writer.GetData()[0], 0x42);
+    writer.Close();
+
+    ifstream file(sav, ios::in | ios::binary);
+    EXPECT_EQ(file.get(), 0x42);
+    file.close();
+
+    // the lock goes with the writer
+    ASSERT_TRUE(second.Open(sav, 0x2000));
+    remove(sav);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
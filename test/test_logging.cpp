@@ -0,0 +1,60 @@
+#include "Logging.h"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+TEST(LoggingTest, RingsOutliveThreads) {
+    const char* log = "test_logging.log";
+    const int threads = LOG_MAX_THREADS * 2;
+    LOG_INIT(log);
+    uint64_t dropped = Logging::Instance().GetDropped();
+
+    // more threads over time than rings, one alive at a time
+    for (int i = 0; i < threads; i++) {
+        thread t([i]() { Logging::Instance().Log(i); });
+        t.join();
+    }
+    LOG_FLUSH();
+    EXPECT_EQ(Logging::Instance().GetDropped(), dropped);
+
+    ifstream file(log);
+    string line;
+    vector<bool> seen(threads, false);
+    while (getline(file, line)) {
+        int i = stoi(line);
+        ASSERT_LT(i, threads);
+        seen[i] = true;
+    }
+    for (int i = 0; i < threads; i++) {
+        EXPECT_TRUE(seen[i]) << "thread " << i;
+    }
+}
+
+TEST(LoggingTest, RuntimeLevels) {
+    LOG_INIT("test_logging_levels.log");
+    Logging& logging = Logging::Instance();
+    EXPECT_TRUE(Logging::IsEnabled(LOG_CAT_MMU, LOG_LEVEL_TRACE));
+    logging.SetLevel(LOG_CAT_MMU, LOG_LEVEL_WARN);
+    EXPECT_TRUE(Logging::IsEnabled(LOG_CAT_MMU, LOG_LEVEL_WARN));
+    EXPECT_FALSE(Logging::IsEnabled(LOG_CAT_MMU, LOG_LEVEL_INFO));
+    EXPECT_TRUE(Logging::IsEnabled(LOG_CAT_PPU, LOG_LEVEL_INFO));
+
+    // levels are published to producer threads
+    bool info = true;
+    thread t([&info]() { info = Logging::IsEnabled(LOG_CAT_MMU, LOG_LEVEL_INFO); });
+    t.join();
+    EXPECT_FALSE(info);
+
+    logging.Close();
+    EXPECT_FALSE(Logging::IsEnabled(LOG_CAT_MMU, LOG_LEVEL_ERROR));
+    logging.SetLevel(LOG_CAT_MMU, LOG_LEVEL_TRACE);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
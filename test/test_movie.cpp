@@ -0,0 +1,104 @@
+#include "Nes.h"
+#include "Movie.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+static const char* rom = "../../roms/nestest.nes";
+static const char* movie_file = "test_movie.nmv";
+
+static void Boot(Nes& nes) {
+    nes.PowerOn();
+    nes.LoadRom(rom);
+    nes.Reset(Nes::EMU_MODE_AUTOMATED);
+}
+
+TEST(MovieTest, ReplayAndSeek) {
+    const uint64_t frames = 90;
+    const uint64_t seek_frame = 70;
+    nes_state seek_state, end_state, state;
+
+    {
+        Nes nes;
+        Boot(nes);
+        Movie movie(&nes);
+        ASSERT_TRUE(movie.Record(movie_file, 30));
+        for (uint64_t i = 0; i < frames; i++) {
+            if (i == seek_frame) {
+                nes.SaveState(&seek_state);
+            }
+            uint8_t input[NUM_PORTS] = { (uint8_t)i, (uint8_t)(i * 7) };
+            movie.RecordFrame(input);
+            nes.RunFrame();
+        }
+        nes.SaveState(&end_state);
+    }
+
+    Nes nes;
+    Boot(nes);
+    Movie movie(&nes);
+    ASSERT_TRUE(movie.Play(movie_file));
+    ASSERT_EQ(movie.GetFrameCount(), frames);
+    while (movie.PlayFrame()) {
+        ASSERT_EQ(nes.GetInput(1), (uint8_t)((movie.GetFrame() - 1) * 7));
+        nes.RunFrame();
+    }
+    EXPECT_FALSE(movie.IsDesynced());
+    nes.SaveState(&state);
+    EXPECT_EQ(memcmp(&state, &end_state, sizeof(state)), 0);
+
+    ASSERT_TRUE(movie.Seek(seek_frame));
+    EXPECT_EQ(movie.GetFrame(), seek_frame);
+    nes.SaveState(&state);
+    EXPECT_EQ(memcmp(&state, &seek_state, sizeof(state)), 0);
+}
+
+class CountingSink : public IFrameSink {
+public:
+    CountingSink() : frames(0) {}
+    virtual void OnFrame(Nes* nes) { frames++; }
+    int frames;
+};
+
+TEST(MovieTest, SeekIgnoresHostInput) {
+    const uint64_t seek_frame = 50;
+    nes_state seek_state, state;
+
+    {
+        Nes nes;
+        Boot(nes);
+        Movie movie(&nes);
+        ASSERT_TRUE(movie.Record(movie_file, 30));
+        for (uint64_t i = 0; i < seek_frame; i++) {
+            uint8_t input[NUM_PORTS] = { (uint8_t)(i * 3), (uint8_t)i };
+            movie.RecordFrame(input);
+            nes.RunFrame();
+        }
+        nes.SaveState(&seek_state);
+    }
+
+    Nes nes;
+    Boot(nes);
+    CountingSink sink;
+    nes.SetFrameSink(&sink);
+    Movie movie(&nes);
+    ASSERT_TRUE(movie.Play(movie_file));
+    // live input waiting for the next real frame must not leak into a seek
+    for (int i = 0; i < 8; i++) {
+        input_frame input = { { 0xFF, 0xFF } };
+        ASSERT_TRUE(nes.SubmitInput(input));
+    }
+    ASSERT_TRUE(movie.Seek(seek_frame));
+    EXPECT_FALSE(movie.IsDesynced());
+    EXPECT_EQ(sink.frames, 0);
+    nes.SaveState(&state);
+    EXPECT_EQ(memcmp(&state, &seek_state, sizeof(state)), 0);
+    remove(movie_file);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
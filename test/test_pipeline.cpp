@@ -0,0 +1,104 @@
+#include "Nes.h"
+#include "FramePipeline.h"
+#include "NtscFilter.h"
+#include "TripleBuffer.h"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+class RecordingOutput : public IVideoOutput {
+public:
+    virtual void OnVideoFrame(const uint32_t* rgb, int width, int height, uint64_t frame) {
+        frames.push_back(frame);
+        this->width = width;
+        this->height = height;
+        corner = rgb[width * height - 1];
+    }
+
+    vector<uint64_t> frames;
+    int width = 0;
+    int height = 0;
+    uint32_t corner = 0;
+};
+
+TEST(PipelineTest, TripleBuffer) {
+    TripleBuffer<int> buf;
+    EXPECT_FALSE(buf.Acquire());
+    *buf.GetBack() = 1;
+    EXPECT_FALSE(buf.Publish());
+    *buf.GetBack() = 2;
+    EXPECT_TRUE(buf.Publish());
+    ASSERT_TRUE(buf.Acquire());
+    EXPECT_EQ(*buf.GetFront(), 2);
+    EXPECT_FALSE(buf.Acquire());
+}
+
+TEST(PipelineTest, Frames) {
+    const int frames = 30;
+    RecordingOutput output;
+    FramePipeline pipeline(&output, 2);
+
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom("../../roms/nestest.nes");
+    nes.Reset();
+    nes.SetFrameSink(&pipeline);
+    pipeline.Start();
+    for (int i = 0; i < frames; i++) {
+        nes.RunFrame();
+    }
+    pipeline.Stop();
+
+    pipeline_stats stats = pipeline.GetStats();
+    EXPECT_EQ(stats.produced, (uint64_t)frames);
+    EXPECT_EQ(stats.presented + stats.skipped, stats.produced);
+    ASSERT_EQ(output.frames.size(), stats.presented);
+    for (size_t i = 1; i < output.frames.size(); i++) {
+        EXPECT_LT(output.frames[i - 1], output.frames[i]);
+    }
+    EXPECT_EQ(output.frames.back(), (uint64_t)frames);
+    EXPECT_EQ(output.width, PPU_WIDTH * 2);
+    EXPECT_EQ(output.height, PPU_HEIGHT * 2);
+    // the backdrop until rendering is emulated
+    EXPECT_EQ(output.corner, pipeline.GetPalette()->GetColor(0));
+}
+
+TEST(PipelineTest, Ntsc) {
+    NtscFilter ntsc;
+    Palette palette;
+    vector<uint8_t> in(PPU_WIDTH * PPU_HEIGHT);
+    vector<uint32_t> out(NTSC_WIDTH * NTSC_HEIGHT), out_scalar(out.size());
+
+    // flat fields decode close to the standard palette
+    for (int index : { 0x00, 0x16, 0x1A, 0x12, 0x30 }) {
+        fill(in.begin(), in.end(), index);
+        ntsc.Filter(in.data(), 0, 0, out.data());
+        uint32_t expected = palette.GetColor(index);
+        uint32_t actual = out[120 * NTSC_WIDTH + 256];
+        for (int shift = 0; shift < 24; shift += 8) {
+            EXPECT_NEAR((int)(actual >> shift) & 0xFF, (int)(expected >> shift) & 0xFF, 40)
+                << hex << index;
+        }
+    }
+
+    uint32_t seed = 1;
+    for (uint8_t& p : in) {
+        seed = seed * 1103515245 + 12345;
+        p = (seed >> 16) & 0x3F;
+    }
+    ntsc.Filter(in.data(), 5, 1, out.data());
+    ntsc.SetSimdEnabled(false);
+    ntsc.Filter(in.data(), 5, 1, out_scalar.data());
+    EXPECT_EQ(out, out_scalar);
+
+    // dot crawl: the same picture decodes differently on the next frame
+    ntsc.Filter(in.data(), 5, 2, out_scalar.data());
+    EXPECT_NE(out, out_scalar);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
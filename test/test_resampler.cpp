@@ -0,0 +1,70 @@
+#include "Resampler.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <vector>
+
+using namespace std;
+
+#define CHUNK   29830
+
+// Peak output level of a sine at freq after the filters have settled.
+static float Peak(Resampler::quality q, double freq, bool simd, vector<float>* out) {
+    Resampler resampler(APU_SAMPLE_RATE, HOST_SAMPLE_RATE, q);
+    resampler.SetSimdEnabled(simd);
+    vector<float> in(CHUNK);
+    vector<float> buf(CHUNK);
+    size_t t = 0;
+    out->clear();
+    for (int chunk = 0; chunk < 6; chunk++) {
+        for (float& s : in) {
+            s = (float)sin(2 * M_PI * freq * t++ / APU_SAMPLE_RATE);
+        }
+        size_t n = resampler.Process(in.data(), in.size(), buf.data(), buf.size());
+        out->insert(out->end(), buf.begin(), buf.begin() + n);
+    }
+    float peak = 0;
+    for (size_t i = out->size() / 2; i < out->size(); i++) {
+        peak = max(peak, fabs((*out)[i]));
+    }
+    return peak;
+}
+
+TEST(ResamplerTest, Response) {
+    vector<float> out, out_scalar;
+    for (int q = Resampler::QUALITY_LOW; q <= Resampler::QUALITY_HIGH; q++) {
+        Resampler::quality quality = (Resampler::quality)q;
+        // passband
+        EXPECT_NEAR(Peak(quality, 1000, true, &out), 1.0f, 0.02f) << q;
+        EXPECT_NEAR((double)out.size(), 6 * CHUNK * HOST_SAMPLE_RATE / APU_SAMPLE_RATE, 2) << q;
+        // above the host Nyquist rate, would alias to 8 kHz
+        EXPECT_LT(Peak(quality, 40000, true, &out), 0.05f) << q;
+
+        Peak(quality, 5000, false, &out_scalar);
+        Peak(quality, 5000, true, &out);
+        ASSERT_EQ(out.size(), out_scalar.size());
+        for (size_t i = 0; i < out.size(); i++) {
+            ASSERT_NEAR(out[i], out_scalar[i], 1e-5f);
+        }
+    }
+}
+
+TEST(ResamplerTest, RateScale) {
+    Resampler resampler;
+    resampler.SetRateScale(1.01);
+    vector<float> in(CHUNK * 4, 0.25f);
+    vector<float> out(in.size());
+    size_t n = resampler.Process(in.data(), in.size(), out.data(), out.size());
+    EXPECT_NEAR((double)n, in.size() * 1.01 * HOST_SAMPLE_RATE / APU_SAMPLE_RATE, 2);
+    EXPECT_NEAR((double)n, (double)resampler.GetOutputCount(in.size()), 2);
+    EXPECT_NEAR(out[n - 1], 0.25f, 1e-4f);
+
+    // output that doesn't fit comes out on the next call
+    size_t small = resampler.Process(in.data(), CHUNK, out.data(), 10);
+    EXPECT_EQ(small, 10u);
+    EXPECT_GT(resampler.Process(nullptr, 0, out.data(), out.size()), 0u);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+#include "Nes.h"
+#include "Rewind.h"
+#include "DeltaCodec.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+TEST(DeltaCodecTest, RoundTrip) {
+    vector<uint8_t> prev(4096), cur(4096), out(DeltaCodec::Bound(4096));
+    uint32_t seed = 1;
+    for (size_t i = 0; i < prev.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        prev[i] = seed >> 16;
+        cur[i] = (seed & 0x300) ? prev[i] : (uint8_t)(seed >> 24);
+    }
+
+    size_t size = DeltaCodec::Encode(cur.data(), prev.data(), cur.size(), out.data());
+    ASSERT_LE(size, out.size());
+
+    vector<uint8_t> buf = prev;
+    ASSERT_TRUE(DeltaCodec::Apply(buf.data(), buf.size(), out.data(), size));
+    EXPECT_EQ(buf, cur);
+    ASSERT_TRUE(DeltaCodec::Apply(buf.data(), buf.size(), out.data(), size));
+    EXPECT_EQ(buf, prev);
+
+    EXPECT_EQ(DeltaCodec::Encode(cur.data(), cur.data(), cur.size(), out.data()), 0u);
+}
+
+TEST(RewindTest, StepBack) {
+    const int frames = 8;
+    vector<nes_state> states(frames);
+    nes_state state;
+
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom("../../roms/nestest.nes");
+    nes.Reset(Nes::EMU_MODE_AUTOMATED);
+
+    // small arena so the ring wraps and drops old frames
+    Rewind rewind(&nes, 4 * DeltaCodec::Bound(sizeof(nes_state)));
+    for (int i = 0; i < frames; i++) {
+        nes.RunFrame();
+        nes.SaveState(&states[i]);
+        rewind.Capture();
+    }
+
+    ASSERT_GT(rewind.GetFrameCount(), 0u);
+    int i = frames - 1;
+    while (rewind.StepBack()) {
+        --i;
+        nes.SaveState(&state);
+        ASSERT_EQ(memcmp(&state, &states[i], sizeof(state)), 0) << "frame " << i;
+    }
+    EXPECT_EQ(rewind.GetFrameCount(), 0u);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
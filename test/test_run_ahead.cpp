@@ -0,0 +1,139 @@
+#include "Nes.h"
+#include "RunAhead.h"
+#include "ITraceSink.h"
+#include "FlightRecorder.h"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+static const char* rom = "../../roms/nestest.nes";
+
+class CycleSink : public ITraceSink {
+public:
+    void OnInstruction(const registers& reg, uint8_t opcode, uint16_t operand,
+                       uint64_t cycles) override {
+        pc.push_back(reg.PC);
+        this->cycles.push_back(cycles);
+    }
+    vector<uint16_t> pc;
+    vector<uint64_t> cycles;
+};
+
+static void Boot(Nes& nes) {
+    nes.PowerOn();
+    nes.LoadRom(rom);
+    nes.Reset();
+}
+
+// the menu reacts to the pad, so the input reaches the real frames
+static void SetInput(Nes& nes, int frame) {
+    nes.SetInput(0, (frame % 16 < 2) ? 0x10 << ((frame / 16) & 3) : 0);
+}
+
+TEST(RunAheadTest, MatchesPlainRun) {
+    const int frames = 40;
+
+    for (int ahead = 1; ahead <= 3; ahead += 2) {
+        Nes plain, nes;
+        CycleSink plain_trace, trace;
+        FlightRecorder plain_recorder(1024), recorder(1024);
+        Boot(plain);
+        Boot(nes);
+        plain.SetTraceSink(&plain_trace);
+        nes.SetTraceSink(&trace);
+        plain.SetFlightRecorder(&plain_recorder);
+        nes.SetFlightRecorder(&recorder);
+
+        RunAhead run_ahead(&nes, ahead);
+        for (int i = 0; i < frames; i++) {
+            SetInput(plain, i);
+            plain.RunFrame();
+            SetInput(nes, i);
+            run_ahead.RunFrame();
+        }
+
+        EXPECT_EQ(nes.GetFrame(), plain.GetFrame());
+        EXPECT_EQ(nes.GetCycles(), plain.GetCycles());
+        EXPECT_EQ(memcmp(nes.GetRam(), plain.GetRam(), RAM_SIZE), 0);
+        nes_state state, plain_state;
+        nes.SaveState(&state);
+        plain.SaveState(&plain_state);
+        EXPECT_EQ(memcmp(&state, &plain_state, sizeof(state)), 0);
+
+        // only the real frames reach the trace and the recorder
+        ASSERT_FALSE(trace.cycles.empty());
+        EXPECT_EQ(trace.pc, plain_trace.pc);
+        EXPECT_EQ(trace.cycles, plain_trace.cycles);
+        EXPECT_LT(trace.cycles.back(), nes.GetCycles());
+        EXPECT_EQ(recorder.GetTotal(), plain_recorder.GetTotal());
+        EXPECT_EQ(run_ahead.GetStats().frames, (uint64_t)frames);
+    }
+}
+
+TEST(RunAheadTest, BreakpointInRealFrame) {
+    Nes plain, nes;
+    Boot(plain);
+    Boot(nes);
+    int plain_id = plain.GetDebugger()->AddBreakpoint(BP_READ, 0x4016);
+    int id = nes.GetDebugger()->AddBreakpoint(BP_READ, 0x4016);
+    RunAhead run_ahead(&nes, 2);
+
+    int i;
+    for (i = 0; i < 100 && !plain.IsPaused(); i++) {
+        plain.RunFrame();
+    }
+    ASSERT_TRUE(plain.IsPaused());
+    for (i = 0; i < 100 && !nes.IsPaused(); i++) {
+        run_ahead.RunFrame();
+    }
+    ASSERT_TRUE(nes.IsPaused());
+
+    // the pause is the real one, not a frame that gets rolled back
+    EXPECT_EQ(nes.GetDebugger()->GetHit().cycles, plain.GetDebugger()->GetHit().cycles);
+    EXPECT_EQ(nes.GetCycles(), plain.GetCycles());
+    EXPECT_EQ(nes.GetFrame(), plain.GetFrame());
+
+    plain.GetDebugger()->RemoveBreakpoint(plain_id);
+    plain.GetDebugger()->Resume();
+    nes.GetDebugger()->RemoveBreakpoint(id);
+    nes.GetDebugger()->Resume();
+    for (i = 0; i < 10; i++) {
+        plain.RunFrame();
+        run_ahead.RunFrame();
+    }
+    EXPECT_FALSE(nes.IsPaused());
+    EXPECT_EQ(nes.GetCycles(), plain.GetCycles());
+    EXPECT_EQ(memcmp(nes.GetRam(), plain.GetRam(), RAM_SIZE), 0);
+}
+
+TEST(RunAheadTest, KeepsDisabledBreakpointsAndCdl) {
+    Nes nes;
+    Boot(nes);
+    nes.GetDebugger()->AddBreakpoint(BP_EXEC, 0x0000, 0xFFFF);
+    nes.GetDebugger()->SetEnabled(false);
+    nes.GetCodeDataLogger()->SetEnabled(false);
+    RunAhead run_ahead(&nes, 2);
+
+    for (int i = 0; i < 3; i++) {
+        run_ahead.RunFrame();
+    }
+    EXPECT_FALSE(nes.GetDebugger()->IsEnabled());
+    EXPECT_FALSE(nes.GetCodeDataLogger()->IsEnabled());
+    EXPECT_FALSE(nes.IsPaused());
+    EXPECT_EQ(nes.GetFrame(), 3u);
+
+    // and enabled ones come back enabled
+    nes.GetDebugger()->ClearBreakpoints();
+    nes.GetDebugger()->SetEnabled(true);
+    nes.GetCodeDataLogger()->SetEnabled(true);
+    run_ahead.RunFrame();
+    EXPECT_TRUE(nes.GetDebugger()->IsEnabled());
+    EXPECT_TRUE(nes.GetCodeDataLogger()->IsEnabled());
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
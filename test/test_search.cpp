@@ -0,0 +1,99 @@
+#include "Nes.h"
+#include "InputSearch.h"
+#include "StateHash.h"
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace std;
+
+#define ROM "../../roms/nestest.nes"
+
+// Arbitrary but deterministic, so any path the search claims can be checked.
+class RamHashScore : public ISearchScore {
+public:
+    virtual double Score(const uint8_t* ram) {
+        return (double)(StateHash::Compute(ram, RAM_SIZE) >> 12);
+    }
+};
+
+static void Search(int threads, nes_state* start, vector<uint8_t>* path, double* score,
+                   search_stats* stats) {
+    RamHashScore scorer;
+    search_config config = InputSearch::DefaultConfig();
+    config.depth = 6;
+    config.frames_per_step = 2;
+    config.beam_width = 8;
+    config.threads = threads;
+    InputSearch search(ROM, &scorer, config);
+    ASSERT_TRUE(search.IsLoaded());
+
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom(ROM);
+    nes.Reset();
+    nes.RunFrame(false);
+    nes.SaveState(start);
+    *score = search.Run(*start, path);
+    *stats = search.GetStats();
+}
+
+TEST(InputSearchTest, Beam) {
+    nes_state start;
+    vector<uint8_t> path, path_mt;
+    double score, score_mt;
+    search_stats stats, stats_mt;
+
+    Search(1, &start, &path, &score, &stats);
+    Search(3, &start, &path_mt, &score_mt, &stats_mt);
+    EXPECT_EQ(score, score_mt);
+    EXPECT_EQ(path, path_mt);
+    EXPECT_EQ(stats.expanded, stats_mt.expanded);
+    EXPECT_EQ(stats.duplicates, stats_mt.duplicates);
+    EXPECT_GT(stats.duplicates, 0u);
+    EXPECT_EQ(stats.dropped, 0u);
+    ASSERT_FALSE(path.empty());
+
+    // replaying the path reaches the reported score
+    RamHashScore scorer;
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom(ROM);
+    nes.LoadState(&start);
+    for (uint8_t input : path) {
+        nes.SetInput(0, input);
+        nes.SetInput(1, 0);
+        nes.RunFrame(false, false);
+    }
+    EXPECT_EQ(scorer.Score(nes.GetRam()), score);
+}
+
+TEST(InputSearchTest, WorkersSurviveRuns) {
+    RamHashScore scorer;
+    search_config config = InputSearch::DefaultConfig();
+    config.depth = 4;
+    config.beam_width = 4;
+    config.threads = 3;
+    InputSearch search(ROM, &scorer, config);
+    ASSERT_TRUE(search.IsLoaded());
+
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom(ROM);
+    nes.Reset();
+    nes.RunFrame(false);
+    nes_state start;
+    nes.SaveState(&start);
+
+    // the same pool threads run every step of both searches
+    vector<uint8_t> path, again;
+    double score = search.Run(start, &path);
+    uint64_t expanded = search.GetStats().expanded;
+    EXPECT_EQ(search.Run(start, &again), score);
+    EXPECT_EQ(again, path);
+    EXPECT_EQ(search.GetStats().expanded, expanded);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
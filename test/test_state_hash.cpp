@@ -0,0 +1,49 @@
+#include "Nes.h"
+#include "StateHash.h"
+#include <gtest/gtest.h>
+#include <cstring>
+
+using namespace std;
+
+TEST(StateHashTest, Xxh64) {
+    const char* text = "Nobody inspects the spammish repetition";
+    EXPECT_EQ(StateHash::Compute("", 0), 0xEF46DB3751D8E999ull);
+    EXPECT_EQ(StateHash::Compute("abc", 3), 0x44BC2CF5AD770999ull);
+    EXPECT_EQ(StateHash::Compute(text, strlen(text)), 0xFBCEA83C8A378BF1ull);
+}
+
+TEST(StateHashTest, Incremental) {
+    nes_state state, first;
+
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom("../../roms/nestest.nes");
+    nes.Reset(Nes::EMU_MODE_AUTOMATED);
+    nes.SetPC(0xC000);
+
+    // every frame of nestest writes RAM, and the hash must follow it
+    uint64_t prev = nes.GetStateHash();
+    nes.SaveState(&first);
+    EXPECT_EQ(prev, StateHash::Hash(first));
+    for (int i = 0; i < 4; i++) {
+        nes.RunFrame(false);
+        uint64_t hash = nes.GetStateHash();
+        nes.SaveState(&state);
+        EXPECT_EQ(hash, StateHash::Hash(state));
+        EXPECT_NE(hash, prev);
+        prev = hash;
+    }
+
+    // memory changed behind the bus
+    nes.LoadState(&first);
+    EXPECT_EQ(nes.GetStateHash(), StateHash::Hash(first));
+
+    state = first;
+    state.mmu.ram[0x7FF] ^= 1;
+    EXPECT_NE(StateHash::Hash(state), StateHash::Hash(first));
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
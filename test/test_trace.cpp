@@ -0,0 +1,274 @@
+#include "Nes.h"
+#include "LzCodec.h"
+#include "TraceArchive.h"
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+using namespace std;
+
+class RecordSink : public ITraceSink {
+public:
+    void OnInstruction(const registers& reg, uint8_t opcode, uint16_t operand,
+                       uint64_t cycles) override {
+        trace_record rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.reg = reg;
+        rec.opcode = opcode;
+        rec.operand = operand;
+        rec.cycles = cycles;
+        records.push_back(rec);
+    }
+
+    vector<trace_record> records;
+};
+
+// Both sinks at once: the writer is called first.
+class TeeSink : public ITraceSink {
+public:
+    TeeSink(ITraceSink* a, ITraceSink* b) : a_(a), b_(b) {}
+
+    void OnInstruction(const registers& reg, uint8_t opcode, uint16_t operand,
+                       uint64_t cycles) override {
+        a_->OnInstruction(reg, opcode, operand, cycles);
+        b_->OnInstruction(reg, opcode, operand, cycles);
+    }
+
+private:
+    ITraceSink* a_;
+    ITraceSink* b_;
+};
+
+static void ExpectSame(const trace_record& a, const trace_record& b) {
+    EXPECT_EQ(a.cycles, b.cycles);
+    EXPECT_EQ(a.opcode, b.opcode);
+    EXPECT_EQ(a.operand, b.operand);
+    EXPECT_EQ(a.reg.A, b.reg.A);
+    EXPECT_EQ(a.reg.X, b.reg.X);
+    EXPECT_EQ(a.reg.Y, b.reg.Y);
+    EXPECT_EQ(a.reg.PC, b.reg.PC);
+    EXPECT_EQ(a.reg.SP, b.reg.SP);
+    EXPECT_EQ(a.reg.P, b.reg.P);
+}
+
+static void RoundTrip(const vector<uint8_t>& data) {
+    vector<uint8_t> packed(LzCodec::Bound(data.size()));
+    size_t size = LzCodec::Compress(data.data(), data.size(), packed.data());
+    ASSERT_LE(size, packed.size());
+
+    vector<uint8_t> out(data.size());
+    EXPECT_TRUE(LzCodec::Decompress(packed.data(), size, out.data(), out.size()));
+    EXPECT_EQ(out, data);
+    if (!data.empty()) {
+        EXPECT_FALSE(LzCodec::Decompress(packed.data(), size, out.data(), out.size() - 1));
+    }
+}
+
+TEST(TraceTest, LzCodec) {
+    mt19937 rng(1);
+    vector<uint8_t> data;
+
+    RoundTrip(data);
+    data.assign(3, 7);
+    RoundTrip(data);
+    data.assign(100000, 0x55);
+    RoundTrip(data);
+    data.clear();
+    for (int i = 0; i < 100000; i++) {
+        data.push_back(rng());
+    }
+    RoundTrip(data);
+    for (int i = 0; i < 100000; i++) {
+        data[i] = (i % 1000 < 500) ? rng() % 4 : data[i % 977];
+    }
+    RoundTrip(data);
+}
+
+TEST(TraceTest, Windows) {
+    const char* filename = "test_trace.ntr";
+    RecordSink recorded;
+    TraceWriter writer;
+    TeeSink tee(&writer, &recorded);
+    ASSERT_TRUE(writer.Open(filename, 1000));
+
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom("../../roms/nestest.nes");
+    nes.Reset(Nes::EMU_MODE_AUTOMATED);
+    nes.SetPC(0xC000);
+    nes.SetTraceSink(&tee);
+    for (int i = 0; i < 3; i++) {
+        nes.RunFrame();
+    }
+    nes.SetTraceSink(nullptr);
+    ASSERT_TRUE(writer.Close());
+
+    const vector<trace_record>& all = recorded.records;
+    ASSERT_GT(all.size(), 5000u);
+    EXPECT_EQ(all[0].reg.PC, 0xC000);
+
+    TraceReader reader;
+    ASSERT_TRUE(reader.Open(filename));
+    EXPECT_FALSE(reader.IsRecovered());
+    EXPECT_EQ(reader.GetInstructionCount(), all.size());
+    EXPECT_EQ(reader.GetChunkCount(), (all.size() + 999) / 1000);
+    EXPECT_EQ(reader.GetFirstCycles(), all.front().cycles);
+    EXPECT_EQ(reader.GetLastCycles(), all.back().cycles);
+
+    // windows inside a chunk, across chunk boundaries, and past the end
+    const size_t windows[][2] = {
+        { 0, all.size() }, { 10, 20 }, { 990, 2010 }, { 4321, 4322 }, { all.size() - 5, all.size() }
+    };
+    for (const auto& w : windows) {
+        uint64_t from = all[w[0]].cycles;
+        uint64_t to = w[1] < all.size() ? all[w[1]].cycles : ~0ull;
+        vector<trace_record> records;
+        ASSERT_TRUE(reader.Read(from, to, &records));
+        ASSERT_EQ(records.size(), w[1] - w[0]);
+        for (size_t i = 0; i < records.size(); i++) {
+            ExpectSame(records[i], all[w[0] + i]);
+        }
+    }
+    vector<trace_record> records;
+    ASSERT_TRUE(reader.Read(all.back().cycles + 1, ~0ull, &records));
+    EXPECT_TRUE(records.empty());
+    reader.Close();
+    remove(filename);
+}
+
+TEST(TraceTest, MissingIndex) {
+    const char* filename = "test_trace_cut.ntr";
+    RecordSink recorded;
+    TraceWriter writer;
+    TeeSink tee(&writer, &recorded);
+    ASSERT_TRUE(writer.Open(filename, 500));
+
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom("../../roms/nestest.nes");
+    nes.Reset(Nes::EMU_MODE_AUTOMATED);
+    nes.SetPC(0xC000);
+    nes.SetTraceSink(&tee);
+    nes.RunFrame();
+    nes.SetTraceSink(nullptr);
+    ASSERT_TRUE(writer.Close());
+
+    // drop the index and footer, as if the run had been killed
+    ifstream in(filename, ios::binary);
+    vector<char> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    size_t chunks = (recorded.records.size() + 499) / 500;
+    data.resize(data.size() - sizeof(trace_footer) - chunks * sizeof(trace_index_entry));
+    ofstream out(filename, ios::binary | ios::trunc);
+    out.write(data.data(), data.size());
+    out.close();
+
+    TraceReader reader;
+    ASSERT_TRUE(reader.Open(filename));
+    EXPECT_TRUE(reader.IsRecovered());
+    EXPECT_EQ(reader.GetChunkCount(), chunks);
+    vector<trace_record> records;
+    ASSERT_TRUE(reader.Read(0, ~0ull, &records));
+    ASSERT_EQ(records.size(), recorded.records.size());
+    ExpectSame(records.back(), recorded.records.back());
+    reader.Close();
+    remove(filename);
+}
+
+TEST(TraceTest, DamagedIndexCount) {
+    const char* filename = "test_trace_count.ntr";
+    RecordSink recorded;
+    TraceWriter writer;
+    TeeSink tee(&writer, &recorded);
+    ASSERT_TRUE(writer.Open(filename, 500));
+
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom("../../roms/nestest.nes");
+    nes.Reset(Nes::EMU_MODE_AUTOMATED);
+    nes.SetPC(0xC000);
+    nes.SetTraceSink(&tee);
+    nes.RunFrame();
+    nes.SetTraceSink(nullptr);
+    ASSERT_TRUE(writer.Close());
+
+    // a count past the end of the file falls back to scanning the chunks
+    size_t chunks = (recorded.records.size() + 499) / 500;
+    const uint64_t counts[] = { chunks + 1, ~0ull / sizeof(trace_index_entry) };
+    for (uint64_t count : counts) {
+        fstream file(filename, ios::in | ios::out | ios::binary);
+        file.seekp(-(streamoff)sizeof(trace_footer) + (streamoff)offsetof(trace_footer, chunk_count),
+                   ios::end);
+        file.write((const char*)&count, sizeof(count));
+        file.close();
+
+        TraceReader reader;
+        ASSERT_TRUE(reader.Open(filename));
+        EXPECT_TRUE(reader.IsRecovered());
+        EXPECT_EQ(reader.GetChunkCount(), chunks);
+        vector<trace_record> records;
+        ASSERT_TRUE(reader.Read(0, ~0ull, &records));
+        EXPECT_EQ(records.size(), recorded.records.size());
+        reader.Close();
+    }
+    remove(filename);
+}
+
+TEST(TraceTest, CyclesGoBack) {
+    const char* filename = "test_trace_back.ntr";
+    RecordSink recorded;
+    TraceWriter writer;
+    TeeSink tee(&writer, &recorded);
+    ASSERT_TRUE(writer.Open(filename, 1000));
+
+    Nes nes;
+    nes.PowerOn();
+    nes.LoadRom("../../roms/nestest.nes");
+    nes.Reset(Nes::EMU_MODE_AUTOMATED);
+    nes.SetPC(0xC000);
+    nes.SetTraceSink(&tee);
+    nes.RunFrame();
+    nes_state state;
+    nes.SaveState(&state);
+    uint64_t from = nes.GetCycles();
+    nes.RunFrame();
+    size_t first_pass = recorded.records.size();
+    // the second frame again, from the middle of a chunk
+    nes.LoadState(&state);
+    nes.RunFrame();
+    nes.SetTraceSink(nullptr);
+    ASSERT_TRUE(writer.Close());
+
+    const vector<trace_record>& all = recorded.records;
+    size_t pass = all.size() - first_pass;
+    ASSERT_GT(pass, 0u);
+    uint64_t to = all.back().cycles + 1;
+
+    TraceReader reader;
+    ASSERT_TRUE(reader.Open(filename));
+    EXPECT_EQ(reader.GetInstructionCount(), all.size());
+    EXPECT_EQ(reader.GetLastCycles(), all.back().cycles);
+
+    // both passes over the second frame, in recording order
+    vector<trace_record> records;
+    ASSERT_TRUE(reader.Read(from, to, &records));
+    ASSERT_EQ(records.size(), 2 * pass);
+    for (size_t i = 0; i < records.size(); i++) {
+        ExpectSame(records[i], all[first_pass - pass + i]);
+    }
+    records.clear();
+    ASSERT_TRUE(reader.Read(0, ~0ull, &records));
+    ASSERT_EQ(records.size(), all.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        ExpectSame(records[i], all[i]);
+    }
+    reader.Close();
+    remove(filename);
+}
+
+int main(int argc, char* argv[]) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,35 @@
+#include "Cartridge.h"
+#include "CodeDataLogger.h"
+#include <iostream>
+
+using namespace std;
+
+// nes_cdl_merge <rom> <out.cdl> <in.cdl...>
+// ORs the coverage of many runs into one CDL file sized for rom.
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        cout << "usage: " << argv[0] << " <rom> <out.cdl> <in.cdl...>" << endl;
+        return 1;
+    }
+
+    Cartridge cartridge(nullptr, nullptr);
+    cartridge.LoadRom(argv[1]);
+    if (cartridge.GetPrgRom().empty()) {
+        return 1;
+    }
+    CodeDataLogger* cdl = cartridge.GetCodeDataLogger();
+    cdl->Reset(cartridge.GetPrgRom().size(), cartridge.GetChrRom().size());
+
+    for (int i = 3; i < argc; i++) {
+        if (!cdl->Merge(argv[i])) {
+            cout << "Skipping " << argv[i] << ": not a CDL file of this ROM" << endl;
+        }
+    }
+    if (!cdl->Save(argv[2])) {
+        cout << "Cannot write " << argv[2] << endl;
+        return 1;
+    }
+    cout << cdl->GetPrgMap().size() << " bytes: " << cdl->GetCodeBytes() << " code, "
+         << cdl->GetDataBytes() << " data" << endl;
+    return 0;
+}
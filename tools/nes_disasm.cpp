@@ -0,0 +1,49 @@
+#include "Cartridge.h"
+#include "Disassembler.h"
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+// nes_disasm <rom> [listing] [cdl] [entry...]
+// Writes the listing to stdout when no file is given. Extra entry points
+// are hex CPU addresses, e.g. C000 for nestest's automated mode.
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        cout << "usage: " << argv[0] << " <rom> [listing] [cdl] [entry...]" << endl;
+        return 1;
+    }
+
+    Cartridge cartridge(nullptr, nullptr);
+    cartridge.LoadRom(argv[1]);
+    const vector<uint8_t>& prg = cartridge.GetPrgRom();
+    if (prg.empty()) {
+        return 1;
+    }
+
+    Disassembler disasm(prg.data(), prg.size());
+    for (int i = 4; i < argc; i++) {
+        disasm.AddEntryPoint(strtoul(argv[i], nullptr, 16));
+    }
+    disasm.Analyze();
+
+    if (argc > 2 && string(argv[2]) != "-") {
+        ofstream listing(argv[2]);
+        if (!listing.is_open()) {
+            cout << "Cannot open " << argv[2] << endl;
+            return 1;
+        }
+        disasm.WriteListing(listing);
+    } else {
+        disasm.WriteListing(cout);
+    }
+    if (argc > 3 && !disasm.SaveMap(argv[3], cartridge.GetChrRom().size())) {
+        cout << "Cannot write " << argv[3] << endl;
+        return 1;
+    }
+
+    cerr << prg.size() << " bytes: " << disasm.GetCodeBytes() << " code, "
+         << disasm.GetDataBytes() << " data, " << disasm.GetJumpTables() << " jump tables" << endl;
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "FlightRecorder.h"
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// nes_flight <dump>
+// Decodes a flight recorder dump (nes_run -r) into nestest.log lines,
+// oldest first, with the bus writes of each instruction below it.
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        cout << "usage: " << argv[0] << " <dump>" << endl;
+        return 1;
+    }
+
+    flight_hdr header;
+    vector<flight_record> records;
+    vector<uint64_t> cycles;
+    if (!FlightRecorder::Load(argv[1], &header, &records, &cycles)) {
+        cout << "Not a flight recorder dump of this build: " << argv[1] << endl;
+        return 1;
+    }
+
+    switch (header.reason) {
+        case FLIGHT_REASON_ILLEGAL:
+            cout << "; dumped on an illegal opcode";
+            break;
+        case FLIGHT_REASON_SIGNAL:
+            cout << "; dumped on signal " << header.signal << " (" << strsignal(header.signal) << ")";
+            break;
+        default:
+            cout << "; dumped on request";
+            break;
+    }
+    cout << ", last " << records.size() << " of " << header.total << " records\n";
+    for (size_t i = 0; i < records.size(); i++) {
+        cout << FlightRecorder::Format(records[i], cycles[i]) << "\n";
+    }
+    cout.flush();
+    return 0;
+}
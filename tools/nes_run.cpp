@@ -0,0 +1,192 @@
+#include "Nes.h"
+#include "Movie.h"
+#include "TraceArchive.h"
+#include "FlightRecorder.h"
+#include "Logging.h"
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+#define DEFAULT_FRAMES      600
+#define NTSC_CPU_MHZ        1.789773
+#define DEFAULT_FLIGHT_FILE "nes_run.flight"
+
+static void Usage(const char* name) {
+    cout << "usage: " << name << " [options] <rom>\n"
+         << "  -f frames   frames to run (default " << DEFAULT_FRAMES << ", or the movie length)\n"
+         << "  -c cycles   CPU cycles to run instead of frames\n"
+         << "  -p pc       start PC in hex instead of the reset vector (C000: nestest)\n"
+         << "  -t file     write the CPU trace to file\n"
+         << "  -a file     record the CPU trace to a compressed archive (nes_trace)\n"
+         << "  -l file     load a save state before running\n"
+         << "  -s file     save the state at exit\n"
+         << "  -m file     play an input movie\n"
+         << "  -r file     flight recorder dump on an illegal opcode, a crash or SIGUSR1\n"
+         << "              (default " << DEFAULT_FLIGHT_FILE << ", decode with nes_flight)\n"
+         << "  -x          per-cycle CPU core" << endl;
+}
+
+static bool LoadState(Nes* nes, const char* filename) {
+    ifstream file(filename, ios::in | ios::binary);
+    nes_state state;
+    if (!file.read((char*)&state, sizeof(state)) || file.peek() != EOF) {
+        cout << "Not a save state of this build: " << filename << endl;
+        return false;
+    }
+    nes->LoadState(&state);
+    return true;
+}
+
+static bool SaveState(Nes* nes, const char* filename) {
+    ofstream file(filename, ios::out | ios::binary | ios::trunc);
+    nes_state state;
+    nes->SaveState(&state);
+    if (!file.write((const char*)&state, sizeof(state))) {
+        cout << "Cannot write " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+// nes_run [options] <rom>
+// Headless run for batch jobs and performance tracking. Exits with 1 on
+// errors or a desynced movie.
+int main(int argc, char* argv[]) {
+    uint64_t frames = 0;
+    uint64_t cycles = 0;
+    long pc = -1;
+    const char* trace = nullptr;
+    const char* archive = nullptr;
+    const char* load = nullptr;
+    const char* save = nullptr;
+    const char* movie_file = nullptr;
+    const char* flight_file = DEFAULT_FLIGHT_FILE;
+    bool cycle_core = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:c:p:t:a:l:s:m:r:x")) != -1) {
+        switch (opt) {
+            case 'f': frames = strtoull(optarg, nullptr, 0); break;
+            case 'c': cycles = strtoull(optarg, nullptr, 0); break;
+            case 'p': pc = strtol(optarg, nullptr, 16); break;
+            case 't': trace = optarg; break;
+            case 'a': archive = optarg; break;
+            case 'l': load = optarg; break;
+            case 's': save = optarg; break;
+            case 'm': movie_file = optarg; break;
+            case 'r': flight_file = optarg; break;
+            case 'x': cycle_core = true; break;
+            default:
+                Usage(argv[0]);
+                return 2;
+        }
+    }
+    if (optind != argc - 1) {
+        Usage(argv[0]);
+        return 2;
+    }
+
+    if (trace != nullptr) {
+        if (!LOG_COMPILED(CPU, TRACE)) {
+            cout << "CPU trace is compiled out (NES_LOG_LEVEL_CPU), -t ignored" << endl;
+        }
+        LOG_INIT(trace);
+    }
+
+    FlightRecorder recorder;
+    recorder.SetDumpFile(flight_file);
+    FlightRecorder::InstallSignalHandlers(&recorder);
+
+    Nes nes;
+    nes.SetFlightRecorder(&recorder);
+    nes.SetCpuCore(cycle_core ? Nes::CPU_CORE_CYCLE : Nes::CPU_CORE_FAST);
+    nes.PowerOn();
+    if (!nes.LoadRom(argv[optind])) {
+        return 1;   // LoadRom says why
+    }
+    nes.Reset();
+    if (pc >= 0) {
+        nes.SetPC(pc);
+    }
+    if (load != nullptr && !LoadState(&nes, load)) {
+        return 1;
+    }
+
+    TraceWriter trace_writer;
+    if (archive != nullptr) {
+        if (!trace_writer.Open(archive)) {
+            cout << "Cannot write " << archive << endl;
+            return 1;
+        }
+        nes.SetTraceSink(&trace_writer);
+    }
+
+    Movie movie(&nes);
+    if (movie_file != nullptr) {
+        if (!movie.Play(movie_file)) {
+            cout << "Cannot play " << movie_file << endl;
+            return 1;
+        }
+        if (frames == 0) {
+            frames = movie.GetFrameCount();
+        }
+    }
+    if (frames == 0 && cycles == 0) {
+        frames = DEFAULT_FRAMES;
+    }
+
+    uint64_t start_cycles = nes.GetCycles();
+    uint64_t start_instructions = nes.GetInstructions();
+    uint64_t start_frame = nes.GetFrame();
+    auto start = chrono::steady_clock::now();
+
+    if (cycles != 0) {
+        nes.RunCycles(start_cycles + cycles);
+    } else {
+        for (uint64_t i = 0; i < frames; i++) {
+            if (movie_file != nullptr) {
+                if (!movie.PlayFrame()) {
+                    break;
+                }
+                nes.RunFrame(true, false);
+            } else {
+                nes.RunFrame();
+            }
+        }
+    }
+
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    LOG_FLUSH();
+    bool archived = trace_writer.Close();
+
+    uint64_t ran_cycles = nes.GetCycles() - start_cycles;
+    uint64_t ran_instructions = nes.GetInstructions() - start_instructions;
+    double mhz = ran_cycles / seconds / 1e6;
+    cout << "frames:        " << nes.GetFrame() - start_frame << endl;
+    cout << "cycles:        " << ran_cycles << endl;
+    cout << "instructions:  " << ran_instructions << endl;
+    cout << "wall time:     " << seconds << " s" << endl;
+    cout << "effective:     " << mhz << " MHz (" << mhz / NTSC_CPU_MHZ << "x NTSC)" << endl;
+    cout << "instructions/s " << (uint64_t)(ran_instructions / seconds) << endl;
+
+    bool ok = true;
+    if (archive != nullptr && !archived) {
+        cout << "Cannot write " << archive << endl;
+        ok = false;
+    }
+    if (recorder.HasDumpedIllegal()) {
+        cout << "Illegal opcode, flight recorder written to " << flight_file << endl;
+    }
+    if (movie_file != nullptr && movie.IsDesynced()) {
+        cout << "Movie desynced" << endl;
+        ok = false;
+    }
+    if (save != nullptr && !SaveState(&nes, save)) {
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
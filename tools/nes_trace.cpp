@@ -0,0 +1,47 @@
+#include "TraceArchive.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace std;
+
+// nes_trace <archive> [from [to]]
+// Without a window, prints the extent of a trace archive (nes_run -a).
+// Otherwise prints the instructions starting in cycles [from, to) in the
+// nestest.log format, decoding only the chunks that overlap the window; to
+// defaults to the end of the trace.
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 4) {
+        cout << "usage: " << argv[0] << " <archive> [from [to]]" << endl;
+        return 1;
+    }
+
+    TraceReader reader;
+    if (!reader.Open(argv[1])) {
+        cout << "Not a trace archive: " << argv[1] << endl;
+        return 1;
+    }
+
+    if (argc == 2) {
+        if (reader.IsRecovered()) {
+            cout << "index missing, rebuilt from the chunks" << endl;
+        }
+        cout << "instructions:  " << reader.GetInstructionCount() << endl;
+        cout << "chunks:        " << reader.GetChunkCount() << endl;
+        cout << "cycles:        " << reader.GetFirstCycles() << " - "
+             << reader.GetLastCycles() << endl;
+        return 0;
+    }
+
+    uint64_t from = strtoull(argv[2], nullptr, 0);
+    uint64_t to = argc > 3 ? strtoull(argv[3], nullptr, 0) : reader.GetLastCycles() + 1;
+    vector<trace_record> records;
+    if (!reader.Read(from, to, &records)) {
+        cout << "Damaged chunk in " << argv[1] << endl;
+        return 1;
+    }
+    for (const trace_record& rec : records) {
+        cout << Cpu::FormatTrace(rec.reg, rec.opcode, rec.operand, rec.cycles) << "\n";
+    }
+    cout.flush();
+    return 0;
+}